@@ -5,3 +5,7 @@ set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL INTERNAL)
 set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL INTERNAL)
 
 add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/thirdparty/benchmark)
+
+# Like the bundled Google Test, the sources do not inherit -Werror
+target_compile_options(benchmark PRIVATE -Wno-error)
+target_compile_options(benchmark_main PRIVATE -Wno-error)
@@ -6,6 +6,10 @@ if (NOT GTEST_FOUND)
    set(INSTALL_GTEST OFF CACHE BOOL INTERNAL)
 
    add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/thirdparty/googletest)
+   # The bundled sources are not warning free with every compiler, so they
+   # do not inherit -Werror
+   target_compile_options(gtest PRIVATE -Wno-error)
+   target_compile_options(gtest_main PRIVATE -Wno-error)
 
    add_library(GTest::GTest ALIAS gtest)
 endif ()
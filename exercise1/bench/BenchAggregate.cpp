@@ -0,0 +1,78 @@
+#include "lib/AST.hpp"
+#include "lib/Aggregate.hpp"
+#include "lib/Batch.hpp"
+#include "lib/ColumnarContext.hpp"
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <benchmark/benchmark.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+constexpr size_t rowCount = 1 << 22;
+//---------------------------------------------------------------------------
+/// (p0 - p1) * (p0 + 1.5)
+unique_ptr<ASTNode> makeExpression() {
+    auto difference = make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1));
+    return make_unique<Multiply>(move(difference), make_unique<Add>(make_unique<Parameter>(0), make_unique<Constant>(1.5)));
+}
+//---------------------------------------------------------------------------
+vector<vector<double>> makeColumns() {
+    vector<vector<double>> columns(2, vector<double>(rowCount));
+    for (size_t r = 0; r < rowCount; ++r) {
+        columns[0][r] = 0.001 * (r % 1000);
+        columns[1][r] = 0.5 + 0.01 * (r % 17);
+    }
+    return columns;
+}
+//---------------------------------------------------------------------------
+/// Evaluate into an output vector of all rows and reduce it afterwards
+void BM_MaterializedAggregate(benchmark::State& state) {
+    auto node = makeExpression();
+    auto columns = makeColumns();
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    BatchEvaluator evaluator(*node);
+    for (auto _ : state) {
+        vector<double> out(rowCount);
+        evaluator.evaluate(context, out);
+        double sum = 0, min = out[0], max = out[0];
+        for (double value : out) {
+            sum += value;
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+        benchmark::DoNotOptimize(sum);
+        benchmark::DoNotOptimize(min);
+        benchmark::DoNotOptimize(max);
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount);
+}
+//---------------------------------------------------------------------------
+/// range(0) selects pairwise or Kahan summation
+void BM_FusedAggregate(benchmark::State& state) {
+    auto summation = static_cast<Summation>(state.range(0));
+    state.SetLabel(summation == Summation::Pairwise ? "pairwise" : "Kahan");
+    auto node = makeExpression();
+    auto columns = makeColumns();
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    AggregateEvaluator evaluator(*node, summation, 0.5);
+    for (auto _ : state) {
+        auto aggregates = evaluator.evaluate(context);
+        benchmark::DoNotOptimize(aggregates);
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+BENCHMARK(BM_MaterializedAggregate)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FusedAggregate)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+//---------------------------------------------------------------------------
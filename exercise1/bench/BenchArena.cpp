@@ -0,0 +1,45 @@
+#include "lib/AST.hpp"
+#include "lib/Arena.hpp"
+#include <memory>
+#include <utility>
+#include <benchmark/benchmark.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Build a sum of size products through the given arena, or on the heap
+unique_ptr<ASTNode> build(Arena* arena, int64_t size) {
+    unique_ptr<ASTNode> node = makeNode<Parameter>(arena, 0);
+    for (int64_t i = 0; i < size; ++i) {
+        auto term = makeNode<Multiply>(arena, makeNode<Parameter>(arena, 1), makeNode<UnaryMinus>(arena, makeNode<Constant>(arena, i)));
+        node = makeNode<Add>(arena, move(node), move(term));
+    }
+    return node;
+}
+//---------------------------------------------------------------------------
+void BM_BuildHeap(benchmark::State& state) {
+    for (auto _ : state) {
+        auto node = build(nullptr, state.range(0));
+        benchmark::DoNotOptimize(node.get());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 5);
+}
+//---------------------------------------------------------------------------
+void BM_BuildArena(benchmark::State& state) {
+    Arena arena;
+    for (auto _ : state) {
+        auto node = build(&arena, state.range(0));
+        benchmark::DoNotOptimize(node.get());
+        node.release();
+        arena.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 5);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+BENCHMARK(BM_BuildHeap)->Arg(1000);
+BENCHMARK(BM_BuildArena)->Arg(1000);
+//---------------------------------------------------------------------------
@@ -0,0 +1,277 @@
+#include "lib/AST.hpp"
+#include "lib/Batch.hpp"
+#include "lib/ColumnarContext.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "bench/Fixtures.hpp"
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include <benchmark/benchmark.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+constexpr size_t rowCount = 1 << 16;
+constexpr size_t columnCount = 4;
+//---------------------------------------------------------------------------
+using fixtures::makeExpression;
+//---------------------------------------------------------------------------
+vector<vector<double>> makeColumns() {
+    return fixtures::makeColumns(columnCount, rowCount);
+}
+//---------------------------------------------------------------------------
+void BM_RowAtATime(benchmark::State& state) {
+    auto node = makeExpression();
+    auto columns = makeColumns();
+    vector<double> out(rowCount);
+    for (auto _ : state) {
+        for (size_t r = 0; r < rowCount; ++r) {
+            EvaluationContext context;
+            for (const auto& column : columns)
+                context.pushParameter(column[r]);
+            out[r] = node->evaluate(context);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount);
+}
+//---------------------------------------------------------------------------
+void BM_Batch(benchmark::State& state) {
+    auto node = makeExpression();
+    auto columns = makeColumns();
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    BatchEvaluator evaluator(*node);
+    vector<double> out(rowCount);
+    for (auto _ : state) {
+        evaluator.evaluate(context, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount);
+}
+//---------------------------------------------------------------------------
+void BM_BatchISA(benchmark::State& state) {
+    auto isa = static_cast<Kernels::ISA>(state.range(0));
+    if (!Kernels::isSupported(isa)) {
+        state.SkipWithError("instruction set not supported");
+        return;
+    }
+    state.SetLabel(Kernels::getISAName(isa));
+    auto node = makeExpression();
+    auto columns = makeColumns();
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    BatchEvaluator evaluator(*node, isa);
+    vector<double> out(rowCount);
+    for (auto _ : state) {
+        evaluator.evaluate(context, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount);
+}
+//---------------------------------------------------------------------------
+/// A right-deep chain of range(0) operators, the stack grows by one per level
+unique_ptr<ASTNode> makeDeepExpression(size_t depth) {
+    unique_ptr<ASTNode> node = make_unique<Parameter>(0);
+    for (size_t i = 1; i <= depth; ++i) {
+        auto left = make_unique<Parameter>(i % columnCount);
+        if (i % 2)
+            node = make_unique<Add>(move(left), move(node));
+        else
+            node = make_unique<Multiply>(move(left), make_unique<Subtract>(move(node), make_unique<Constant>(0.5)));
+    }
+    return node;
+}
+//---------------------------------------------------------------------------
+/// A deep expression with tiles of range(1) rows, 0 sizes them from the L1 cache and 1 autotunes them
+void BM_TileSize(benchmark::State& state) {
+    auto node = makeDeepExpression(state.range(0));
+    auto columns = makeColumns();
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    size_t tileSize = state.range(1) == 1 ? autotuneTileSize(*node, context) : state.range(1);
+    BatchEvaluator evaluator(*node, Kernels::getBestISA(), tileSize);
+    state.SetLabel("tile " + to_string(evaluator.getTileSize()));
+    vector<double> out(rowCount);
+    for (auto _ : state) {
+        evaluator.evaluate(context, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount);
+}
+//---------------------------------------------------------------------------
+/// A pseudo random bitmask that selects range(0) percent of the rows
+vector<uint64_t> makeMask(int64_t percent) {
+    vector<uint64_t> mask(rowCount / 64);
+    uint64_t state = 42;
+    for (size_t r = 0; r < rowCount; ++r) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        if (static_cast<int64_t>((state >> 33) % 100) < percent)
+            mask[r / 64] |= uint64_t(1) << (r % 64);
+    }
+    return mask;
+}
+//---------------------------------------------------------------------------
+/// Only the rows of a selection vector, items are the selected rows
+void BM_Selection(benchmark::State& state) {
+    auto node = makeExpression();
+    auto columns = makeColumns();
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    auto mask = makeMask(state.range(0));
+    vector<uint32_t> selection;
+    for (size_t r = 0; r < rowCount; ++r)
+        if (mask[r / 64] >> (r % 64) & 1)
+            selection.push_back(r);
+    BatchEvaluator evaluator(*node);
+    vector<double> out(selection.size());
+    for (auto _ : state) {
+        evaluator.evaluate(context, selection, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * selection.size());
+}
+//---------------------------------------------------------------------------
+/// Only the rows of a bitmask, items are the selected rows
+void BM_SelectionMask(benchmark::State& state) {
+    auto node = makeExpression();
+    auto columns = makeColumns();
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    auto mask = makeMask(state.range(0));
+    size_t selected = 0;
+    for (auto word : mask)
+        selected += popcount(word);
+    BatchEvaluator evaluator(*node);
+    vector<double> out(rowCount);
+    for (auto _ : state) {
+        evaluator.evaluateMasked(context, mask, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * selected);
+}
+//---------------------------------------------------------------------------
+/// The batch evaluator with T as element type, over the same values as BM_Batch
+template <typename T>
+void BM_BatchPrecision(benchmark::State& state) {
+    auto node = makeExpression();
+    vector<vector<T>> columns;
+    for (const auto& column : makeColumns())
+        columns.emplace_back(column.begin(), column.end());
+    BasicColumnarContext<T> context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    BasicBatchEvaluator<T> evaluator(*node);
+    vector<T> out(rowCount);
+    for (auto _ : state) {
+        evaluator.evaluate(context, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount);
+    state.SetBytesProcessed(state.iterations() * rowCount * (columnCount + 1) * sizeof(T));
+}
+//---------------------------------------------------------------------------
+/// Power kernels, range(1) selects a variable exponent or the constants 3, 0.5 and 2.7
+void BM_Power(benchmark::State& state) {
+    auto isa = static_cast<Kernels::ISA>(state.range(0));
+    if (!Kernels::isSupported(isa)) {
+        state.SkipWithError("instruction set not supported");
+        return;
+    }
+    const Kernels& kernels = Kernels::get(isa);
+    constexpr double constantExponents[] = {3.0, 0.5, 2.7};
+    int64_t kind = state.range(1);
+    state.SetLabel(string(Kernels::getISAName(isa)) + (kind ? " constant " + to_string(constantExponents[kind - 1]) : " variable"));
+
+    constexpr size_t count = 4096;
+    vector<double> x(count), y(count), a(count);
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = 0.5 + 0.01 * i;
+        y[i] = -3.0 + 0.0015 * i;
+    }
+    for (auto _ : state) {
+        a = x;
+        if (kind)
+            kernels.powerConstant(a.data(), constantExponents[kind - 1], count);
+        else
+            kernels.power(a.data(), y.data(), count);
+        benchmark::DoNotOptimize(a.data());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+//---------------------------------------------------------------------------
+/// range(0) expressions over the same columns, which share the subtree (p0 - p1) * (p2 + 1.5)
+vector<unique_ptr<ASTNode>> makeExpressions(size_t count) {
+    vector<unique_ptr<ASTNode>> expressions;
+    for (size_t i = 0; i < count; ++i) {
+        auto difference = make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1));
+        auto product = make_unique<Multiply>(move(difference), make_unique<Add>(make_unique<Parameter>(2), make_unique<Constant>(1.5)));
+        auto scaled = make_unique<Multiply>(make_unique<Parameter>(i % columnCount), make_unique<Constant>(1.0 + i));
+        expressions.push_back(make_unique<Divide>(move(product), make_unique<Add>(move(scaled), make_unique<Constant>(2.0))));
+    }
+    return expressions;
+}
+//---------------------------------------------------------------------------
+void BM_SeparateExpressions(benchmark::State& state) {
+    auto expressions = makeExpressions(state.range(0));
+    auto columns = makeColumns();
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    vector<BatchEvaluator> evaluators;
+    for (const auto& expression : expressions)
+        evaluators.emplace_back(*expression);
+    vector<vector<double>> results(expressions.size(), vector<double>(rowCount));
+    for (auto _ : state) {
+        for (size_t i = 0; i < evaluators.size(); ++i)
+            evaluators[i].evaluate(context, results[i]);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount * expressions.size());
+}
+//---------------------------------------------------------------------------
+void BM_FusedExpressions(benchmark::State& state) {
+    auto expressions = makeExpressions(state.range(0));
+    auto columns = makeColumns();
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    vector<const ASTNode*> nodes;
+    for (const auto& expression : expressions)
+        nodes.push_back(expression.get());
+    MultiBatchEvaluator evaluator(nodes);
+    vector<vector<double>> results(expressions.size(), vector<double>(rowCount));
+    vector<span<double>> outputs(results.begin(), results.end());
+    for (auto _ : state) {
+        evaluator.evaluate(context, outputs);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount * expressions.size());
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+BENCHMARK(BM_RowAtATime);
+BENCHMARK(BM_Batch);
+BENCHMARK(BM_BatchISA)->DenseRange(0, Kernels::isaCount - 1);
+BENCHMARK(BM_TileSize)->ArgsProduct({{8, 64}, {0, 1, 64, 256, 1024, 4096}});
+BENCHMARK(BM_Selection)->Arg(1)->Arg(10)->Arg(30)->Arg(50)->Arg(70)->Arg(90)->Arg(100);
+BENCHMARK(BM_SelectionMask)->Arg(1)->Arg(10)->Arg(30)->Arg(50)->Arg(70)->Arg(90)->Arg(100);
+BENCHMARK_TEMPLATE(BM_BatchPrecision, float);
+BENCHMARK_TEMPLATE(BM_BatchPrecision, double);
+BENCHMARK_TEMPLATE(BM_BatchPrecision, long double);
+BENCHMARK(BM_Power)->ArgsProduct({{0, 1, 2, 3}, {0, 1, 2, 3}});
+BENCHMARK(BM_SeparateExpressions)->Arg(50)->Arg(200);
+BENCHMARK(BM_FusedExpressions)->Arg(50)->Arg(200);
+//---------------------------------------------------------------------------
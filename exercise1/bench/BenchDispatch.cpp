@@ -0,0 +1,98 @@
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/Program.hpp"
+#include "lib/ThreadedVM.hpp"
+#include "lib/VM.hpp"
+#include <memory>
+#include <utility>
+#include <benchmark/benchmark.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// A left-deep chain ((((P0 op c) op P1) op c) ...) with size operators
+unique_ptr<ASTNode> makeDeep(size_t size) {
+    unique_ptr<ASTNode> node = make_unique<Parameter>(0);
+    for (size_t i = 0; i < size; ++i) {
+        unique_ptr<ASTNode> leaf;
+        if (i % 2)
+            leaf = make_unique<Parameter>(i % 4);
+        else
+            leaf = make_unique<Constant>(1.0 + i % 7);
+        switch (i % 3) {
+            case 0: node = make_unique<Add>(move(node), move(leaf)); break;
+            case 1: node = make_unique<Multiply>(move(node), move(leaf)); break;
+            default: node = make_unique<Subtract>(move(node), move(leaf)); break;
+        }
+    }
+    return node;
+}
+//---------------------------------------------------------------------------
+/// A balanced tree with 2^depth leaves
+unique_ptr<ASTNode> makeWide(unsigned depth, size_t& next) {
+    if (!depth)
+        return make_unique<Parameter>(next++ % 4);
+    auto left = makeWide(depth - 1, next);
+    auto right = makeWide(depth - 1, next);
+    switch (depth % 3) {
+        case 0: return make_unique<Add>(move(left), move(right));
+        case 1: return make_unique<Multiply>(move(left), make_unique<UnaryMinus>(move(right)));
+        default: return make_unique<Subtract>(move(left), move(right));
+    }
+}
+//---------------------------------------------------------------------------
+unique_ptr<ASTNode> makeTree(int shape, int size) {
+    if (shape == 0)
+        return makeDeep(size_t(1) << size);
+    size_t next = 0;
+    return makeWide(size, next);
+}
+//---------------------------------------------------------------------------
+EvaluationContext makeContext() {
+    EvaluationContext context;
+    for (unsigned i = 0; i < 4; ++i)
+        context.pushParameter(0.75 + i * 0.125);
+    return context;
+}
+//---------------------------------------------------------------------------
+void setLabel(benchmark::State& state) {
+    state.SetLabel(state.range(0) ? "wide" : "deep");
+    state.SetItemsProcessed(state.iterations() * (int64_t(1) << state.range(1)));
+}
+//---------------------------------------------------------------------------
+void BM_DispatchTreeWalker(benchmark::State& state) {
+    auto node = makeTree(state.range(0), state.range(1));
+    auto context = makeContext();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(node->evaluate(context));
+    setLabel(state);
+}
+//---------------------------------------------------------------------------
+void BM_DispatchSwitch(benchmark::State& state) {
+    auto node = makeTree(state.range(0), state.range(1));
+    auto context = makeContext();
+    Program program = Program::compile(*node);
+    VM vm(program);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(vm.run(context));
+    setLabel(state);
+}
+//---------------------------------------------------------------------------
+void BM_DispatchThreaded(benchmark::State& state) {
+    auto node = makeTree(state.range(0), state.range(1));
+    auto context = makeContext();
+    Program program = Program::compile(*node);
+    ThreadedVM vm(program);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(vm.run(context));
+    setLabel(state);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+BENCHMARK(BM_DispatchTreeWalker)->ArgsProduct({{0, 1}, {6, 12}});
+BENCHMARK(BM_DispatchSwitch)->ArgsProduct({{0, 1}, {6, 12}});
+BENCHMARK(BM_DispatchThreaded)->ArgsProduct({{0, 1}, {6, 12}});
+//---------------------------------------------------------------------------
@@ -0,0 +1,232 @@
+#include "lib/AST.hpp"
+#include "lib/Closure.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/FlatTree.hpp"
+#include "lib/JIT.hpp"
+#include "lib/Program.hpp"
+#include "lib/RegisterProgram.hpp"
+#include "lib/RegisterVM.hpp"
+#include "lib/Rewriter.hpp"
+#include "lib/VM.hpp"
+#include <memory>
+#include <utility>
+#include <vector>
+#include <benchmark/benchmark.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+constexpr size_t parameterCount = 8;
+//---------------------------------------------------------------------------
+/// A polynomial-like expression with 2^depth leaves
+unique_ptr<ASTNode> makeExpression(unsigned depth, size_t& next) {
+    if (!depth) {
+        if (next % 3 == 2)
+            return make_unique<Constant>(0.5 + next);
+        return make_unique<Parameter>(next++ % parameterCount);
+    }
+    auto left = makeExpression(depth - 1, next);
+    auto right = makeExpression(depth - 1, next);
+    ++next;
+    switch (depth % 4) {
+        case 0: return make_unique<Add>(move(left), move(right));
+        case 1: return make_unique<Multiply>(move(left), move(right));
+        case 2: return make_unique<Subtract>(move(left), make_unique<UnaryMinus>(move(right)));
+        default: return make_unique<Divide>(move(left), move(right));
+    }
+}
+//---------------------------------------------------------------------------
+unique_ptr<ASTNode> makeExpression(unsigned depth) {
+    size_t next = 0;
+    return makeExpression(depth, next);
+}
+//---------------------------------------------------------------------------
+/// A risk formula that repeats (p3 - p4) ^ 2 in every one of its terms
+unique_ptr<ASTNode> makeRiskExpression(unsigned terms) {
+    auto square = [] { return make_unique<Power>(make_unique<Subtract>(make_unique<Parameter>(3), make_unique<Parameter>(4)), make_unique<Constant>(2.0)); };
+    unique_ptr<ASTNode> node = square();
+    for (unsigned i = 1; i < terms; ++i) {
+        auto term = make_unique<Divide>(make_unique<Multiply>(make_unique<Parameter>(i % parameterCount), square()), make_unique<Add>(square(), make_unique<Constant>(i)));
+        node = make_unique<Add>(move(node), move(term));
+    }
+    return node;
+}
+//---------------------------------------------------------------------------
+/// Sums p_i ^ e over the exponents that dominate our formulas
+unique_ptr<ASTNode> makePowerExpression() {
+    const double exponents[] = {2.0, 3.0, 0.5, -2.0, 5.0, -0.5, 4.0, 7.0};
+    unique_ptr<ASTNode> node = make_unique<Power>(make_unique<Parameter>(0), make_unique<Constant>(exponents[0]));
+    for (size_t i = 1; i < parameterCount; ++i) {
+        auto term = make_unique<Power>(make_unique<Parameter>(i), make_unique<Constant>(exponents[i]));
+        node = make_unique<Add>(move(node), move(term));
+    }
+    return node;
+}
+//---------------------------------------------------------------------------
+/// A polynomial of degree 16 in Horner's scheme, one multiply-add per step
+unique_ptr<ASTNode> makeHornerExpression() {
+    unique_ptr<ASTNode> node = make_unique<Constant>(1.0 / 17);
+    for (unsigned i = 16; i-- > 0;)
+        node = make_unique<Add>(make_unique<Constant>(1.0 / (i + 1)), make_unique<Multiply>(make_unique<Parameter>(0), move(node)));
+    return node;
+}
+//---------------------------------------------------------------------------
+EvaluationContext makeContext() {
+    EvaluationContext context;
+    for (size_t i = 0; i < parameterCount; ++i)
+        context.pushParameter(1.0 + i * 0.25);
+    return context;
+}
+//---------------------------------------------------------------------------
+void BM_TreeWalker(benchmark::State& state) {
+    auto node = makeExpression(state.range(0));
+    auto context = makeContext();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+void BM_FlatTree(benchmark::State& state) {
+    auto node = makeExpression(state.range(0));
+    auto context = makeContext();
+    auto tree = FlatTree::fromAST(*node);
+    vector<double> scratch;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(tree.evaluate(context, scratch));
+}
+//---------------------------------------------------------------------------
+void BM_StackVM(benchmark::State& state) {
+    auto node = makeExpression(state.range(0));
+    auto context = makeContext();
+    Program program = Program::compile(*node);
+    VM vm(program);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(vm.run(context));
+}
+//---------------------------------------------------------------------------
+void BM_RegisterVM(benchmark::State& state) {
+    auto node = makeExpression(state.range(0));
+    auto context = makeContext();
+    RegisterProgram program = RegisterProgram::compile(*node);
+    RegisterVM vm(program);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(vm.run(context));
+}
+//---------------------------------------------------------------------------
+void BM_Closure(benchmark::State& state) {
+    auto node = makeExpression(state.range(0));
+    auto function = ClosureFunction::compile(*node);
+    vector<double> params;
+    for (size_t i = 0; i < parameterCount; ++i)
+        params.push_back(1.0 + i * 0.25);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(function(params.data()));
+}
+//---------------------------------------------------------------------------
+void BM_JIT(benchmark::State& state) {
+    auto node = makeExpression(state.range(0));
+    auto function = JITFunction::compile(*node);
+    if (!function) {
+        state.SkipWithError("native code generation is not supported on this host");
+        return;
+    }
+    vector<double> params;
+    for (size_t i = 0; i < parameterCount; ++i)
+        params.push_back(1.0 + i * 0.25);
+    auto* entry = function->getFunction();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(entry(params.data()));
+}
+//---------------------------------------------------------------------------
+/// range(0) selects the tree walker, the stack VM or the register VM, the
+/// compiled ones compute the repeated square once
+void BM_CommonSubexpressions(benchmark::State& state) {
+    auto node = makeRiskExpression(16);
+    auto context = makeContext();
+    Program program = Program::compile(*node);
+    RegisterProgram registerProgram = RegisterProgram::compile(*node);
+    VM vm(program);
+    RegisterVM registerVM(registerProgram);
+    switch (state.range(0)) {
+        case 0:
+            state.SetLabel("tree walker");
+            for (auto _ : state)
+                benchmark::DoNotOptimize(node->evaluate(context));
+            break;
+        case 1:
+            state.SetLabel("stack VM");
+            for (auto _ : state)
+                benchmark::DoNotOptimize(vm.run(context));
+            break;
+        default:
+            state.SetLabel("register VM");
+            for (auto _ : state)
+                benchmark::DoNotOptimize(registerVM.run(context));
+            break;
+    }
+}
+//---------------------------------------------------------------------------
+/// range(0) selects the tree walker, the stack or the register VM, range(1)
+/// whether constant exponents are strength reduced in the tree first
+void BM_PowerStrengthReduction(benchmark::State& state) {
+    auto node = makePowerExpression();
+    if (state.range(1))
+        Rewriter::optimize(node);
+    auto context = makeContext();
+    Program program = Program::compile(*node);
+    RegisterProgram registerProgram = RegisterProgram::compile(*node);
+    VM vm(program);
+    RegisterVM registerVM(registerProgram);
+    state.SetLabel(state.range(1) ? "reduced" : "pow");
+    if (state.range(0) == 2) {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(registerVM.run(context));
+    } else if (state.range(0) == 1) {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(vm.run(context));
+    } else {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(node->evaluate(context));
+    }
+}
+//---------------------------------------------------------------------------
+void BM_FusedMultiplyAdd(benchmark::State& state) {
+    auto node = makeHornerExpression();
+    if (state.range(1))
+        Rewriter::fuse(node);
+    auto context = makeContext();
+    Program program = Program::compile(*node);
+    RegisterProgram registerProgram = RegisterProgram::compile(*node);
+    VM vm(program);
+    RegisterVM registerVM(registerProgram);
+    auto native = JITFunction::compile(*node);
+    state.SetLabel(state.range(1) ? "fused" : "separate");
+    if (state.range(0) == 2) {
+        if (!native) {
+            state.SkipWithError("native code generation is not supported on this host");
+            return;
+        }
+        for (auto _ : state)
+            benchmark::DoNotOptimize(native->evaluate(context));
+    } else if (state.range(0) == 1) {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(registerVM.run(context));
+    } else {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(vm.run(context));
+    }
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+BENCHMARK(BM_TreeWalker)->DenseRange(2, 10, 4);
+BENCHMARK(BM_FlatTree)->DenseRange(2, 10, 4);
+BENCHMARK(BM_StackVM)->DenseRange(2, 10, 4);
+BENCHMARK(BM_RegisterVM)->DenseRange(2, 10, 4);
+BENCHMARK(BM_Closure)->DenseRange(2, 10, 4);
+BENCHMARK(BM_JIT)->DenseRange(2, 10, 4);
+BENCHMARK(BM_CommonSubexpressions)->DenseRange(0, 2);
+BENCHMARK(BM_PowerStrengthReduction)->ArgsProduct({{0, 1, 2}, {0, 1}});
+BENCHMARK(BM_FusedMultiplyAdd)->ArgsProduct({{0, 1, 2}, {0, 1}});
+//---------------------------------------------------------------------------
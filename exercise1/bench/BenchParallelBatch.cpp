@@ -0,0 +1,51 @@
+#include "lib/AST.hpp"
+#include "lib/ColumnarContext.hpp"
+#include "lib/ParallelBatch.hpp"
+#include "lib/ThreadPool.hpp"
+#include "bench/Fixtures.hpp"
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <benchmark/benchmark.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+constexpr size_t rowCount = 1 << 22;
+constexpr size_t columnCount = 4;
+//---------------------------------------------------------------------------
+/// Evaluate rowCount rows, range(0) is the thread count and range(1) the chunk size
+void BM_ParallelBatch(benchmark::State& state) {
+    auto node = fixtures::makeExpression(1.5);
+    auto columns = fixtures::makeColumns(columnCount, rowCount);
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+
+    ThreadPool pool(state.range(0));
+    ParallelBatchEvaluator evaluator(*node, pool, state.range(1));
+    vector<double> out(rowCount);
+    for (auto _ : state) {
+        evaluator.evaluate(context, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rowCount);
+}
+//---------------------------------------------------------------------------
+/// Scale from 1 thread to one thread per hardware thread
+void scalingArguments(benchmark::internal::Benchmark* benchmark) {
+    int64_t hardwareThreads = max<int64_t>(thread::hardware_concurrency(), 1);
+    for (int64_t chunkSize : {int64_t{1024}, int64_t{ParallelBatchEvaluator::defaultChunkSize}, int64_t{65536}}) {
+        for (int64_t threads = 1; threads < hardwareThreads; threads *= 2)
+            benchmark->Args({threads, chunkSize});
+        benchmark->Args({hardwareThreads, chunkSize});
+    }
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+BENCHMARK(BM_ParallelBatch)->Apply(scalingArguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+//---------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+#include "lib/AST.hpp"
+#include "lib/Arena.hpp"
+#include "lib/Optimizer.hpp"
+#include "lib/Rewriter.hpp"
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <benchmark/benchmark.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// A left-deep sum of about size nodes where every term can be simplified
+unique_ptr<ASTNode> build(Arena& arena, int64_t size) {
+    unique_ptr<ASTNode> node = arena.make<Parameter>(0);
+    for (int64_t i = 0; i < size / 8; ++i) {
+        // -(1 * p1) - -(2 + 3) needs a neutral element, a fold and a negation rule
+        auto product = arena.make<Multiply>(arena.make<Constant>(1.0), arena.make<Parameter>(1));
+        auto folded = arena.make<UnaryMinus>(arena.make<Add>(arena.make<Constant>(2.0), arena.make<Constant>(3.0)));
+        auto term = arena.make<Subtract>(arena.make<UnaryMinus>(move(product)), move(folded));
+        node = arena.make<Add>(move(node), move(term));
+    }
+    return node;
+}
+//---------------------------------------------------------------------------
+/// The time per node stays constant from small to deep trees
+void BM_Optimize(benchmark::State& state) {
+    Arena arena;
+    for (auto _ : state) {
+        state.PauseTiming();
+        arena.reset();
+        auto node = build(arena, state.range(0));
+        state.ResumeTiming();
+        Rewriter::optimize(node);
+        benchmark::DoNotOptimize(node.get());
+        node.release();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+//---------------------------------------------------------------------------
+/// The optimizer on a tree of range(0) nodes with a time budget of range(1) ms,
+/// the latency stays close to the budget however large the tree is
+void BM_OptimizerBudget(benchmark::State& state) {
+    Optimizer::Options options;
+    options.timeBudget = std::chrono::milliseconds(state.range(1));
+    Optimizer optimizer(options);
+    Arena arena;
+    unsigned converged = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        arena.reset();
+        auto node = build(arena, state.range(0));
+        state.ResumeTiming();
+        converged += optimizer.run(node).converged;
+        node.release();
+    }
+    state.counters["converged"] = benchmark::Counter(converged, benchmark::Counter::kAvgIterations);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+BENCHMARK(BM_Optimize)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_OptimizerBudget)->ArgsProduct({{100000, 1000000}, {5, 1000}})->Unit(benchmark::kMillisecond);
+//---------------------------------------------------------------------------
@@ -0,0 +1,50 @@
+#include "lib/AST.hpp"
+#include "lib/ColumnFile.hpp"
+#include "lib/Streaming.hpp"
+#include "bench/Fixtures.hpp"
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+constexpr size_t rowCount = 1 << 22;
+constexpr size_t columnCount = 4;
+//---------------------------------------------------------------------------
+/// Stream a file of rowCount rows through the evaluator, range(0) is the chunk size.
+/// The file is usually in the page cache, so this measures the pipeline overhead.
+void BM_Streaming(benchmark::State& state) {
+    auto directory = filesystem::temp_directory_path();
+    string input = directory / ("ast_bench_" + to_string(getpid()) + "_input");
+    string output = directory / ("ast_bench_" + to_string(getpid()) + "_output");
+    {
+        auto writer = ColumnFileWriter::create(input, columnCount, rowCount);
+        vector<double> column(rowCount);
+        for (size_t c = 0; c < columnCount; ++c) {
+            for (size_t r = 0; r < rowCount; ++r)
+                column[r] = fixtures::makeValue(c, r);
+            writer->write(c, 0, column);
+        }
+    }
+
+    auto node = fixtures::makeExpression();
+    StreamingEvaluator evaluator(*node, state.range(0));
+    for (auto _ : state)
+        if (!evaluator.evaluate(input, output))
+            state.SkipWithError("I/O error");
+    state.SetItemsProcessed(state.iterations() * rowCount);
+    filesystem::remove(input);
+    filesystem::remove(output);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+BENCHMARK(BM_Streaming)->Arg(4096)->Arg(StreamingEvaluator::defaultChunkRows)->Arg(1 << 20)->UseRealTime()->Unit(benchmark::kMillisecond);
+//---------------------------------------------------------------------------
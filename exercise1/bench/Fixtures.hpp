@@ -0,0 +1,42 @@
+#ifndef H_bench_Fixtures
+#define H_bench_Fixtures
+//---------------------------------------------------------------------------
+#include "lib/AST.hpp"
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+//---------------------------------------------------------------------------
+/// Inputs shared by the benchmarks of the column-wise evaluators
+namespace fixtures {
+//---------------------------------------------------------------------------
+/// ((p0 - p1) * (p2 + 1.5) - -p3) / (p0 * p3 + 2) ^ exponent, the power is
+/// left out for an exponent of 1
+inline std::unique_ptr<ast::ASTNode> makeExpression(double exponent = 1.0) {
+    using namespace ast;
+    auto difference = std::make_unique<Subtract>(std::make_unique<Parameter>(0), std::make_unique<Parameter>(1));
+    auto product = std::make_unique<Multiply>(std::move(difference), std::make_unique<Add>(std::make_unique<Parameter>(2), std::make_unique<Constant>(1.5)));
+    auto numerator = std::make_unique<Subtract>(std::move(product), std::make_unique<UnaryMinus>(std::make_unique<Parameter>(3)));
+    std::unique_ptr<ASTNode> denominator = std::make_unique<Add>(std::make_unique<Multiply>(std::make_unique<Parameter>(0), std::make_unique<Parameter>(3)), std::make_unique<Constant>(2.0));
+    if (exponent != 1.0)
+        denominator = std::make_unique<Power>(std::move(denominator), std::make_unique<Constant>(exponent));
+    return std::make_unique<Divide>(std::move(numerator), std::move(denominator));
+}
+//---------------------------------------------------------------------------
+/// Value r of column c of the inputs of makeExpression()
+inline double makeValue(size_t c, size_t r) {
+    return 1.0 + 0.001 * r + c;
+}
+//---------------------------------------------------------------------------
+/// All columns of the inputs of makeExpression()
+inline std::vector<std::vector<double>> makeColumns(size_t columnCount, size_t rowCount) {
+    std::vector<std::vector<double>> columns(columnCount, std::vector<double>(rowCount));
+    for (size_t c = 0; c < columnCount; ++c)
+        for (size_t r = 0; r < rowCount; ++r)
+            columns[c][r] = makeValue(c, r);
+    return columns;
+}
+//---------------------------------------------------------------------------
+} // namespace fixtures
+//---------------------------------------------------------------------------
+#endif
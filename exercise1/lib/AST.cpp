@@ -1,6 +1,7 @@
 #include "lib/AST.hpp"
 #include "lib/ASTVisitor.hpp"
 #include "lib/EvaluationContext.hpp"
+#include "lib/Rewriter.hpp"
 //---------------------------------------------------------------------------
 namespace ast {
 
@@ -24,13 +25,26 @@ double UnaryMinus::evaluate(const EvaluationContext& context) const {
 }
 
 void UnaryMinus::optimize(std::unique_ptr<ASTNode>& thisRef) {
-    // Check if the child is a Constant
-    if (const auto* constantChild = dynamic_cast<const Constant*>(child.get())) {
-        // If yes, optimize by evaluating the negation
-        double newValue = -constantChild->getValue();
-        thisRef = std::make_unique<Constant>(newValue);
-    }
-    // You can add more optimizations specific to UnaryMinus as needed.
+    // The rules of all node types live in the Rewriter's table
+    Rewriter::optimize(thisRef);
+}
+
+SquareRoot::SquareRoot(std::unique_ptr<ASTNode> child) : UnaryASTNode(std::move(child)) {}
+
+ASTNode::Type SquareRoot::getType() const {
+    return Type::SquareRoot;
+}
+
+void SquareRoot::accept(ASTVisitor& visitor) const {
+    visitor.visit(*this);
+}
+
+double SquareRoot::evaluate(const EvaluationContext& context) const {
+    return apply(child->evaluate(context));
+}
+
+void SquareRoot::optimize(std::unique_ptr<ASTNode>& thisRef) {
+    Rewriter::optimize(thisRef);
 }
 
 
@@ -92,29 +106,107 @@ double UnaryPlus::evaluate(const EvaluationContext& context) const {
 }
 
 void UnaryPlus::optimize(std::unique_ptr<ASTNode>& thisRef) {
-    // Your optimization logic here, if needed.
-    // For simplicity, I'm not making any changes in this example.
+    Rewriter::optimize(thisRef);
+}
 
-     child->optimize(child);
+void Add::optimize(std::unique_ptr<ASTNode>& thisRef) {
+    Rewriter::optimize(thisRef);
+}
 
-    // Apply specific optimizations
-    if (dynamic_cast<Constant*>(child.get())) {
-        // Optimization: +CONST => CONST
-        thisRef = std::move(child);
-    }
-    else {
-        // If the child is not a constant, keep the UnaryPlus node
-        // or apply other optimizations specific to UnaryPlus
+void Subtract::optimize(std::unique_ptr<ASTNode>& thisRef) {
+    Rewriter::optimize(thisRef);
+}
 
-        // Other UnaryPlus specific optimizations can be added here.
-        // For now, let's check for the case +E => E
-        if (auto* unaryChild = dynamic_cast<UnaryASTNode*>(child.get())) {
-            // Optimization: +E => E
-            thisRef = unaryChild->releaseInput();
-        }
-    }
+void Multiply::optimize(std::unique_ptr<ASTNode>& thisRef) {
+    Rewriter::optimize(thisRef);
+}
+
+void Divide::optimize(std::unique_ptr<ASTNode>& thisRef) {
+    Rewriter::optimize(thisRef);
+}
+
+void Power::optimize(std::unique_ptr<ASTNode>& thisRef) {
+    Rewriter::optimize(thisRef);
+}
+
+ASTNode::Type IntegerPower::getType() const {
+    return Type::IntegerPower;
+}
+
+void IntegerPower::accept(ASTVisitor& visitor) const {
+    visitor.visit(*this);
+}
+
+double IntegerPower::evaluate(const EvaluationContext& context) const {
+    return apply(left->evaluate(context), static_cast<const Constant&>(*right).getValue());
+}
+
+void IntegerPower::optimize(std::unique_ptr<ASTNode>& thisRef) {
+    Rewriter::optimize(thisRef);
+}
+
+TernaryASTNode::TernaryASTNode(std::unique_ptr<ASTNode> first, std::unique_ptr<ASTNode> second, std::unique_ptr<ASTNode> third)
+    : first(std::move(first)), second(std::move(second)), third(std::move(third)) {}
+
+const ASTNode& TernaryASTNode::getFirst() const {
+    return *first;
+}
+
+const ASTNode& TernaryASTNode::getSecond() const {
+    return *second;
+}
+
+const ASTNode& TernaryASTNode::getThird() const {
+    return *third;
+}
+
+std::unique_ptr<ASTNode> TernaryASTNode::releaseFirst() {
+    return std::move(first);
+}
+
+std::unique_ptr<ASTNode> TernaryASTNode::releaseSecond() {
+    return std::move(second);
+}
+
+std::unique_ptr<ASTNode> TernaryASTNode::releaseThird() {
+    return std::move(third);
+}
+
+ASTNode::Type FusedMultiplyAdd::getType() const {
+    return Type::FusedMultiplyAdd;
+}
+
+void FusedMultiplyAdd::accept(ASTVisitor& visitor) const {
+    visitor.visit(*this);
+}
+
+double FusedMultiplyAdd::evaluate(const EvaluationContext& context) const {
+    double a = first->evaluate(context);
+    double b = second->evaluate(context);
+    return apply(a, b, third->evaluate(context));
+}
+
+void FusedMultiplyAdd::optimize(std::unique_ptr<ASTNode>& thisRef) {
+    Rewriter::optimize(thisRef);
+}
+
+ASTNode::Type FusedMultiplySubtract::getType() const {
+    return Type::FusedMultiplySubtract;
+}
+
+void FusedMultiplySubtract::accept(ASTVisitor& visitor) const {
+    visitor.visit(*this);
+}
+
+double FusedMultiplySubtract::evaluate(const EvaluationContext& context) const {
+    double a = first->evaluate(context);
+    double b = second->evaluate(context);
+    return apply(a, b, third->evaluate(context));
+}
+
+void FusedMultiplySubtract::optimize(std::unique_ptr<ASTNode>& thisRef) {
+    Rewriter::optimize(thisRef);
 }
 
- 
 } // namespace ast
 //---------------------------------------------------------------------------
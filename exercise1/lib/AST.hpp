@@ -3,7 +3,9 @@
 //---------------------------------------------------------------------------
 #include <memory>
 #include <cmath>
+#include <limits>
 #include "lib/ASTVisitor.hpp" 
+#include "lib/AdditionChain.hpp"
 #include "lib/EvaluationContext.hpp"
 //---------------------------------------------------------------------------
 namespace ast {
@@ -11,6 +13,7 @@ namespace ast {
 /// Base class for AST nodes
 
 class EvaluationContext;
+class Arena;
 
 class PrintVisitor;
 class ASTVisitor;
@@ -28,11 +31,18 @@ class ASTNode {
     enum class Type {
         UnaryPlus,
         UnaryMinus,
+        /// Only created by the optimizer, see SquareRoot
+        SquareRoot,
         Add,
         Subtract,
         Multiply,
         Divide,
         Power,
+        /// Only created by the optimizer, see IntegerPower
+        IntegerPower,
+        /// Only created by the fusion pass, see FusedMultiplyAdd
+        FusedMultiplyAdd,
+        FusedMultiplySubtract,
         Constant,
         Parameter
     };
@@ -45,6 +55,13 @@ class ASTNode {
     virtual double evaluate(const EvaluationContext& context) const = 0;
     virtual void optimize(std::unique_ptr<ASTNode>& thisRef) = 0;
     virtual ~ASTNode() = default;
+
+    /// Nodes are allocated with a small header that records their Arena,
+    /// deleting an arena node is a no-op
+    static void* operator new(std::size_t size);
+    static void* operator new(std::size_t size, Arena& arena);
+    static void operator delete(void* ptr);
+    static void operator delete(void* ptr, Arena& arena);
    
 };
 
@@ -58,6 +75,8 @@ virtual void accept(ASTVisitor& visitor) const = 0;
     std::unique_ptr<ASTNode> releaseInput();
 
 protected:
+    friend class Rewriter;
+
     std::unique_ptr<ASTNode> child;
 };
 
@@ -73,10 +92,32 @@ public:
     std::unique_ptr<ASTNode> releaseRight();
 
 protected:
+    friend class Rewriter;
+
     std::unique_ptr<ASTNode> left;
     std::unique_ptr<ASTNode> right;
 };
 
+/// A node with three operands, the fused multiply-adds are the only ones
+class TernaryASTNode : public ASTNode {
+public:
+    TernaryASTNode(std::unique_ptr<ASTNode> first, std::unique_ptr<ASTNode> second, std::unique_ptr<ASTNode> third);
+    virtual void accept(ASTVisitor& visitor) const = 0;
+    const ASTNode& getFirst() const;
+    const ASTNode& getSecond() const;
+    const ASTNode& getThird() const;
+    std::unique_ptr<ASTNode> releaseFirst();
+    std::unique_ptr<ASTNode> releaseSecond();
+    std::unique_ptr<ASTNode> releaseThird();
+
+protected:
+    friend class Rewriter;
+
+    std::unique_ptr<ASTNode> first;
+    std::unique_ptr<ASTNode> second;
+    std::unique_ptr<ASTNode> third;
+};
+
 class UnaryPlus : public UnaryASTNode {
 public:
     using UnaryASTNode::UnaryASTNode;
@@ -115,6 +156,30 @@ public:
     }
 };
 
+/// The square root with the special cases of pow(a, 0.5), which maps -0 to
+/// +0 and -inf to +inf. The optimizer replaces a ^ 0.5 by it.
+class SquareRoot : public UnaryASTNode {
+public:
+    explicit SquareRoot(std::unique_ptr<ASTNode> child);
+
+    Type getType() const override;
+    void accept(ASTVisitor& visitor) const override;
+    double evaluate(const EvaluationContext& context) const override;
+    void optimize(std::unique_ptr<ASTNode>& thisRef) override;
+
+    void accept(const ASTVisitor& visitor) const override {
+        visitor.visit(*this);
+    }
+
+    /// pow(value, 0.5), shared by all backends
+    template <typename T>
+    static T apply(T value) {
+        if (value == -std::numeric_limits<T>::infinity())
+            return std::numeric_limits<T>::infinity();
+        return std::sqrt(value) + T(0);
+    }
+};
+
 class Add : public BinaryASTNode {
 public:
     using BinaryASTNode::BinaryASTNode;
@@ -242,6 +307,88 @@ public:
     std::unique_ptr<ASTNode> rightOperand;
 };
 
+/// a ^ n for a constant integer n with 2 <= |n| <= AdditionChain::maxExponent,
+/// multiplied along the shortest addition chain of n and within |n| ulp of
+/// pow(a, n). The optimizer replaces such powers by it, the backends only
+/// lower this node to multiplications, so they all agree with the tree.
+class IntegerPower : public BinaryASTNode {
+public:
+    using BinaryASTNode::BinaryASTNode;
+
+    Type getType() const override;
+    void accept(ASTVisitor& visitor) const override;
+    double evaluate(const EvaluationContext& context) const override;
+    void optimize(std::unique_ptr<ASTNode>& thisRef) override;
+
+    void accept(const ASTVisitor& visitor) const override {
+        visitor.visit(*this);
+    }
+
+    const ASTNode& getLeft() const override {
+        return *left;
+    }
+
+    /// The exponent, always a Constant
+    const ASTNode& getRight() const override {
+        return *right;
+    }
+
+    /// base ^ exponent along the addition chain, shared by all backends
+    template <typename T>
+    static T apply(T base, double exponent) {
+        AdditionChain chain(exponent);
+        size_t length = chain.getLength();
+        T powers[AdditionChain::maxLength + 1] = {base};
+        for (size_t k = 1; k <= length; ++k)
+            powers[k] = powers[k - 1] * powers[chain.getOperand(k)];
+        return (exponent < 0) ? T(1) / powers[length] : powers[length];
+    }
+};
+
+/// a * b + c rounded once, which is faster and more accurate than a
+/// multiplication followed by an addition. The fusion pass of the Rewriter
+/// creates it from a * b + c and c + a * b.
+class FusedMultiplyAdd : public TernaryASTNode {
+public:
+    using TernaryASTNode::TernaryASTNode;
+
+    Type getType() const override;
+    void accept(ASTVisitor& visitor) const override;
+    double evaluate(const EvaluationContext& context) const override;
+    void optimize(std::unique_ptr<ASTNode>& thisRef) override;
+
+    void accept(const ASTVisitor& visitor) const override {
+        visitor.visit(*this);
+    }
+
+    /// fma(a, b, c), shared by all backends
+    template <typename T>
+    static T apply(T a, T b, T c) {
+        return std::fma(a, b, c);
+    }
+};
+
+/// a * b - c rounded once, created by the fusion pass from a * b - c
+class FusedMultiplySubtract : public TernaryASTNode {
+public:
+    using TernaryASTNode::TernaryASTNode;
+
+    Type getType() const override;
+    void accept(ASTVisitor& visitor) const override;
+    double evaluate(const EvaluationContext& context) const override;
+    void optimize(std::unique_ptr<ASTNode>& thisRef) override;
+
+    void accept(const ASTVisitor& visitor) const override {
+        visitor.visit(*this);
+    }
+
+    /// fma(a, b, -c), shared by all backends
+    template <typename T>
+    static T apply(T a, T b, T c) {
+        return std::fma(a, b, -c);
+    }
+};
+
 class Constant : public ASTNode {
 public:
     Constant(double value);
@@ -14,10 +14,14 @@ class Subtract;
 class Multiply;
 class Divide;
 class Power;
+class IntegerPower;
 class Constant;
 class Parameter;
 class UnaryMinus;
 class UnaryPlus;
+class SquareRoot;
+class FusedMultiplyAdd;
+class FusedMultiplySubtract;
 
 class ASTVisitor {
 public:
@@ -29,10 +33,14 @@ public:
     virtual void visit(const Multiply& node) const = 0;
     virtual void visit(const Divide& node) const = 0;
     virtual void visit(const Power& node) const = 0;
+    virtual void visit(const IntegerPower& node) const = 0;
     virtual void visit(const Constant& node) const = 0;
     virtual void visit(const Parameter& node) const = 0;
     virtual void visit(const UnaryMinus& node) const = 0;
     virtual void visit(const UnaryPlus& node) const = 0;
+    virtual void visit(const SquareRoot& node) const = 0;
+    virtual void visit(const FusedMultiplyAdd& node) const = 0;
+    virtual void visit(const FusedMultiplySubtract& node) const = 0;
     // Add more visit methods for other ASTNode types as needed
 };
 
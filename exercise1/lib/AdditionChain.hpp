@@ -0,0 +1,81 @@
+#ifndef H_lib_AdditionChain
+#define H_lib_AdditionChain
+//---------------------------------------------------------------------------
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+/// The shortest addition chain of an integer exponent, which computes a ^ n
+/// with the fewest multiplications. Step k multiplies power k - 1 by the
+/// earlier power getOperand(k), power 0 is a itself. Only 15 needs one step
+/// less than the binary method.
+class AdditionChain {
+public:
+    /// The largest |n| with a chain
+    static constexpr double maxExponent = 16;
+    /// The most multiplications any chain needs
+    static constexpr size_t maxLength = 5;
+
+    /// Whether value is an integer n with 2 <= |n| <= maxExponent
+    static bool isExponent(double value) {
+        double magnitude = std::fabs(value);
+        return magnitude >= 2 && magnitude <= maxExponent && magnitude == std::trunc(magnitude);
+    }
+
+    /// The chain of |exponent|, which must satisfy isExponent()
+    explicit AdditionChain(double exponent) : chain(chains[static_cast<size_t>(std::fabs(exponent))]) {}
+
+    /// The number of multiplications
+    size_t getLength() const {
+        size_t length = 0;
+        while (length < maxLength && chain[length + 1])
+            ++length;
+        return length;
+    }
+    /// The earlier power that step k >= 1 multiplies power k - 1 with
+    size_t getOperand(size_t k) const {
+        size_t i = 0;
+        while (chain[i] + chain[k - 1] != chain[k])
+            ++i;
+        return i;
+    }
+    /// Whether a later step reads power i again
+    bool isReused(size_t i) const {
+        for (size_t k = i + 1, length = getLength(); k <= length; ++k)
+            if (getOperand(k) == i)
+                return true;
+        return false;
+    }
+
+private:
+    /// Each entry after the first is the previous entry plus an earlier one
+    static constexpr uint8_t chains[][maxLength + 1] = {
+        {},
+        {1},
+        {1, 2},
+        {1, 2, 3},
+        {1, 2, 4},
+        {1, 2, 4, 5},
+        {1, 2, 3, 6},
+        {1, 2, 3, 5, 7},
+        {1, 2, 4, 8},
+        {1, 2, 4, 8, 9},
+        {1, 2, 4, 5, 10},
+        {1, 2, 3, 5, 10, 11},
+        {1, 2, 3, 6, 12},
+        {1, 2, 3, 5, 10, 13},
+        {1, 2, 3, 5, 7, 14},
+        {1, 2, 3, 6, 12, 15},
+        {1, 2, 4, 8, 16},
+    };
+    static_assert(std::size(chains) == maxExponent + 1);
+
+    const uint8_t* chain;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
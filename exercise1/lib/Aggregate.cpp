@@ -0,0 +1,142 @@
+#include "lib/Aggregate.hpp"
+#include <algorithm>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The number of independent accumulators of the reductions
+constexpr size_t lanes = 8;
+//---------------------------------------------------------------------------
+/// Add up values in independent lanes, which the compiler keeps in vector registers
+template <typename T>
+T sumLanes(const T* values, size_t count) {
+    T sums[lanes] = {};
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+        for (size_t l = 0; l < lanes; ++l)
+            sums[l] += values[i + l];
+    for (size_t l = 0; i < count; ++i, ++l)
+        sums[l] += values[i];
+    for (size_t width = lanes / 2; width; width /= 2)
+        for (size_t l = 0; l < width; ++l)
+            sums[l] += sums[l + width];
+    return sums[0];
+}
+//---------------------------------------------------------------------------
+/// Pairwise summation of one block
+template <typename T>
+T sumPairwise(const T* values, size_t count) {
+    if (count <= 4 * lanes)
+        return sumLanes(values, count);
+    size_t half = count / 2;
+    return sumPairwise(values, half) + sumPairwise(values + half, count - half);
+}
+//---------------------------------------------------------------------------
+/// Kahan summation in independent lanes, sums and compensations carry over between blocks
+template <typename T>
+void addKahan(T* sums, T* compensations, const T* values, size_t count) {
+    size_t i = 0;
+    auto add = [&](size_t l, T value) {
+        T y = value - compensations[l];
+        T t = sums[l] + y;
+        compensations[l] = (t - sums[l]) - y;
+        sums[l] = t;
+    };
+    for (; i + lanes <= count; i += lanes)
+        for (size_t l = 0; l < lanes; ++l)
+            add(l, values[i + l]);
+    for (size_t l = 0; i < count; ++i, ++l)
+        add(l, values[i]);
+}
+//---------------------------------------------------------------------------
+/// Fold min, max and the count above threshold of one block into aggregates
+template <typename T>
+void reduceBlock(BasicAggregates<T>& aggregates, const T* values, size_t count, T threshold) {
+    T mins[lanes], maxs[lanes];
+    size_t above[lanes] = {};
+    std::fill_n(mins, lanes, aggregates.min);
+    std::fill_n(maxs, lanes, aggregates.max);
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        for (size_t l = 0; l < lanes; ++l) {
+            T value = values[i + l];
+            // Comparisons with NaN are false, so NaNs are skipped
+            mins[l] = value < mins[l] ? value : mins[l];
+            maxs[l] = value > maxs[l] ? value : maxs[l];
+            above[l] += value > threshold;
+        }
+    }
+    for (; i < count; ++i) {
+        T value = values[i];
+        mins[0] = value < mins[0] ? value : mins[0];
+        maxs[0] = value > maxs[0] ? value : maxs[0];
+        above[0] += value > threshold;
+    }
+    for (size_t l = 0; l < lanes; ++l) {
+        aggregates.min = std::min(aggregates.min, mins[l]);
+        aggregates.max = std::max(aggregates.max, maxs[l]);
+        aggregates.aboveCount += above[l];
+    }
+    aggregates.count += count;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+template <typename T>
+BasicAggregateEvaluator<T>::BasicAggregateEvaluator(const ASTNode& node, Summation summation, T threshold)
+    : evaluator(node), summation(summation), threshold(threshold), block(evaluator.getTileSize()) {}
+//---------------------------------------------------------------------------
+template <typename T>
+BasicAggregates<T> BasicAggregateEvaluator<T>::evaluate(const BasicColumnarContext<T>& context, size_t firstRow, size_t rowCount) {
+    size_t tileSize = evaluator.getTileSize();
+    BasicAggregates<T> aggregates;
+
+    // Pairwise summation across blocks keeps one partial sum per level,
+    // like a binary counter: block k merges the levels of its trailing one bits
+    T partials[64];
+    size_t levels = 0;
+    // Kahan summation keeps a sum and a compensation per lane
+    T sums[lanes] = {}, compensations[lanes] = {};
+
+    for (size_t begin = 0, index = 0; begin < rowCount; begin += tileSize, ++index) {
+        size_t count = std::min(tileSize, rowCount - begin);
+        evaluator.evaluate(context, firstRow + begin, std::span<T>(block).first(count));
+        reduceBlock(aggregates, block.data(), count, threshold);
+        if (summation == Summation::Pairwise) {
+            T sum = sumPairwise(block.data(), count);
+            for (size_t k = index; k & 1; k >>= 1)
+                sum = partials[--levels] + sum;
+            partials[levels++] = sum;
+        } else {
+            addKahan(sums, compensations, block.data(), count);
+        }
+    }
+
+    if (summation == Summation::Pairwise) {
+        // The partial sums are ordered from large to small blocks
+        for (size_t level = levels; level > 0; --level)
+            aggregates.sum = partials[level - 1] + aggregates.sum;
+    } else {
+        T compensation = 0;
+        for (size_t l = 0; l < lanes; ++l) {
+            T y = sums[l] - (compensations[l] + compensation);
+            T t = aggregates.sum + y;
+            compensation = (t - aggregates.sum) - y;
+            aggregates.sum = t;
+        }
+    }
+    return aggregates;
+}
+//---------------------------------------------------------------------------
+template <typename T>
+BasicAggregates<T> BasicAggregateEvaluator<T>::evaluate(const BasicColumnarContext<T>& context) {
+    return evaluate(context, 0, context.getRowCount());
+}
+//---------------------------------------------------------------------------
+template class BasicAggregateEvaluator<float>;
+template class BasicAggregateEvaluator<double>;
+template class BasicAggregateEvaluator<long double>;
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
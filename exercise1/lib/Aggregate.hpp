@@ -0,0 +1,64 @@
+#ifndef H_lib_Aggregate
+#define H_lib_Aggregate
+//---------------------------------------------------------------------------
+#include "lib/Batch.hpp"
+#include <cstddef>
+#include <limits>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+/// How the results of many rows are summed up
+enum class Summation {
+    /// Sums of halves, the error grows with log n
+    Pairwise,
+    /// Compensated summation, the error does not grow with n
+    Kahan
+};
+//---------------------------------------------------------------------------
+/// The aggregates of an expression over a range of rows.
+/// NaN results are included in the sum but ignored by min, max and the count above the threshold.
+template <typename T>
+struct BasicAggregates {
+    size_t count = 0;
+    T sum = 0;
+    T min = std::numeric_limits<T>::infinity();
+    T max = -std::numeric_limits<T>::infinity();
+    /// The number of results greater than the threshold
+    size_t aboveCount = 0;
+
+    /// NaN if there are no rows
+    T getMean() const { return sum / static_cast<T>(count); }
+};
+//---------------------------------------------------------------------------
+/// Evaluates an expression and reduces the results block by block.
+/// Only one block of results exists at a time, it is reduced while it is
+/// still in the L1 cache, so aggregating N rows needs no buffer of N values.
+/// Not thread safe, like BasicBatchEvaluator.
+template <typename T>
+class BasicAggregateEvaluator {
+public:
+    explicit BasicAggregateEvaluator(const ASTNode& node, Summation summation = Summation::Pairwise, T threshold = std::numeric_limits<T>::infinity());
+
+    /// Aggregate the rows [firstRow, firstRow + rowCount)
+    BasicAggregates<T> evaluate(const BasicColumnarContext<T>& context, size_t firstRow, size_t rowCount);
+    /// Aggregate all rows of the context
+    BasicAggregates<T> evaluate(const BasicColumnarContext<T>& context);
+
+private:
+    BasicBatchEvaluator<T> evaluator;
+    Summation summation;
+    T threshold;
+    /// The results of the current block
+    std::vector<T> block;
+};
+//---------------------------------------------------------------------------
+using Aggregates = BasicAggregates<double>;
+using AggregateEvaluator = BasicAggregateEvaluator<double>;
+extern template class BasicAggregateEvaluator<float>;
+extern template class BasicAggregateEvaluator<double>;
+extern template class BasicAggregateEvaluator<long double>;
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,92 @@
+#include "lib/Arena.hpp"
+#include "lib/AST.hpp"
+#include <cstdint>
+#include <new>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Precedes every node, padded so that nodes stay maximally aligned
+struct alignas(std::max_align_t) NodeHeader {
+    Arena* arena;
+};
+//---------------------------------------------------------------------------
+NodeHeader* headerOf(const void* node) {
+    return reinterpret_cast<NodeHeader*>(const_cast<std::byte*>(static_cast<const std::byte*>(node))) - 1;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+void* ASTNode::operator new(std::size_t size) {
+    auto* header = static_cast<NodeHeader*>(::operator new(sizeof(NodeHeader) + size));
+    header->arena = nullptr;
+    return header + 1;
+}
+//---------------------------------------------------------------------------
+void* ASTNode::operator new(std::size_t size, Arena& arena) {
+    auto* header = static_cast<NodeHeader*>(arena.allocate(sizeof(NodeHeader) + size, alignof(NodeHeader)));
+    header->arena = &arena;
+    return header + 1;
+}
+//---------------------------------------------------------------------------
+void ASTNode::operator delete(void* ptr) {
+    if (!ptr)
+        return;
+    NodeHeader* header = headerOf(ptr);
+    // Arena memory is released with the arena
+    if (!header->arena)
+        ::operator delete(header);
+}
+//---------------------------------------------------------------------------
+void ASTNode::operator delete(void* /*ptr*/, Arena& /*arena*/) {
+}
+//---------------------------------------------------------------------------
+Arena::Arena(size_t blockSize) : blockSize(blockSize) {}
+//---------------------------------------------------------------------------
+void* Arena::allocate(size_t size, size_t alignment) {
+    while (current < blocks.size()) {
+        Block& block = blocks[current];
+        // Align the address, the block itself is only aligned to max_align_t
+        auto start = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t aligned = ((start + offset + alignment - 1) & ~(alignment - 1)) - start;
+        if (aligned + size <= block.size) {
+            offset = aligned + size;
+            usedBytes += size;
+            return block.data.get() + aligned;
+        }
+        // Blocks kept from before a reset are reused in order
+        ++current;
+        offset = 0;
+    }
+
+    // operator new[] aligns to max_align_t, larger alignments need slack
+    size_t slack = (alignment > alignof(std::max_align_t)) ? alignment : 0;
+    size_t capacity = (size + slack > blockSize) ? size + slack : blockSize;
+    blocks.push_back({std::make_unique<std::byte[]>(capacity), capacity});
+    current = blocks.size() - 1;
+    offset = 0;
+    return allocate(size, alignment);
+}
+//---------------------------------------------------------------------------
+void Arena::reset() {
+    current = 0;
+    offset = 0;
+    usedBytes = 0;
+}
+//---------------------------------------------------------------------------
+size_t Arena::getBlockCount() const {
+    return blocks.size();
+}
+//---------------------------------------------------------------------------
+size_t Arena::getUsedBytes() const {
+    return usedBytes;
+}
+//---------------------------------------------------------------------------
+Arena* Arena::of(const ASTNode& node) {
+    // The header precedes the most derived object, not necessarily the base
+    return headerOf(dynamic_cast<const void*>(&node))->arena;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
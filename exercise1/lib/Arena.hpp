@@ -0,0 +1,68 @@
+#ifndef H_lib_Arena
+#define H_lib_Arena
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+//---------------------------------------------------------------------------
+/// A bump allocator for expression trees.
+/// Nodes created with make() live in a few large blocks. Deleting such a node
+/// (e.g. when optimize() replaces it) does not free anything, so the usual
+/// unique_ptr ownership keeps working. To drop a whole tree in O(1), release()
+/// its root instead of destroying it and reset() or destroy the arena; node
+/// destructors are never run for arena memory. All nodes of an arena tree must
+/// come from the same arena.
+class Arena {
+public:
+    explicit Arena(size_t blockSize = 64 * 1024);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /// Create a node inside the arena
+    template <typename T, typename... Args>
+    std::unique_ptr<T> make(Args&&... args) {
+        return std::unique_ptr<T>(new (*this) T(std::forward<Args>(args)...));
+    }
+
+    /// Raw memory with the given alignment
+    void* allocate(size_t size, size_t alignment);
+    /// Forget all allocations but keep the blocks for reuse
+    void reset();
+
+    size_t getBlockCount() const;
+    /// The number of bytes handed out since the last reset
+    size_t getUsedBytes() const;
+
+    /// The arena a node was created in, nullptr for heap nodes.
+    /// Only valid for nodes created with new, not for nodes on the stack.
+    static Arena* of(const ASTNode& node);
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    size_t blockSize;
+    std::vector<Block> blocks;
+    size_t current = 0;
+    size_t offset = 0;
+    size_t usedBytes = 0;
+};
+//---------------------------------------------------------------------------
+/// Create a node in the given arena, or on the heap if arena is null
+template <typename T, typename... Args>
+std::unique_ptr<T> makeNode(Arena* arena, Args&&... args) {
+    if (arena)
+        return arena->make<T>(std::forward<Args>(args)...);
+    return std::make_unique<T>(std::forward<Args>(args)...);
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,319 @@
+#include "lib/Batch.hpp"
+#include "lib/ColumnarContext.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <unistd.h>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The size of the L1 data cache, 32 KiB if it cannot be detected
+size_t getL1CacheSize() {
+    static const size_t size = [] {
+        long size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+        return size > 0 ? static_cast<size_t>(size) : 32 * 1024;
+    }();
+    return size;
+}
+//---------------------------------------------------------------------------
+/// Round tileSize up to the tile alignment and clamp it to the largest tile size
+size_t alignTileSize(size_t tileSize) {
+    constexpr size_t alignment = BatchEvaluator::tileAlignment;
+    return std::clamp((tileSize + alignment - 1) / alignment * alignment, alignment, BatchEvaluator::maxTileSize);
+}
+//---------------------------------------------------------------------------
+/// The largest tile size whose entries of elementSize bytes per row fill half of the L1 data cache
+size_t getCacheTileSize(size_t entries, size_t elementSize) {
+    size_t rowSize = std::max<size_t>(entries, 1) * elementSize;
+    // Round down, the tile must not exceed the cache
+    constexpr size_t alignment = BatchEvaluator::tileAlignment;
+    return alignTileSize(getL1CacheSize() / 2 / rowSize / alignment * alignment);
+}
+//---------------------------------------------------------------------------
+/// Run program for count rows, the stack and the slots hold tileSize values per entry.
+/// The rows are [row, row + count) if rows is null and rows[0, count) otherwise.
+template <typename T>
+void evaluateTile(const Program& program, const BasicKernels<T>& kernels, T* stack, T* slots, size_t tileSize, const BasicColumnarContext<T>& context, size_t row, const uint32_t* rows, size_t count, T* out) {
+    const double* constants = program.getConstants().data();
+    // top points one past the topmost stack tile
+    T* top = stack;
+
+    const Program::Instruction* previous = nullptr;
+    for (const auto& instruction : program.getInstructions()) {
+        // The binary operators below still see the previous instruction
+        const Program::Instruction* before = previous;
+        previous = &instruction;
+        T* a = top - tileSize;
+        switch (instruction.opCode) {
+            case Program::OpCode::PushConstant:
+                std::fill_n(top, count, static_cast<T>(constants[instruction.operand]));
+                top += tileSize;
+                continue;
+            case Program::OpCode::PushParameter: {
+                auto column = context.getColumn(instruction.operand);
+                if (column.empty()) {
+                    std::fill_n(top, count, T(0));
+                } else if (rows) {
+                    for (size_t i = 0; i < count; ++i)
+                        top[i] = column[rows[i]];
+                } else {
+                    std::copy_n(column.data() + row, count, top);
+                }
+                top += tileSize;
+                continue;
+            }
+            case Program::OpCode::Negate:
+                kernels.negate(a, count);
+                continue;
+            case Program::OpCode::SquareRoot:
+                kernels.squareRoot(a, count);
+                continue;
+            case Program::OpCode::Store:
+                std::copy_n(a, count, slots + instruction.operand * tileSize);
+                continue;
+            case Program::OpCode::Load:
+                std::copy_n(slots + instruction.operand * tileSize, count, top);
+                top += tileSize;
+                continue;
+            case Program::OpCode::FusedMultiplyAdd:
+            case Program::OpCode::FusedMultiplySubtract: {
+                // Combine the three topmost tiles into a
+                top -= 2 * tileSize;
+                a = top - tileSize;
+                if (instruction.opCode == Program::OpCode::FusedMultiplyAdd)
+                    kernels.multiplyAdd(a, top, top + tileSize, count);
+                else
+                    kernels.multiplySubtract(a, top, top + tileSize, count);
+                continue;
+            }
+            default:
+                break;
+        }
+
+        // Binary operators combine the two topmost tiles into a
+        top -= tileSize;
+        a = top - tileSize;
+        const T* b = top;
+        switch (instruction.opCode) {
+            case Program::OpCode::Add: kernels.add(a, b, count); break;
+            case Program::OpCode::Subtract: kernels.subtract(a, b, count); break;
+            case Program::OpCode::Multiply: kernels.multiply(a, b, count); break;
+            case Program::OpCode::Divide: kernels.divide(a, b, count); break;
+            case Program::OpCode::Power:
+                // Constant exponents have cheaper special cases
+                if (before && before->opCode == Program::OpCode::PushConstant)
+                    kernels.powerConstant(a, static_cast<T>(constants[before->operand]), count);
+                else
+                    kernels.power(a, b, count);
+                break;
+            default:
+                break;
+        }
+    }
+    std::copy_n(top - tileSize, count, out);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+template <typename T>
+BasicBatchEvaluator<T>::BasicBatchEvaluator(const ASTNode& node) : BasicBatchEvaluator(node, InstructionSets::getBestISA()) {}
+//---------------------------------------------------------------------------
+template <typename T>
+BasicBatchEvaluator<T>::BasicBatchEvaluator(const ASTNode& node, InstructionSets::ISA isa) : BasicBatchEvaluator(node, isa, 0) {}
+//---------------------------------------------------------------------------
+template <typename T>
+BasicBatchEvaluator<T>::BasicBatchEvaluator(const ASTNode& node, InstructionSets::ISA isa, size_t tileSize)
+    : program(Program::compile(node)), kernels(BasicKernels<T>::get(isa)),
+      tileSize(tileSize ? alignTileSize(tileSize) : getCacheTileSize(program.getMaxStackDepth() + program.getSlotCount(), sizeof(T))),
+      stack(program.getMaxStackDepth() * this->tileSize), slots(program.getSlotCount() * this->tileSize) {}
+//---------------------------------------------------------------------------
+template <typename T>
+void BasicBatchEvaluator<T>::evaluate(const BasicColumnarContext<T>& context, size_t firstRow, std::span<T> out) {
+    for (size_t begin = 0; begin < out.size(); begin += tileSize) {
+        size_t count = std::min(tileSize, out.size() - begin);
+        evaluateTile(program, kernels, stack.data(), slots.data(), tileSize, context, firstRow + begin, nullptr, count, out.data() + begin);
+    }
+}
+//---------------------------------------------------------------------------
+template <typename T>
+void BasicBatchEvaluator<T>::evaluate(const BasicColumnarContext<T>& context, std::span<T> out) {
+    evaluate(context, 0, out);
+}
+//---------------------------------------------------------------------------
+template <typename T>
+void BasicBatchEvaluator<T>::evaluate(const BasicColumnarContext<T>& context, std::span<const uint32_t> selection, std::span<T> out) {
+    results.resize(tileSize);
+    for (size_t begin = 0; begin < selection.size();) {
+        // The selected rows within the tile of rows that starts at the next selected row
+        size_t first = selection[begin];
+        auto limit = selection.begin() + std::min(selection.size(), begin + tileSize);
+        size_t end = std::lower_bound(selection.begin() + begin, limit, first + tileSize) - selection.begin();
+        size_t count = end - begin;
+        size_t spread = selection[end - 1] - first + 1;
+        if (isDense(spread, count)) {
+            if (spread == count) {
+                // A contiguous range needs no discards
+                evaluateTile(program, kernels, stack.data(), slots.data(), tileSize, context, first, nullptr, count, out.data() + begin);
+            } else {
+                evaluateTile(program, kernels, stack.data(), slots.data(), tileSize, context, first, nullptr, spread, results.data());
+                for (size_t i = begin; i < end; ++i)
+                    out[i] = results[selection[i] - first];
+            }
+        } else {
+            count = std::min(tileSize, selection.size() - begin);
+            evaluateTile(program, kernels, stack.data(), slots.data(), tileSize, context, 0, selection.data() + begin, count, out.data() + begin);
+        }
+        begin += count;
+    }
+}
+//---------------------------------------------------------------------------
+template <typename T>
+void BasicBatchEvaluator<T>::evaluateMasked(const BasicColumnarContext<T>& context, std::span<const uint64_t> mask, std::span<T> out) {
+    rows.resize(2 * tileSize);
+    results.resize(tileSize);
+    // The sparse rows of several tiles are collected into full tiles first
+    size_t pending = 0;
+    auto flush = [&](size_t count) {
+        evaluateTile(program, kernels, stack.data(), slots.data(), tileSize, context, 0, rows.data(), count, results.data());
+        for (size_t i = 0; i < count; ++i)
+            out[rows[i]] = results[i];
+        std::copy(rows.begin() + count, rows.begin() + pending, rows.begin());
+        pending -= count;
+    };
+
+    for (size_t begin = 0; begin < out.size(); begin += tileSize) {
+        size_t tileRows = std::min(tileSize, out.size() - begin);
+        // The bits of the tile, without the bits past the last row
+        uint64_t words[maxTileSize / 64] = {};
+        size_t wordCount = (tileRows + 63) / 64;
+        std::copy_n(mask.data() + begin / 64, wordCount, words);
+        if (tileRows % 64)
+            words[wordCount - 1] &= (uint64_t(1) << (tileRows % 64)) - 1;
+
+        size_t count = 0, first = tileSize, last = 0;
+        for (size_t w = 0; w < wordCount; ++w) {
+            if (!words[w])
+                continue;
+            count += std::popcount(words[w]);
+            first = std::min(first, w * 64 + std::countr_zero(words[w]));
+            last = w * 64 + 63 - std::countl_zero(words[w]);
+        }
+        if (!count)
+            continue;
+        if (isDense(last - first + 1, count)) {
+            // Unselected rows may be overwritten, so the results go directly into out
+            evaluateTile(program, kernels, stack.data(), slots.data(), tileSize, context, begin + first, nullptr, last - first + 1, out.data() + begin + first);
+            continue;
+        }
+        uint32_t* selection = rows.data() + pending;
+        for (size_t w = 0; w < wordCount; ++w)
+            for (uint64_t word = words[w]; word; word &= word - 1)
+                *selection++ = begin + w * 64 + std::countr_zero(word);
+        pending += count;
+        if (pending >= tileSize)
+            flush(tileSize);
+    }
+    if (pending)
+        flush(pending);
+}
+//---------------------------------------------------------------------------
+template <typename T>
+const Program& BasicBatchEvaluator<T>::getProgram() const {
+    return program;
+}
+//---------------------------------------------------------------------------
+template <typename T>
+size_t BasicBatchEvaluator<T>::getTileSize() const {
+    return tileSize;
+}
+//---------------------------------------------------------------------------
+template <typename T>
+BasicMultiBatchEvaluator<T>::BasicMultiBatchEvaluator(std::span<const ASTNode* const> nodes) : BasicMultiBatchEvaluator(nodes, InstructionSets::getBestISA()) {}
+//---------------------------------------------------------------------------
+template <typename T>
+BasicMultiBatchEvaluator<T>::BasicMultiBatchEvaluator(std::span<const ASTNode* const> nodes, InstructionSets::ISA isa) : BasicMultiBatchEvaluator(nodes, isa, 0) {}
+//---------------------------------------------------------------------------
+template <typename T>
+BasicMultiBatchEvaluator<T>::BasicMultiBatchEvaluator(std::span<const ASTNode* const> nodes, InstructionSets::ISA isa, size_t tileSize)
+    : programs(Program::compile(nodes)), kernels(BasicKernels<T>::get(isa)) {
+    size_t depth = 0;
+    for (const auto& program : programs)
+        depth = std::max(depth, program.getMaxStackDepth());
+    size_t slotCount = programs.empty() ? 0 : programs.front().getSlotCount();
+    this->tileSize = tileSize ? alignTileSize(tileSize) : getCacheTileSize(depth + slotCount, sizeof(T));
+    stack.resize(depth * this->tileSize);
+    slots.resize(slotCount * this->tileSize);
+}
+//---------------------------------------------------------------------------
+template <typename T>
+void BasicMultiBatchEvaluator<T>::evaluate(const BasicColumnarContext<T>& context, size_t firstRow, std::span<const std::span<T>> outputs) {
+    size_t rowCount = outputs.empty() ? 0 : outputs.front().size();
+    for (size_t begin = 0; begin < rowCount; begin += tileSize) {
+        size_t count = std::min(tileSize, rowCount - begin);
+        // All expressions run on the same tile, so its columns and shared
+        // subexpressions are still in the cache for the later ones
+        for (size_t i = 0; i < programs.size(); ++i)
+            evaluateTile(programs[i], kernels, stack.data(), slots.data(), tileSize, context, firstRow + begin, nullptr, count, outputs[i].data() + begin);
+    }
+}
+//---------------------------------------------------------------------------
+template <typename T>
+void BasicMultiBatchEvaluator<T>::evaluate(const BasicColumnarContext<T>& context, std::span<const std::span<T>> outputs) {
+    evaluate(context, 0, outputs);
+}
+//---------------------------------------------------------------------------
+template <typename T>
+size_t BasicMultiBatchEvaluator<T>::getExpressionCount() const {
+    return programs.size();
+}
+//---------------------------------------------------------------------------
+template <typename T>
+const std::vector<Program>& BasicMultiBatchEvaluator<T>::getPrograms() const {
+    return programs;
+}
+//---------------------------------------------------------------------------
+template <typename T>
+size_t BasicMultiBatchEvaluator<T>::getTileSize() const {
+    return tileSize;
+}
+//---------------------------------------------------------------------------
+template <typename T>
+size_t autotuneTileSize(const ASTNode& node, const BasicColumnarContext<T>& context) {
+    using Clock = std::chrono::steady_clock;
+    // Enough rows for many tiles of every size, but quick to evaluate
+    size_t rowCount = std::min<size_t>(context.getRowCount(), 16 * BasicBatchEvaluator<T>::maxTileSize);
+    std::vector<T> out(rowCount);
+    size_t bestTileSize = 0;
+    auto bestTime = Clock::duration::max();
+    for (size_t tileSize = BasicBatchEvaluator<T>::tileAlignment; tileSize <= BasicBatchEvaluator<T>::maxTileSize; tileSize *= 2) {
+        BasicBatchEvaluator<T> evaluator(node, InstructionSets::getBestISA(), tileSize);
+        // The first run warms up the caches, the best of the others counts
+        auto time = Clock::duration::max();
+        for (unsigned run = 0; run < 4; ++run) {
+            auto start = Clock::now();
+            evaluator.evaluate(context, out);
+            if (run)
+                time = std::min(time, Clock::now() - start);
+        }
+        if (time < bestTime) {
+            bestTime = time;
+            bestTileSize = tileSize;
+        }
+    }
+    return bestTileSize;
+}
+//---------------------------------------------------------------------------
+template class BasicBatchEvaluator<float>;
+template class BasicBatchEvaluator<double>;
+template class BasicBatchEvaluator<long double>;
+template class BasicMultiBatchEvaluator<float>;
+template class BasicMultiBatchEvaluator<double>;
+template class BasicMultiBatchEvaluator<long double>;
+template size_t autotuneTileSize(const ASTNode& node, const BasicColumnarContext<float>& context);
+template size_t autotuneTileSize(const ASTNode& node, const BasicColumnarContext<double>& context);
+template size_t autotuneTileSize(const ASTNode& node, const BasicColumnarContext<long double>& context);
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
@@ -0,0 +1,148 @@
+#ifndef H_lib_Batch
+#define H_lib_Batch
+//---------------------------------------------------------------------------
+#include "lib/ColumnarContext.hpp"
+#include "lib/Kernels.hpp"
+#include "lib/Program.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+//---------------------------------------------------------------------------
+/// Evaluates an expression over many rows at once.
+/// The expression is compiled into a Program whose instructions operate on
+/// tiles of rows instead of single values, so the dispatch of every
+/// instruction is amortized over a whole tile. The arithmetic runs in the
+/// vectorized Kernels for the best instruction set of the CPU. T is the type
+/// of the parameters, the results and all intermediate values: float halves
+/// the memory traffic and doubles the vector width, long double serves as a
+/// more precise reference. Not thread safe, the tile buffers are reused
+/// between calls.
+///
+/// The whole program runs on one tile before the next tile starts. By default
+/// the tile size is chosen so that the stack and the slots of a tile fill
+/// half of the L1 data cache, then all intermediate results stay in L1 and
+/// only the parameters and the results go to memory. Larger tiles amortize
+/// the dispatch better, smaller tiles leave more room for the parameter
+/// columns; autotuneTileSize() measures the best size for an expression.
+///
+/// Rows that were filtered out upstream can be skipped with a selection
+/// vector or a bitmask. Every tile of selected rows is evaluated either
+/// sparsely, gathering only the selected rows of the parameter columns, or
+/// densely over all rows it spans, discarding the unselected results. Dense
+/// evaluation is chosen when the selected rows span at most denseSpread times
+/// as many rows, there the contiguous loads are cheaper than the gathers.
+template <typename T>
+class BasicBatchEvaluator {
+public:
+    /// Tile sizes are multiples of this, it covers the widest vectors and one bitmask word
+    static constexpr size_t tileAlignment = 64;
+    /// The largest tile size
+    static constexpr size_t maxTileSize = 4096;
+    /// The largest ratio of spanned to selected rows that is evaluated densely
+    static constexpr size_t denseSpread = 2;
+    /// Whether count selected rows that span spread rows are evaluated densely
+    static constexpr bool isDense(size_t spread, size_t count) { return spread <= denseSpread * count; }
+
+    explicit BasicBatchEvaluator(const ASTNode& node);
+    /// Use the kernels of a specific instruction set
+    BasicBatchEvaluator(const ASTNode& node, InstructionSets::ISA isa);
+    /// Use tiles of tileSize rows, rounded up to the tile alignment. A
+    /// tileSize of 0 sizes the tiles from the L1 data cache.
+    BasicBatchEvaluator(const ASTNode& node, InstructionSets::ISA isa, size_t tileSize);
+
+    /// Evaluate the rows [firstRow, firstRow + out.size()) into out.
+    /// Every column of the context must contain these rows.
+    void evaluate(const BasicColumnarContext<T>& context, size_t firstRow, std::span<T> out);
+    /// Evaluate the first out.size() rows
+    void evaluate(const BasicColumnarContext<T>& context, std::span<T> out);
+    /// Evaluate the rows of selection into out, out[i] is the result of row
+    /// selection[i]. The selection must be in ascending order and out must
+    /// have the same size.
+    void evaluate(const BasicColumnarContext<T>& context, std::span<const uint32_t> selection, std::span<T> out);
+    /// Evaluate the rows [0, out.size()) whose bit is set in mask, bit r % 64
+    /// of mask[r / 64] selects row r. The results of unselected rows in out
+    /// are unspecified.
+    void evaluateMasked(const BasicColumnarContext<T>& context, std::span<const uint64_t> mask, std::span<T> out);
+
+    const Program& getProgram() const;
+    /// The number of rows processed per instruction
+    size_t getTileSize() const;
+
+private:
+    Program program;
+    const BasicKernels<T>& kernels;
+    size_t tileSize;
+    /// The stack and the slots hold tileSize values per entry
+    std::vector<T> stack;
+    std::vector<T> slots;
+    /// The rows and results of a tile with a selection
+    std::vector<uint32_t> rows;
+    std::vector<T> results;
+};
+//---------------------------------------------------------------------------
+/// Evaluates many expressions over the same rows in one pass.
+/// The expressions are imported into a NodeFactory, so structurally identical
+/// subtrees are shared between them and computed once per tile. Every tile
+/// of rows runs all expressions before the next tile starts, which reads
+/// each parameter column tile from memory once and writes all outputs of the
+/// tile. The tiles are sized like in BasicBatchEvaluator, from the stack and
+/// the shared slots of all expressions. Not thread safe.
+template <typename T>
+class BasicMultiBatchEvaluator {
+public:
+    explicit BasicMultiBatchEvaluator(std::span<const ASTNode* const> nodes);
+    BasicMultiBatchEvaluator(std::span<const ASTNode* const> nodes, InstructionSets::ISA isa);
+    /// A tileSize of 0 sizes the tiles from the L1 data cache
+    BasicMultiBatchEvaluator(std::span<const ASTNode* const> nodes, InstructionSets::ISA isa, size_t tileSize);
+
+    /// Evaluate the rows [firstRow, firstRow + n) of expression i into
+    /// outputs[i]. There is one output per expression, all of the same size n.
+    void evaluate(const BasicColumnarContext<T>& context, size_t firstRow, std::span<const std::span<T>> outputs);
+    /// Evaluate the first rows
+    void evaluate(const BasicColumnarContext<T>& context, std::span<const std::span<T>> outputs);
+
+    size_t getExpressionCount() const;
+    /// One program per expression, they share their slots
+    const std::vector<Program>& getPrograms() const;
+    size_t getTileSize() const;
+
+private:
+    std::vector<Program> programs;
+    const BasicKernels<T>& kernels;
+    size_t tileSize = 0;
+    std::vector<T> stack;
+    std::vector<T> slots;
+};
+//---------------------------------------------------------------------------
+using BatchEvaluator = BasicBatchEvaluator<double>;
+using MultiBatchEvaluator = BasicMultiBatchEvaluator<double>;
+extern template class BasicBatchEvaluator<float>;
+extern template class BasicBatchEvaluator<double>;
+extern template class BasicBatchEvaluator<long double>;
+extern template class BasicMultiBatchEvaluator<float>;
+extern template class BasicMultiBatchEvaluator<double>;
+extern template class BasicMultiBatchEvaluator<long double>;
+//---------------------------------------------------------------------------
+/// Measure the evaluation of node over the first rows of context with
+/// power-of-two tile sizes and return the fastest one
+template <typename T>
+size_t autotuneTileSize(const ASTNode& node, const BasicColumnarContext<T>& context);
+extern template size_t autotuneTileSize(const ASTNode& node, const BasicColumnarContext<float>& context);
+extern template size_t autotuneTileSize(const ASTNode& node, const BasicColumnarContext<double>& context);
+extern template size_t autotuneTileSize(const ASTNode& node, const BasicColumnarContext<long double>& context);
+//---------------------------------------------------------------------------
+/// Evaluate node for the first out.size() rows of context
+template <typename T>
+void evaluateBatch(const ASTNode& node, const BasicColumnarContext<T>& context, std::type_identity_t<std::span<T>> out) {
+    BasicBatchEvaluator<T>(node).evaluate(context, out);
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,242 @@
+#include "lib/Closure.hpp"
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <tuple>
+#include <utility>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+using Closure = ClosureFunction::Closure;
+using Operand = ClosureFunction::Operand;
+using Function = double (*)(const Closure&, const double*);
+//---------------------------------------------------------------------------
+/// The operand kinds a closure is specialized for
+enum Kind { ConstantKind,
+            ParameterKind,
+            ClosureKind };
+//---------------------------------------------------------------------------
+struct ConstantOperand {
+    static double get(const Operand& o, const double* /*params*/) { return o.constant; }
+};
+struct ParameterOperand {
+    static double get(const Operand& o, const double* params) { return params[o.parameter]; }
+};
+struct ClosureOperand {
+    static double get(const Operand& o, const double* params) { return o.closure->function(*o.closure, params); }
+};
+//---------------------------------------------------------------------------
+struct AddOp {
+    static double apply(double a, double b) { return a + b; }
+};
+struct SubtractOp {
+    static double apply(double a, double b) { return a - b; }
+};
+struct MultiplyOp {
+    static double apply(double a, double b) { return a * b; }
+};
+struct DivideOp {
+    static double apply(double a, double b) { return a / b; }
+};
+struct PowerOp {
+    static double apply(double a, double b) { return std::pow(a, b); }
+};
+struct IntegerPowerOp {
+    static double apply(double a, double n) { return IntegerPower::apply(a, n); }
+};
+//---------------------------------------------------------------------------
+template <typename O>
+double leaf(const Closure& self, const double* params) {
+    return O::get(self.operands[0], params);
+}
+//---------------------------------------------------------------------------
+template <typename O>
+double negate(const Closure& self, const double* params) {
+    return -O::get(self.operands[0], params);
+}
+//---------------------------------------------------------------------------
+template <typename O>
+double squareRoot(const Closure& self, const double* params) {
+    return SquareRoot::apply(O::get(self.operands[0], params));
+}
+//---------------------------------------------------------------------------
+template <typename Op, typename L, typename R>
+double binary(const Closure& self, const double* params) {
+    return Op::apply(L::get(self.operands[0], params), R::get(self.operands[1], params));
+}
+//---------------------------------------------------------------------------
+template <typename Op, typename A, typename B, typename C>
+double ternary(const Closure& self, const double* params) {
+    return Op::apply(A::get(self.operands[0], params), B::get(self.operands[1], params), C::get(self.operands[2], params));
+}
+//---------------------------------------------------------------------------
+constexpr Function leafTable[3] = {leaf<ConstantOperand>, leaf<ParameterOperand>, leaf<ClosureOperand>};
+constexpr Function negateTable[3] = {negate<ConstantOperand>, negate<ParameterOperand>, negate<ClosureOperand>};
+constexpr Function squareRootTable[3] = {squareRoot<ConstantOperand>, squareRoot<ParameterOperand>, squareRoot<ClosureOperand>};
+//---------------------------------------------------------------------------
+template <typename Op>
+constexpr Function binaryTable[3][3] = {
+    {binary<Op, ConstantOperand, ConstantOperand>, binary<Op, ConstantOperand, ParameterOperand>, binary<Op, ConstantOperand, ClosureOperand>},
+    {binary<Op, ParameterOperand, ConstantOperand>, binary<Op, ParameterOperand, ParameterOperand>, binary<Op, ParameterOperand, ClosureOperand>},
+    {binary<Op, ClosureOperand, ConstantOperand>, binary<Op, ClosureOperand, ParameterOperand>, binary<Op, ClosureOperand, ClosureOperand>}};
+//---------------------------------------------------------------------------
+/// The operand of a kind
+template <size_t kind>
+using OperandOf = std::tuple_element_t<kind, std::tuple<ConstantOperand, ParameterOperand, ClosureOperand>>;
+//---------------------------------------------------------------------------
+/// Indexed by kind(a) * 9 + kind(b) * 3 + kind(c)
+template <typename Op, size_t... I>
+constexpr std::array<Function, sizeof...(I)> makeTernaryTable(std::index_sequence<I...>) {
+    return {ternary<Op, OperandOf<I / 9>, OperandOf<I / 3 % 3>, OperandOf<I % 3>>...};
+}
+template <typename Op>
+constexpr auto ternaryTable = makeTernaryTable<Op>(std::make_index_sequence<27>());
+//---------------------------------------------------------------------------
+/// Skip over unary plus, it does not change the value
+const ASTNode& skipPlus(const ASTNode& node) {
+    const ASTNode* current = &node;
+    while (current->getType() == ASTNode::Type::UnaryPlus)
+        current = &static_cast<const UnaryASTNode*>(current)->getInput();
+    return *current;
+}
+//---------------------------------------------------------------------------
+size_t countNodes(const ASTNode& node) {
+    switch (node.getType()) {
+        case ASTNode::Type::Constant:
+        case ASTNode::Type::Parameter:
+            return 1;
+        case ASTNode::Type::UnaryPlus:
+        case ASTNode::Type::UnaryMinus:
+        case ASTNode::Type::SquareRoot:
+            return 1 + countNodes(static_cast<const UnaryASTNode&>(node).getInput());
+        case ASTNode::Type::FusedMultiplyAdd:
+        case ASTNode::Type::FusedMultiplySubtract: {
+            const auto& ternary = static_cast<const TernaryASTNode&>(node);
+            return 1 + countNodes(ternary.getFirst()) + countNodes(ternary.getSecond()) + countNodes(ternary.getThird());
+        }
+        default: {
+            const auto& binary = static_cast<const BinaryASTNode&>(node);
+            return 1 + countNodes(binary.getLeft()) + countNodes(binary.getRight());
+        }
+    }
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+/// Builds the closures bottom up
+class ClosureCompiler {
+public:
+    explicit ClosureCompiler(ClosureFunction& function) : function(function) {}
+
+    /// Compile a node into a new closure
+    const Closure& compileClosure(const ASTNode& node);
+
+private:
+    /// Turn a node into an operand, leaves are stored inline
+    Kind compileOperand(const ASTNode& node, Operand& operand);
+
+    ClosureFunction& function;
+};
+//---------------------------------------------------------------------------
+Kind ClosureCompiler::compileOperand(const ASTNode& node, Operand& operand) {
+    const ASTNode& target = skipPlus(node);
+    switch (target.getType()) {
+        case ASTNode::Type::Constant:
+            operand.constant = static_cast<const Constant&>(target).getValue();
+            return ConstantKind;
+        case ASTNode::Type::Parameter:
+            operand.parameter = static_cast<const Parameter&>(target).getIndex();
+            function.parameterCount = std::max(function.parameterCount, operand.parameter + 1);
+            return ParameterKind;
+        default:
+            operand.closure = &compileClosure(target);
+            return ClosureKind;
+    }
+}
+//---------------------------------------------------------------------------
+const Closure& ClosureCompiler::compileClosure(const ASTNode& node) {
+    Closure closure{};
+    const ASTNode& target = skipPlus(node);
+    switch (target.getType()) {
+        case ASTNode::Type::Constant:
+        case ASTNode::Type::Parameter:
+            closure.function = leafTable[compileOperand(target, closure.operands[0])];
+            break;
+        case ASTNode::Type::UnaryMinus:
+            closure.function = negateTable[compileOperand(static_cast<const UnaryASTNode&>(target).getInput(), closure.operands[0])];
+            break;
+        case ASTNode::Type::SquareRoot:
+            closure.function = squareRootTable[compileOperand(static_cast<const UnaryASTNode&>(target).getInput(), closure.operands[0])];
+            break;
+        case ASTNode::Type::FusedMultiplyAdd:
+        case ASTNode::Type::FusedMultiplySubtract: {
+            const auto& ternary = static_cast<const TernaryASTNode&>(target);
+            size_t a = compileOperand(ternary.getFirst(), closure.operands[0]);
+            size_t b = compileOperand(ternary.getSecond(), closure.operands[1]);
+            size_t c = compileOperand(ternary.getThird(), closure.operands[2]);
+            size_t index = a * 9 + b * 3 + c;
+            if (target.getType() == ASTNode::Type::FusedMultiplyAdd)
+                closure.function = ternaryTable<FusedMultiplyAdd>[index];
+            else
+                closure.function = ternaryTable<FusedMultiplySubtract>[index];
+            break;
+        }
+        default: {
+            const auto& binary = static_cast<const BinaryASTNode&>(target);
+            Kind left = compileOperand(binary.getLeft(), closure.operands[0]);
+            Kind right = compileOperand(binary.getRight(), closure.operands[1]);
+            switch (target.getType()) {
+                case ASTNode::Type::Add: closure.function = binaryTable<AddOp>[left][right]; break;
+                case ASTNode::Type::Subtract: closure.function = binaryTable<SubtractOp>[left][right]; break;
+                case ASTNode::Type::Multiply: closure.function = binaryTable<MultiplyOp>[left][right]; break;
+                case ASTNode::Type::Divide: closure.function = binaryTable<DivideOp>[left][right]; break;
+                case ASTNode::Type::IntegerPower: closure.function = binaryTable<IntegerPowerOp>[left][right]; break;
+                default: closure.function = binaryTable<PowerOp>[left][right]; break;
+            }
+            break;
+        }
+    }
+    // The vector was reserved for every node, so earlier closures stay in place
+    function.closures.push_back(closure);
+    return function.closures.back();
+}
+//---------------------------------------------------------------------------
+ClosureFunction ClosureFunction::compile(const ASTNode& node) {
+    ClosureFunction function;
+    function.closures.reserve(countNodes(node));
+    ClosureCompiler(function).compileClosure(node);
+    return function;
+}
+//---------------------------------------------------------------------------
+double ClosureFunction::operator()(const double* params) const {
+    const Closure& root = closures.back();
+    return root.function(root, params);
+}
+//---------------------------------------------------------------------------
+double ClosureFunction::evaluate(const EvaluationContext& context) const {
+    constexpr size_t inlineCount = 16;
+    double inlineParams[inlineCount];
+    std::vector<double> heapParams;
+    double* params = inlineParams;
+    if (parameterCount > inlineCount) {
+        heapParams.resize(parameterCount);
+        params = heapParams.data();
+    }
+    context.copyParameters(params, parameterCount);
+    return (*this)(params);
+}
+//---------------------------------------------------------------------------
+size_t ClosureFunction::getParameterCount() const {
+    return parameterCount;
+}
+//---------------------------------------------------------------------------
+size_t ClosureFunction::getClosureCount() const {
+    return closures.size();
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
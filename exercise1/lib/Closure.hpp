@@ -0,0 +1,62 @@
+#ifndef H_lib_Closure
+#define H_lib_Closure
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+class EvaluationContext;
+//---------------------------------------------------------------------------
+/// An expression tree compiled into a chain of specialized closures.
+/// Every operator becomes a function pointer instantiated for the kind of its
+/// operands (constant, parameter or nested closure), e.g. Add(Param, Const)
+/// reads params[i] + c without any virtual call or bounds check. Needs no
+/// executable memory, so it is the fallback where the JIT is not allowed.
+class ClosureFunction {
+public:
+    struct Closure;
+
+    /// A single operand, which member is used depends on the closure's function
+    struct Operand {
+        const Closure* closure = nullptr;
+        double constant = 0.0;
+        size_t parameter = 0;
+    };
+
+    /// A compiled node
+    struct Closure {
+        double (*function)(const Closure& self, const double* params);
+        Operand operands[3];
+    };
+
+    /// Compile a tree
+    static ClosureFunction compile(const ASTNode& node);
+
+    ClosureFunction(ClosureFunction&&) = default;
+    ClosureFunction& operator=(ClosureFunction&&) = default;
+
+    /// Evaluate, params must hold at least getParameterCount() values
+    double operator()(const double* params) const;
+    /// Evaluate with the same out of range semantics as EvaluationContext
+    double evaluate(const EvaluationContext& context) const;
+    /// One more than the largest parameter index used by the expression
+    size_t getParameterCount() const;
+    /// The number of closures, leaves that are folded into their parent do not count
+    size_t getClosureCount() const;
+
+private:
+    ClosureFunction() = default;
+
+    friend class ClosureCompiler;
+
+    /// The closures, the root is the last one. Operands point into this vector,
+    /// so it is sized once and never reallocated.
+    std::vector<Closure> closures;
+    size_t parameterCount = 0;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
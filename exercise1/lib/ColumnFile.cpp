@@ -0,0 +1,141 @@
+#include "lib/ColumnFile.hpp"
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// pread until all bytes are read, false on errors and at the end of the file
+bool readFully(int fd, void* data, size_t size, uint64_t offset) {
+    auto* bytes = static_cast<char*>(data);
+    while (size) {
+        ssize_t result = pread(fd, bytes, size, static_cast<off_t>(offset));
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        bytes += result;
+        size -= result;
+        offset += result;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+/// pwrite until all bytes are written
+bool writeFully(int fd, const void* data, size_t size, uint64_t offset) {
+    const auto* bytes = static_cast<const char*>(data);
+    while (size) {
+        ssize_t result = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        bytes += result;
+        size -= result;
+        offset += result;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+uint64_t ColumnFile::getOffset(uint64_t rowCount, size_t column, size_t row) {
+    return headerSize + (column * rowCount + row) * sizeof(double);
+}
+//---------------------------------------------------------------------------
+std::optional<uint64_t> ColumnFile::getFileSize(uint64_t columnCount, uint64_t rowCount) {
+    // The checks keep every offset within the file representable as well
+    constexpr uint64_t maxData = static_cast<uint64_t>(std::numeric_limits<off_t>::max()) - headerSize;
+    if (rowCount > maxData / sizeof(double))
+        return std::nullopt;
+    uint64_t columnSize = rowCount * sizeof(double);
+    if (columnSize && columnCount > maxData / columnSize)
+        return std::nullopt;
+    return headerSize + columnCount * columnSize;
+}
+//---------------------------------------------------------------------------
+ColumnFileReader::ColumnFileReader(int fd, size_t columnCount, size_t rowCount) : fd(fd), columnCount(columnCount), rowCount(rowCount) {}
+//---------------------------------------------------------------------------
+ColumnFileReader::~ColumnFileReader() {
+    close(fd);
+}
+//---------------------------------------------------------------------------
+std::unique_ptr<ColumnFileReader> ColumnFileReader::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+    ColumnFile::Header header;
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (!readFully(fd, &header, sizeof(header), 0) || std::memcmp(header.magic, ColumnFile::magic, sizeof(header.magic)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    // A crafted header must not wrap the size around
+    auto expected = ColumnFile::getFileSize(header.columnCount, header.rowCount);
+    if (!expected || size < 0 || static_cast<uint64_t>(size) < *expected) {
+        close(fd);
+        return nullptr;
+    }
+    // The file is read front to back, one chunk of every column at a time
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return std::unique_ptr<ColumnFileReader>(new ColumnFileReader(fd, header.columnCount, header.rowCount));
+}
+//---------------------------------------------------------------------------
+bool ColumnFileReader::read(size_t column, size_t firstRow, std::span<double> out) const {
+    if (column >= columnCount || firstRow + out.size() > rowCount)
+        return false;
+    return readFully(fd, out.data(), out.size_bytes(), ColumnFile::getOffset(rowCount, column, firstRow));
+}
+//---------------------------------------------------------------------------
+size_t ColumnFileReader::getColumnCount() const {
+    return columnCount;
+}
+//---------------------------------------------------------------------------
+size_t ColumnFileReader::getRowCount() const {
+    return rowCount;
+}
+//---------------------------------------------------------------------------
+ColumnFileWriter::ColumnFileWriter(int fd, size_t columnCount, size_t rowCount) : fd(fd), columnCount(columnCount), rowCount(rowCount) {}
+//---------------------------------------------------------------------------
+ColumnFileWriter::~ColumnFileWriter() {
+    close(fd);
+}
+//---------------------------------------------------------------------------
+std::unique_ptr<ColumnFileWriter> ColumnFileWriter::create(const std::string& path, size_t columnCount, size_t rowCount) {
+    auto fileSize = ColumnFile::getFileSize(columnCount, rowCount);
+    if (!fileSize)
+        return nullptr;
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return nullptr;
+    ColumnFile::Header header;
+    std::memcpy(header.magic, ColumnFile::magic, sizeof(header.magic));
+    header.columnCount = columnCount;
+    header.rowCount = rowCount;
+    if (!writeFully(fd, &header, sizeof(header), 0) || ftruncate(fd, static_cast<off_t>(*fileSize)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    return std::unique_ptr<ColumnFileWriter>(new ColumnFileWriter(fd, columnCount, rowCount));
+}
+//---------------------------------------------------------------------------
+bool ColumnFileWriter::write(size_t column, size_t firstRow, std::span<const double> values) {
+    if (column >= columnCount || firstRow + values.size() > rowCount)
+        return false;
+    return writeFully(fd, values.data(), values.size_bytes(), ColumnFile::getOffset(rowCount, column, firstRow));
+}
+//---------------------------------------------------------------------------
+size_t ColumnFileWriter::getColumnCount() const {
+    return columnCount;
+}
+//---------------------------------------------------------------------------
+size_t ColumnFileWriter::getRowCount() const {
+    return rowCount;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
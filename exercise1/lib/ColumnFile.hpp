@@ -0,0 +1,82 @@
+#ifndef H_lib_ColumnFile
+#define H_lib_ColumnFile
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+/// A binary file of double columns with the same number of rows.
+/// The file starts with a header (magic, column count, row count), followed by
+/// the columns one after the other, all in native byte order. Column c of
+/// row r is at offset headerSize + (c * rowCount + r) * sizeof(double).
+struct ColumnFile {
+    static constexpr char magic[8] = {'A', 'S', 'T', 'C', 'O', 'L', 'S', '1'};
+    struct Header {
+        char magic[8];
+        uint64_t columnCount;
+        uint64_t rowCount;
+    };
+    static constexpr size_t headerSize = sizeof(Header);
+
+    /// The offset of a row of a column
+    static uint64_t getOffset(uint64_t rowCount, size_t column, size_t row);
+    /// The size of a file with these dimensions, nullopt if it does not fit into off_t
+    static std::optional<uint64_t> getFileSize(uint64_t columnCount, uint64_t rowCount);
+};
+//---------------------------------------------------------------------------
+/// Reads rows of a column file with pread, can be used from several threads
+class ColumnFileReader {
+public:
+    ColumnFileReader(const ColumnFileReader&) = delete;
+    ColumnFileReader& operator=(const ColumnFileReader&) = delete;
+    ~ColumnFileReader();
+
+    /// Open a column file, returns nullptr if it cannot be read or has no valid header
+    static std::unique_ptr<ColumnFileReader> open(const std::string& path);
+
+    /// Read the rows [firstRow, firstRow + out.size()) of a column, false on I/O errors
+    bool read(size_t column, size_t firstRow, std::span<double> out) const;
+
+    size_t getColumnCount() const;
+    size_t getRowCount() const;
+
+private:
+    ColumnFileReader(int fd, size_t columnCount, size_t rowCount);
+
+    int fd;
+    size_t columnCount;
+    size_t rowCount;
+};
+//---------------------------------------------------------------------------
+/// Writes rows of a column file with pwrite, can be used from several threads
+class ColumnFileWriter {
+public:
+    ColumnFileWriter(const ColumnFileWriter&) = delete;
+    ColumnFileWriter& operator=(const ColumnFileWriter&) = delete;
+    ~ColumnFileWriter();
+
+    /// Create or truncate a column file of the given size, returns nullptr on errors
+    static std::unique_ptr<ColumnFileWriter> create(const std::string& path, size_t columnCount, size_t rowCount);
+
+    /// Write the rows [firstRow, firstRow + values.size()) of a column, false on I/O errors
+    bool write(size_t column, size_t firstRow, std::span<const double> values);
+
+    size_t getColumnCount() const;
+    size_t getRowCount() const;
+
+private:
+    ColumnFileWriter(int fd, size_t columnCount, size_t rowCount);
+
+    int fd;
+    size_t columnCount;
+    size_t rowCount;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,38 @@
+#include "lib/ColumnarContext.hpp"
+#include <algorithm>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+template <typename T>
+void BasicColumnarContext<T>::pushColumn(std::span<const T> column) {
+    columns.push_back(column);
+}
+//---------------------------------------------------------------------------
+template <typename T>
+std::span<const T> BasicColumnarContext<T>::getColumn(size_t index) const {
+    if (index < columns.size())
+        return columns[index];
+    return {};
+}
+//---------------------------------------------------------------------------
+template <typename T>
+size_t BasicColumnarContext<T>::getColumnCount() const {
+    return columns.size();
+}
+//---------------------------------------------------------------------------
+template <typename T>
+size_t BasicColumnarContext<T>::getRowCount() const {
+    if (columns.empty())
+        return 0;
+    size_t rows = columns.front().size();
+    for (const auto& column : columns)
+        rows = std::min(rows, column.size());
+    return rows;
+}
+//---------------------------------------------------------------------------
+template class BasicColumnarContext<float>;
+template class BasicColumnarContext<double>;
+template class BasicColumnarContext<long double>;
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
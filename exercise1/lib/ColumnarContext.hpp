@@ -0,0 +1,36 @@
+#ifndef H_lib_ColumnarContext
+#define H_lib_ColumnarContext
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <span>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+/// The parameters of many rows, stored column by column as values of type T.
+/// Parameter i of row r is getColumn(i)[r]. The context only references the
+/// columns, they must outlive it. Like in EvaluationContext, parameters without
+/// a column read as 0.
+template <typename T>
+class BasicColumnarContext {
+public:
+    /// Add the column for the next parameter index
+    void pushColumn(std::span<const T> column);
+    /// The column of a parameter, empty if there is none
+    std::span<const T> getColumn(size_t index) const;
+    size_t getColumnCount() const;
+    /// The number of rows all columns have
+    size_t getRowCount() const;
+
+private:
+    std::vector<std::span<const T>> columns;
+};
+//---------------------------------------------------------------------------
+using ColumnarContext = BasicColumnarContext<double>;
+extern template class BasicColumnarContext<float>;
+extern template class BasicColumnarContext<double>;
+extern template class BasicColumnarContext<long double>;
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,359 @@
+#ifndef H_lib_CompileTime
+#define H_lib_CompileTime
+//---------------------------------------------------------------------------
+#include "lib/AST.hpp"
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+//---------------------------------------------------------------------------
+/// Expressions that are fixed at build time.
+///
+/// The node vocabulary mirrors the runtime AST, e.g.
+///     auto e = ct::Param<0>{} * ct::Const{2.0} + ct::pow(ct::Param<1>{}, ct::Lit<2.0>{});
+/// Building an expression through the operators applies the same rewrite rules
+/// as ASTNode::optimize while the type is formed, so -(-a) or (-a) * (-b) never
+/// exist at runtime. Const carries its value at runtime and is folded with
+/// other constants, Lit<V> carries its value in the type so that value
+/// dependent rules like a * 1 -> a or a ^ 0 -> 1 can fire as well.
+/// toAST() converts an expression into an equivalent runtime tree.
+namespace ast::ct {
+//---------------------------------------------------------------------------
+namespace detail {
+//---------------------------------------------------------------------------
+/// Read a parameter from an EvaluationContext or anything indexable
+template <typename Source>
+constexpr double read(const Source& source, size_t index) {
+    if constexpr (requires { source.getParameter(index); })
+        return source.getParameter(index);
+    else
+        return source[index];
+}
+//---------------------------------------------------------------------------
+/// pow that can run during constant evaluation for integer exponents.
+/// std::pow is not constexpr, so constant evaluation multiplies by repeated
+/// squaring instead, which is within |n| ulp of std::pow but not always
+/// bitwise equal. A constexpr result can therefore differ in the last bits
+/// from the same expression evaluated at runtime or through toAST(), which
+/// both call std::pow. Other exponents are not a constant expression.
+constexpr double power(double base, double exponent) {
+    // The range check also rejects NaN and infinities before the conversion
+    constexpr double maxExponent = 0x1p62;
+    if (std::is_constant_evaluated() && exponent >= -maxExponent && exponent <= maxExponent && exponent == static_cast<long long>(exponent)) {
+        long long n = static_cast<long long>(exponent);
+        unsigned long long k = (n < 0) ? -static_cast<unsigned long long>(n) : n;
+        double result = 1.0;
+        for (double square = base; k; k >>= 1, square *= square)
+            if (k & 1) result *= square;
+        return (n < 0) ? 1.0 / result : result;
+    }
+    return std::pow(base, exponent);
+}
+//---------------------------------------------------------------------------
+struct AddOp {
+    static constexpr double apply(double a, double b) { return a + b; }
+    static std::unique_ptr<ASTNode> make(std::unique_ptr<ASTNode> a, std::unique_ptr<ASTNode> b) { return std::make_unique<ast::Add>(std::move(a), std::move(b)); }
+};
+struct SubtractOp {
+    static constexpr double apply(double a, double b) { return a - b; }
+    static std::unique_ptr<ASTNode> make(std::unique_ptr<ASTNode> a, std::unique_ptr<ASTNode> b) { return std::make_unique<ast::Subtract>(std::move(a), std::move(b)); }
+};
+struct MultiplyOp {
+    static constexpr double apply(double a, double b) { return a * b; }
+    static std::unique_ptr<ASTNode> make(std::unique_ptr<ASTNode> a, std::unique_ptr<ASTNode> b) { return std::make_unique<ast::Multiply>(std::move(a), std::move(b)); }
+};
+struct DivideOp {
+    static constexpr double apply(double a, double b) { return a / b; }
+    static std::unique_ptr<ASTNode> make(std::unique_ptr<ASTNode> a, std::unique_ptr<ASTNode> b) { return std::make_unique<ast::Divide>(std::move(a), std::move(b)); }
+};
+struct PowerOp {
+    static constexpr double apply(double a, double b) { return power(a, b); }
+    static std::unique_ptr<ASTNode> make(std::unique_ptr<ASTNode> a, std::unique_ptr<ASTNode> b) { return std::make_unique<ast::Power>(std::move(a), std::move(b)); }
+};
+//---------------------------------------------------------------------------
+} // namespace detail
+//---------------------------------------------------------------------------
+/// A constant whose value is known at runtime (or during constant evaluation)
+struct Const {
+    double value;
+
+    template <typename Source>
+    constexpr double evaluate(const Source& /*source*/) const { return value; }
+    std::unique_ptr<ASTNode> toAST() const { return std::make_unique<Constant>(value); }
+};
+//---------------------------------------------------------------------------
+/// A constant whose value is part of the type
+template <double V>
+struct Lit {
+    static constexpr double value = V;
+
+    template <typename Source>
+    constexpr double evaluate(const Source& /*source*/) const { return V; }
+    std::unique_ptr<ASTNode> toAST() const { return std::make_unique<Constant>(V); }
+};
+//---------------------------------------------------------------------------
+template <size_t I>
+struct Param {
+    static constexpr size_t index = I;
+
+    template <typename Source>
+    constexpr double evaluate(const Source& source) const { return detail::read(source, I); }
+    std::unique_ptr<ASTNode> toAST() const { return std::make_unique<Parameter>(I); }
+};
+//---------------------------------------------------------------------------
+template <typename E>
+struct UnaryMinus {
+    E input;
+
+    template <typename Source>
+    constexpr double evaluate(const Source& source) const { return -input.evaluate(source); }
+    std::unique_ptr<ASTNode> toAST() const { return std::make_unique<ast::UnaryMinus>(input.toAST()); }
+};
+//---------------------------------------------------------------------------
+template <typename Op, typename L, typename R>
+struct Binary {
+    L left;
+    R right;
+
+    template <typename Source>
+    constexpr double evaluate(const Source& source) const { return Op::apply(left.evaluate(source), right.evaluate(source)); }
+    std::unique_ptr<ASTNode> toAST() const { return Op::make(left.toAST(), right.toAST()); }
+};
+//---------------------------------------------------------------------------
+template <typename L, typename R>
+using Add = Binary<detail::AddOp, L, R>;
+template <typename L, typename R>
+using Subtract = Binary<detail::SubtractOp, L, R>;
+template <typename L, typename R>
+using Multiply = Binary<detail::MultiplyOp, L, R>;
+template <typename L, typename R>
+using Divide = Binary<detail::DivideOp, L, R>;
+template <typename L, typename R>
+using Power = Binary<detail::PowerOp, L, R>;
+//---------------------------------------------------------------------------
+namespace detail {
+//---------------------------------------------------------------------------
+template <typename T>
+struct IsExpression : std::false_type {};
+template <>
+struct IsExpression<Const> : std::true_type {};
+template <double V>
+struct IsExpression<Lit<V>> : std::true_type {};
+template <size_t I>
+struct IsExpression<Param<I>> : std::true_type {};
+template <typename E>
+struct IsExpression<UnaryMinus<E>> : std::true_type {};
+template <typename Op, typename L, typename R>
+struct IsExpression<Binary<Op, L, R>> : std::true_type {};
+//---------------------------------------------------------------------------
+template <typename T>
+struct IsLit : std::false_type {};
+template <double V>
+struct IsLit<Lit<V>> : std::true_type {};
+//---------------------------------------------------------------------------
+template <typename T>
+struct IsNegation : std::false_type {};
+template <typename E>
+struct IsNegation<UnaryMinus<E>> : std::true_type {};
+//---------------------------------------------------------------------------
+template <typename T>
+struct IsSubtraction : std::false_type {};
+template <typename L, typename R>
+struct IsSubtraction<Subtract<L, R>> : std::true_type {};
+//---------------------------------------------------------------------------
+} // namespace detail
+//---------------------------------------------------------------------------
+template <typename T>
+concept Expression = detail::IsExpression<T>::value;
+/// Anything the operators accept, arithmetic values become Const
+template <typename T>
+concept Operand = Expression<T> || std::is_arithmetic_v<T>;
+//---------------------------------------------------------------------------
+namespace detail {
+//---------------------------------------------------------------------------
+template <typename T>
+constexpr bool isConstant = std::is_same_v<T, Const> || IsLit<T>::value;
+/// Whether T is a literal with value v
+template <typename T>
+constexpr bool isLit(double v) {
+    if constexpr (IsLit<T>::value)
+        return T::value == v;
+    else
+        return false;
+}
+//---------------------------------------------------------------------------
+template <Operand T>
+constexpr auto lift(T value) {
+    if constexpr (Expression<T>)
+        return value;
+    else
+        return Const{static_cast<double>(value)};
+}
+//---------------------------------------------------------------------------
+/// Fold two constants, two literals stay a literal so later rules still see the value
+template <typename Op, typename L, typename R>
+constexpr auto fold(L l, R r) {
+    if constexpr (IsLit<L>::value && IsLit<R>::value && !std::is_same_v<Op, PowerOp>)
+        return Lit<Op::apply(L::value, R::value)>{};
+    else
+        return Const{Op::apply(l.value, r.value)};
+}
+//---------------------------------------------------------------------------
+} // namespace detail
+//---------------------------------------------------------------------------
+/// +a -> a
+template <Expression E>
+constexpr E operator+(E e) {
+    return e;
+}
+//---------------------------------------------------------------------------
+template <Expression E>
+constexpr auto operator-(E e) {
+    if constexpr (std::is_same_v<E, Const>)
+        return Const{-e.value};
+    else if constexpr (detail::IsLit<E>::value)
+        return Lit<-E::value>{};
+    else if constexpr (detail::IsNegation<E>::value)
+        // -(-a) -> a
+        return e.input;
+    else if constexpr (detail::IsSubtraction<E>::value)
+        // -(a - b) -> b - a
+        return e.right - e.left;
+    else
+        return UnaryMinus<E>{e};
+}
+//---------------------------------------------------------------------------
+template <Operand L, Operand R>
+    requires(Expression<L> || Expression<R>)
+constexpr auto operator+(L left, R right) {
+    auto l = detail::lift(left);
+    auto r = detail::lift(right);
+    using LT = decltype(l);
+    using RT = decltype(r);
+    if constexpr (detail::isConstant<LT> && detail::isConstant<RT>)
+        return detail::fold<detail::AddOp>(l, r);
+    else if constexpr (detail::isLit<RT>(0.0))
+        // a + 0 -> a
+        return l;
+    else if constexpr (detail::isLit<LT>(0.0))
+        // 0 + a -> a
+        return r;
+    else if constexpr (detail::IsNegation<LT>::value)
+        // (-a) + b -> b - a
+        return r - l.input;
+    else if constexpr (detail::IsNegation<RT>::value)
+        // a + (-b) -> a - b
+        return l - r.input;
+    else
+        return Add<LT, RT>{l, r};
+}
+//---------------------------------------------------------------------------
+template <Operand L, Operand R>
+    requires(Expression<L> || Expression<R>)
+constexpr auto operator-(L left, R right) {
+    auto l = detail::lift(left);
+    auto r = detail::lift(right);
+    using LT = decltype(l);
+    using RT = decltype(r);
+    if constexpr (detail::isConstant<LT> && detail::isConstant<RT>)
+        return detail::fold<detail::SubtractOp>(l, r);
+    else if constexpr (detail::isLit<RT>(0.0))
+        // a - 0 -> a
+        return l;
+    else if constexpr (detail::isLit<LT>(0.0))
+        // 0 - a -> -a
+        return -r;
+    else if constexpr (detail::IsNegation<RT>::value)
+        // a - (-b) -> a + b
+        return l + r.input;
+    else
+        return Subtract<LT, RT>{l, r};
+}
+//---------------------------------------------------------------------------
+template <Operand L, Operand R>
+    requires(Expression<L> || Expression<R>)
+constexpr auto operator*(L left, R right) {
+    auto l = detail::lift(left);
+    auto r = detail::lift(right);
+    using LT = decltype(l);
+    using RT = decltype(r);
+    if constexpr (detail::isConstant<LT> && detail::isConstant<RT>)
+        return detail::fold<detail::MultiplyOp>(l, r);
+    else if constexpr (detail::isLit<RT>(0.0) || detail::isLit<LT>(0.0))
+        // a * 0 -> 0, 0 * a -> 0
+        return Lit<0.0>{};
+    else if constexpr (detail::isLit<RT>(1.0))
+        // a * 1 -> a
+        return l;
+    else if constexpr (detail::isLit<LT>(1.0))
+        // 1 * a -> a
+        return r;
+    else if constexpr (detail::IsNegation<LT>::value && detail::IsNegation<RT>::value)
+        // (-a) * (-b) -> a * b
+        return l.input * r.input;
+    else
+        return Multiply<LT, RT>{l, r};
+}
+//---------------------------------------------------------------------------
+template <Operand L, Operand R>
+    requires(Expression<L> || Expression<R>)
+constexpr auto operator/(L left, R right) {
+    auto l = detail::lift(left);
+    auto r = detail::lift(right);
+    using LT = decltype(l);
+    using RT = decltype(r);
+    if constexpr (detail::isConstant<LT> && detail::isConstant<RT>)
+        return detail::fold<detail::DivideOp>(l, r);
+    else if constexpr (detail::isLit<RT>(1.0))
+        // a / 1 -> a
+        return l;
+    else if constexpr (detail::isConstant<RT>)
+        // a / c -> a * (1 / c)
+        return l * (Lit<1.0>{} / r);
+    else if constexpr (detail::isLit<LT>(0.0))
+        // 0 / a -> 0
+        return Lit<0.0>{};
+    else if constexpr (detail::IsNegation<LT>::value && detail::IsNegation<RT>::value)
+        // (-a) / (-b) -> a / b
+        return l.input / r.input;
+    else
+        return Divide<LT, RT>{l, r};
+}
+//---------------------------------------------------------------------------
+template <Operand L, Operand R>
+    requires(Expression<L> || Expression<R>)
+constexpr auto pow(L base, R exponent) {
+    auto l = detail::lift(base);
+    auto r = detail::lift(exponent);
+    using LT = decltype(l);
+    using RT = decltype(r);
+    if constexpr (detail::isConstant<LT> && detail::isConstant<RT>)
+        return detail::fold<detail::PowerOp>(l, r);
+    else if constexpr (detail::isLit<RT>(0.0))
+        // a ^ 0 -> 1
+        return Lit<1.0>{};
+    else if constexpr (detail::isLit<RT>(1.0))
+        // a ^ 1 -> a
+        return l;
+    else if constexpr (detail::isLit<RT>(-1.0))
+        // a ^ -1 -> 1 / a
+        return Divide<Lit<1.0>, LT>{{}, l};
+    else if constexpr (detail::isLit<LT>(0.0))
+        // 0 ^ a -> 0
+        return Lit<0.0>{};
+    else if constexpr (detail::isLit<LT>(1.0))
+        // 1 ^ a -> 1
+        return Lit<1.0>{};
+    else
+        return Power<LT, RT>{l, r};
+}
+//---------------------------------------------------------------------------
+/// Convert into an equivalent runtime tree
+template <Expression E>
+std::unique_ptr<ASTNode> toAST(const E& expression) {
+    return expression.toAST();
+}
+//---------------------------------------------------------------------------
+} // namespace ast::ct
+//---------------------------------------------------------------------------
+#endif
@@ -15,5 +15,13 @@ double EvaluationContext::getParameter(size_t index) const {
     // Handle error - you may want to throw an exception or provide a default value
     return 0.0;
 }
+
+void EvaluationContext::copyParameters(double* target, size_t count) const {
+    size_t available = (count < parameters.size()) ? count : parameters.size();
+    for (size_t i = 0; i < available; ++i)
+        target[i] = parameters[i];
+    for (size_t i = available; i < count; ++i)
+        target[i] = 0.0;
+}
 } // namespace ast
 //---------------------------------------------------------------------------
@@ -9,6 +9,8 @@ class EvaluationContext {
 public:
     void pushParameter(double value);
     double getParameter(size_t index) const;
+    /// Copy the first count parameters into target, missing parameters read as 0
+    void copyParameters(double* target, size_t count) const;
 
 private:
     std::vector<double> parameters;
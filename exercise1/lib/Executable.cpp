@@ -0,0 +1,85 @@
+#include "lib/Executable.hpp"
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <numeric>
+#include <stdexcept>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+Executable::Executable(std::unique_ptr<ASTNode> tree) : Executable(std::move(tree), Options()) {}
+//---------------------------------------------------------------------------
+Executable::Executable(std::unique_ptr<ASTNode> tree, Options options) : tree(std::move(tree)), options(options) {}
+//---------------------------------------------------------------------------
+double Executable::evaluate(const EvaluationContext& context) {
+    ++invocations[static_cast<size_t>(tier)];
+    switch (tier) {
+        case Tier::Interpreter: {
+            double result = tree->evaluate(context);
+            if (invocations[static_cast<size_t>(Tier::Interpreter)] >= options.promotionThreshold)
+                promote();
+            return result;
+        }
+        case Tier::Bytecode:
+            return vm->run(context);
+        case Tier::Closure:
+            return closure->evaluate(context);
+        case Tier::Native:
+            return native->evaluate(context);
+    }
+    return 0.0;
+}
+//---------------------------------------------------------------------------
+const ASTNode& Executable::getTree() const {
+    return *tree;
+}
+//---------------------------------------------------------------------------
+Executable::Tier Executable::getTier() const {
+    return tier;
+}
+//---------------------------------------------------------------------------
+uint64_t Executable::getInvocationCount() const {
+    return std::accumulate(invocations.begin(), invocations.end(), uint64_t(0));
+}
+//---------------------------------------------------------------------------
+uint64_t Executable::getInvocationCount(Tier tier) const {
+    return invocations[static_cast<size_t>(tier)];
+}
+//---------------------------------------------------------------------------
+void Executable::promote() {
+    if (tier != Tier::Interpreter)
+        return;
+    if (options.maxTier == Tier::Native) {
+        native = JITFunction::compile(*tree);
+        if (native) {
+            tier = Tier::Native;
+            return;
+        }
+    }
+    if (options.maxTier >= Tier::Closure) {
+        closure = ClosureFunction::compile(*tree);
+        tier = Tier::Closure;
+    } else if (options.maxTier == Tier::Bytecode) {
+        try {
+            program = std::make_unique<Program>(Program::compile(*tree));
+        } catch (const std::out_of_range&) {
+            // The parameter indexes are too large for bytecode, keep interpreting
+            options.maxTier = Tier::Interpreter;
+            return;
+        }
+        vm = std::make_unique<VM>(*program);
+        tier = Tier::Bytecode;
+    }
+}
+//---------------------------------------------------------------------------
+const char* Executable::getTierName(Tier tier) {
+    switch (tier) {
+        case Tier::Interpreter: return "interpreter";
+        case Tier::Bytecode: return "bytecode";
+        case Tier::Closure: return "closure";
+        case Tier::Native: return "native";
+    }
+    return "unknown";
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
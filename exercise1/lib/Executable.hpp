@@ -0,0 +1,70 @@
+#ifndef H_lib_Executable
+#define H_lib_Executable
+//---------------------------------------------------------------------------
+#include "lib/Closure.hpp"
+#include "lib/JIT.hpp"
+#include "lib/Program.hpp"
+#include "lib/VM.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+class EvaluationContext;
+//---------------------------------------------------------------------------
+/// An expression that starts out in the tree interpreter and is compiled
+/// once it got hot. Not thread safe, every thread needs its own Executable.
+class Executable {
+public:
+    /// All execution tiers, from slowest to fastest
+    enum class Tier : uint8_t {
+        Interpreter,
+        Bytecode,
+        Closure,
+        Native
+    };
+    static constexpr size_t tierCount = 4;
+
+    struct Options {
+        /// The number of interpreted invocations before the expression is compiled
+        uint64_t promotionThreshold = 1000;
+        /// The highest tier to promote to, Native falls back to Closure where
+        /// no native code can be generated
+        Tier maxTier = Tier::Native;
+    };
+
+    explicit Executable(std::unique_ptr<ASTNode> tree);
+    Executable(std::unique_ptr<ASTNode> tree, Options options);
+
+    double evaluate(const EvaluationContext& context);
+
+    const ASTNode& getTree() const;
+    /// The tier the next invocation runs in
+    Tier getTier() const;
+    /// The number of invocations in total and per tier
+    uint64_t getInvocationCount() const;
+    uint64_t getInvocationCount(Tier tier) const;
+    /// Compile into the best allowed tier right away. Trees that the tier
+    /// cannot compile stay in the interpreter.
+    void promote();
+
+    static const char* getTierName(Tier tier);
+
+private:
+    std::unique_ptr<ASTNode> tree;
+    Options options;
+    Tier tier = Tier::Interpreter;
+    std::array<uint64_t, tierCount> invocations{};
+
+    std::unique_ptr<Program> program;
+    std::unique_ptr<VM> vm;
+    std::optional<ClosureFunction> closure;
+    std::unique_ptr<JITFunction> native;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,385 @@
+#include "lib/FlatTree.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <cmath>
+#include <ostream>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+using Type = ASTNode::Type;
+//---------------------------------------------------------------------------
+/// Rewrites a flat tree bottom-up into a new one. Every node is created
+/// through make(), which applies the rules before appending, so the result of
+/// a rewrite is simplified again without another pass.
+class FlatTreeOptimizer {
+public:
+    explicit FlatTreeOptimizer(const FlatTree& input) : input(input) {}
+
+    FlatTree run();
+
+private:
+    uint32_t make(Type type, uint32_t a, uint32_t b, uint32_t c = 0);
+    uint32_t constant(double value) { return output.appendConstant(value); }
+    bool is(uint32_t node, Type type) const { return output.getType(node) == type; }
+    bool isConstant(uint32_t node, double value) const { return is(node, Type::Constant) && output.getConstant(node) == value; }
+    /// Keep only the nodes reachable from the root
+    FlatTree compact(uint32_t root) const;
+
+    const FlatTree& input;
+    FlatTree output;
+};
+//---------------------------------------------------------------------------
+uint32_t FlatTreeOptimizer::make(Type type, uint32_t a, uint32_t b, uint32_t c) {
+    if (type == Type::UnaryMinus) {
+        if (is(a, Type::Constant))
+            return constant(-output.getConstant(a));
+        if (is(a, Type::UnaryMinus))
+            // -(-a) -> a
+            return output.getFirst(a);
+        if (is(a, Type::Subtract))
+            // -(a - b) -> b - a
+            return make(Type::Subtract, output.getSecond(a), output.getFirst(a));
+        return output.append(type, a, 0);
+    }
+    if (type == Type::SquareRoot) {
+        if (is(a, Type::Constant))
+            return constant(SquareRoot::apply(output.getConstant(a)));
+        return output.append(type, a, 0);
+    }
+    if (type == Type::FusedMultiplyAdd || type == Type::FusedMultiplySubtract) {
+        if (is(a, Type::Constant) && is(b, Type::Constant) && is(c, Type::Constant)) {
+            double x = output.getConstant(a);
+            double y = output.getConstant(b);
+            double z = output.getConstant(c);
+            return constant((type == Type::FusedMultiplyAdd) ? FusedMultiplyAdd::apply(x, y, z) : FusedMultiplySubtract::apply(x, y, z));
+        }
+        return output.append(type, a, b, c);
+    }
+
+    if (is(a, Type::Constant) && is(b, Type::Constant)) {
+        double x = output.getConstant(a);
+        double y = output.getConstant(b);
+        switch (type) {
+            case Type::Add: return constant(x + y);
+            case Type::Subtract: return constant(x - y);
+            case Type::Multiply: return constant(x * y);
+            case Type::Divide: return constant(x / y);
+            case Type::IntegerPower: return constant(IntegerPower::apply(x, y));
+            default: return constant(std::pow(x, y));
+        }
+    }
+
+    bool negatedA = is(a, Type::UnaryMinus);
+    bool negatedB = is(b, Type::UnaryMinus);
+    switch (type) {
+        case Type::Add:
+            if (isConstant(b, 0.0)) return a;
+            if (isConstant(a, 0.0)) return b;
+            // (-a) + b -> b - a
+            if (negatedA) return make(Type::Subtract, b, output.getFirst(a));
+            // a + (-b) -> a - b
+            if (negatedB) return make(Type::Subtract, a, output.getFirst(b));
+            break;
+        case Type::Subtract:
+            if (isConstant(b, 0.0)) return a;
+            // 0 - a -> -a
+            if (isConstant(a, 0.0)) return make(Type::UnaryMinus, b, 0);
+            // a - (-b) -> a + b
+            if (negatedB) return make(Type::Add, a, output.getFirst(b));
+            break;
+        case Type::Multiply:
+            if (isConstant(a, 0.0) || isConstant(b, 0.0)) return constant(0.0);
+            if (isConstant(b, 1.0)) return a;
+            if (isConstant(a, 1.0)) return b;
+            // (-a) * (-b) -> a * b
+            if (negatedA && negatedB) return make(Type::Multiply, output.getFirst(a), output.getFirst(b));
+            break;
+        case Type::Divide:
+            if (isConstant(b, 1.0)) return a;
+            // a / c -> a * (1 / c)
+            if (is(b, Type::Constant)) return make(Type::Multiply, a, constant(1.0 / output.getConstant(b)));
+            if (isConstant(a, 0.0)) return constant(0.0);
+            // (-a) / (-b) -> a / b
+            if (negatedA && negatedB) return make(Type::Divide, output.getFirst(a), output.getFirst(b));
+            break;
+        case Type::Power:
+            if (isConstant(b, 0.0)) return constant(1.0);
+            if (isConstant(b, 1.0)) return a;
+            // a ^ -1 -> 1 / a
+            if (isConstant(b, -1.0)) return make(Type::Divide, constant(1.0), a);
+            if (isConstant(a, 0.0)) return constant(0.0);
+            if (isConstant(a, 1.0)) return constant(1.0);
+            break;
+        default:
+            break;
+    }
+    return output.append(type, a, b);
+}
+//---------------------------------------------------------------------------
+FlatTree FlatTreeOptimizer::compact(uint32_t root) const {
+    std::vector<bool> reachable(output.size());
+    reachable[root] = true;
+    // Operands precede their users, so one backwards sweep finds everything
+    for (uint32_t i = root + 1; i-- > 0;) {
+        if (!reachable[i])
+            continue;
+        switch (output.getType(i)) {
+            case Type::Constant:
+            case Type::Parameter:
+                break;
+            case Type::UnaryPlus:
+            case Type::UnaryMinus:
+            case Type::SquareRoot:
+                reachable[output.getFirst(i)] = true;
+                break;
+            case Type::FusedMultiplyAdd:
+            case Type::FusedMultiplySubtract:
+                reachable[output.getFirst(i)] = true;
+                reachable[output.getSecond(i)] = true;
+                reachable[output.getThird(i)] = true;
+                break;
+            default:
+                reachable[output.getFirst(i)] = true;
+                reachable[output.getSecond(i)] = true;
+                break;
+        }
+    }
+
+    FlatTree result;
+    std::vector<uint32_t> mapping(output.size());
+    for (uint32_t i = 0; i <= root; ++i) {
+        if (!reachable[i])
+            continue;
+        switch (output.getType(i)) {
+            case Type::Constant:
+                mapping[i] = result.appendConstant(output.getConstant(i));
+                break;
+            case Type::Parameter:
+                mapping[i] = result.append(Type::Parameter, output.getParameterIndex(i), 0);
+                break;
+            case Type::UnaryPlus:
+            case Type::UnaryMinus:
+            case Type::SquareRoot:
+                mapping[i] = result.append(output.getType(i), mapping[output.getFirst(i)], 0);
+                break;
+            case Type::FusedMultiplyAdd:
+            case Type::FusedMultiplySubtract:
+                mapping[i] = result.append(output.getType(i), mapping[output.getFirst(i)], mapping[output.getSecond(i)], mapping[output.getThird(i)]);
+                break;
+            default:
+                mapping[i] = result.append(output.getType(i), mapping[output.getFirst(i)], mapping[output.getSecond(i)]);
+                break;
+        }
+    }
+    return result;
+}
+//---------------------------------------------------------------------------
+FlatTree FlatTreeOptimizer::run() {
+    std::vector<uint32_t> mapping(input.size());
+    for (uint32_t i = 0; i < input.size(); ++i) {
+        Type type = input.getType(i);
+        switch (type) {
+            case Type::Constant:
+                mapping[i] = constant(input.getConstant(i));
+                break;
+            case Type::Parameter:
+                mapping[i] = output.append(type, input.getParameterIndex(i), 0);
+                break;
+            case Type::UnaryPlus:
+                // +a -> a
+                mapping[i] = mapping[input.getFirst(i)];
+                break;
+            case Type::UnaryMinus:
+            case Type::SquareRoot:
+                mapping[i] = make(type, mapping[input.getFirst(i)], 0);
+                break;
+            case Type::FusedMultiplyAdd:
+            case Type::FusedMultiplySubtract:
+                mapping[i] = make(type, mapping[input.getFirst(i)], mapping[input.getSecond(i)], mapping[input.getThird(i)]);
+                break;
+            default:
+                mapping[i] = make(type, mapping[input.getFirst(i)], mapping[input.getSecond(i)]);
+                break;
+        }
+    }
+    return compact(mapping[input.getRoot()]);
+}
+//---------------------------------------------------------------------------
+uint32_t FlatTree::append(Type type, uint32_t firstOperand, uint32_t secondOperand, uint32_t thirdOperand) {
+    types.push_back(static_cast<uint8_t>(type));
+    first.push_back(firstOperand);
+    second.push_back(secondOperand);
+    third.push_back(thirdOperand);
+    return types.size() - 1;
+}
+//---------------------------------------------------------------------------
+uint32_t FlatTree::appendConstant(double value) {
+    constants.push_back(value);
+    return append(Type::Constant, constants.size() - 1, 0);
+}
+//---------------------------------------------------------------------------
+uint32_t FlatTree::flatten(const ASTNode& node) {
+    switch (node.getType()) {
+        case Type::Constant:
+            return appendConstant(static_cast<const Constant&>(node).getValue());
+        case Type::Parameter:
+            return append(Type::Parameter, static_cast<const Parameter&>(node).getIndex(), 0);
+        case Type::UnaryPlus:
+        case Type::UnaryMinus:
+        case Type::SquareRoot:
+            return append(node.getType(), flatten(static_cast<const UnaryASTNode&>(node).getInput()), 0);
+        case Type::FusedMultiplyAdd:
+        case Type::FusedMultiplySubtract: {
+            const auto& ternary = static_cast<const TernaryASTNode&>(node);
+            uint32_t a = flatten(ternary.getFirst());
+            uint32_t b = flatten(ternary.getSecond());
+            uint32_t c = flatten(ternary.getThird());
+            return append(node.getType(), a, b, c);
+        }
+        default: {
+            const auto& binary = static_cast<const BinaryASTNode&>(node);
+            uint32_t left = flatten(binary.getLeft());
+            uint32_t right = flatten(binary.getRight());
+            return append(node.getType(), left, right);
+        }
+    }
+}
+//---------------------------------------------------------------------------
+FlatTree FlatTree::fromAST(const ASTNode& node) {
+    FlatTree tree;
+    tree.flatten(node);
+    return tree;
+}
+//---------------------------------------------------------------------------
+std::unique_ptr<ASTNode> FlatTree::build(uint32_t node) const {
+    switch (getType(node)) {
+        case Type::Constant: return std::make_unique<Constant>(getConstant(node));
+        case Type::Parameter: return std::make_unique<Parameter>(getParameterIndex(node));
+        case Type::UnaryPlus: return std::make_unique<UnaryPlus>(build(first[node]));
+        case Type::UnaryMinus: return std::make_unique<UnaryMinus>(build(first[node]));
+        case Type::SquareRoot: return std::make_unique<SquareRoot>(build(first[node]));
+        case Type::Add: return std::make_unique<Add>(build(first[node]), build(second[node]));
+        case Type::Subtract: return std::make_unique<Subtract>(build(first[node]), build(second[node]));
+        case Type::Multiply: return std::make_unique<Multiply>(build(first[node]), build(second[node]));
+        case Type::Divide: return std::make_unique<Divide>(build(first[node]), build(second[node]));
+        case Type::Power: return std::make_unique<Power>(build(first[node]), build(second[node]));
+        case Type::IntegerPower: return std::make_unique<IntegerPower>(build(first[node]), build(second[node]));
+        case Type::FusedMultiplyAdd: return std::make_unique<FusedMultiplyAdd>(build(first[node]), build(second[node]), build(third[node]));
+        case Type::FusedMultiplySubtract: return std::make_unique<FusedMultiplySubtract>(build(first[node]), build(second[node]), build(third[node]));
+    }
+    return nullptr;
+}
+//---------------------------------------------------------------------------
+std::unique_ptr<ASTNode> FlatTree::toAST() const {
+    return build(getRoot());
+}
+//---------------------------------------------------------------------------
+double FlatTree::evaluate(const EvaluationContext& context) const {
+    std::vector<double> scratch;
+    return evaluate(context, scratch);
+}
+//---------------------------------------------------------------------------
+double FlatTree::evaluate(const EvaluationContext& context, std::vector<double>& scratch) const {
+    scratch.resize(types.size());
+    double* values = scratch.data();
+    for (uint32_t i = 0; i < types.size(); ++i) {
+        switch (static_cast<Type>(types[i])) {
+            case Type::Constant: values[i] = constants[first[i]]; break;
+            case Type::Parameter: values[i] = context.getParameter(first[i]); break;
+            case Type::UnaryPlus: values[i] = values[first[i]]; break;
+            case Type::UnaryMinus: values[i] = -values[first[i]]; break;
+            case Type::SquareRoot: values[i] = SquareRoot::apply(values[first[i]]); break;
+            case Type::Add: values[i] = values[first[i]] + values[second[i]]; break;
+            case Type::Subtract: values[i] = values[first[i]] - values[second[i]]; break;
+            case Type::Multiply: values[i] = values[first[i]] * values[second[i]]; break;
+            case Type::Divide: values[i] = values[first[i]] / values[second[i]]; break;
+            case Type::Power: values[i] = std::pow(values[first[i]], values[second[i]]); break;
+            case Type::IntegerPower: values[i] = IntegerPower::apply(values[first[i]], values[second[i]]); break;
+            case Type::FusedMultiplyAdd: values[i] = FusedMultiplyAdd::apply(values[first[i]], values[second[i]], values[third[i]]); break;
+            case Type::FusedMultiplySubtract: values[i] = FusedMultiplySubtract::apply(values[first[i]], values[second[i]], values[third[i]]); break;
+        }
+    }
+    return values[getRoot()];
+}
+//---------------------------------------------------------------------------
+void FlatTree::print(std::ostream& out, uint32_t node) const {
+    const char* op = nullptr;
+    switch (getType(node)) {
+        case Type::Constant: out << getConstant(node); return;
+        case Type::Parameter: out << "P" << getParameterIndex(node); return;
+        case Type::UnaryPlus:
+        case Type::UnaryMinus:
+            out << ((getType(node) == Type::UnaryPlus) ? "(+" : "(-");
+            print(out, first[node]);
+            out << ")";
+            return;
+        case Type::SquareRoot:
+            out << "sqrt(";
+            print(out, first[node]);
+            out << ")";
+            return;
+        case Type::Add: op = " + "; break;
+        case Type::Subtract: op = " - "; break;
+        case Type::Multiply: op = " * "; break;
+        case Type::Divide: op = " / "; break;
+        case Type::Power:
+        case Type::IntegerPower: op = " ^ "; break;
+        case Type::FusedMultiplyAdd:
+        case Type::FusedMultiplySubtract:
+            out << ((getType(node) == Type::FusedMultiplyAdd) ? "fma(" : "fms(");
+            print(out, first[node]);
+            out << ", ";
+            print(out, second[node]);
+            out << ", ";
+            print(out, third[node]);
+            out << ")";
+            return;
+    }
+    out << "(";
+    print(out, first[node]);
+    out << op;
+    print(out, second[node]);
+    out << ")";
+}
+//---------------------------------------------------------------------------
+void FlatTree::print(std::ostream& out) const {
+    print(out, getRoot());
+}
+//---------------------------------------------------------------------------
+FlatTree FlatTree::optimize() const {
+    return FlatTreeOptimizer(*this).run();
+}
+//---------------------------------------------------------------------------
+uint32_t FlatTree::size() const {
+    return types.size();
+}
+//---------------------------------------------------------------------------
+uint32_t FlatTree::getRoot() const {
+    return types.size() - 1;
+}
+//---------------------------------------------------------------------------
+ASTNode::Type FlatTree::getType(uint32_t node) const {
+    return static_cast<Type>(types[node]);
+}
+//---------------------------------------------------------------------------
+uint32_t FlatTree::getFirst(uint32_t node) const {
+    return first[node];
+}
+//---------------------------------------------------------------------------
+uint32_t FlatTree::getSecond(uint32_t node) const {
+    return second[node];
+}
+//---------------------------------------------------------------------------
+uint32_t FlatTree::getThird(uint32_t node) const {
+    return third[node];
+}
+//---------------------------------------------------------------------------
+double FlatTree::getConstant(uint32_t node) const {
+    return constants[first[node]];
+}
+//---------------------------------------------------------------------------
+uint32_t FlatTree::getParameterIndex(uint32_t node) const {
+    return first[node];
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+#ifndef H_lib_FlatTree
+#define H_lib_FlatTree
+//---------------------------------------------------------------------------
+#include "lib/AST.hpp"
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class EvaluationContext;
+//---------------------------------------------------------------------------
+/// An expression tree stored as a structure of arrays in post-order.
+/// Node i has the type types[i]. For operators, first[i] and second[i] are the
+/// indexes of the operands, which always precede i. The fused multiply-adds
+/// keep their addend in third[i]. For constants first[i] indexes the constant
+/// pool, for parameters it is the parameter index. The root is the last node.
+/// Indexes are 32 bit, so a tree holds less than 2^32 nodes and parameters.
+class FlatTree {
+public:
+    /// Flatten a tree, the conversion keeps every node including unary plus
+    static FlatTree fromAST(const ASTNode& node);
+    /// Rebuild an equivalent tree
+    std::unique_ptr<ASTNode> toAST() const;
+
+    double evaluate(const EvaluationContext& context) const;
+    /// Evaluate using caller provided scratch space to avoid allocations
+    double evaluate(const EvaluationContext& context, std::vector<double>& scratch) const;
+    /// Print in the same format as PrintVisitor
+    void print(std::ostream& out) const;
+    /// Apply the basic algebraic subset of the ASTNode::optimize rules
+    /// (constant folding, neutral elements, negations and trivial powers) in a
+    /// single bottom-up pass, returns a compacted tree. Square roots,
+    /// integer powers and fusion are left to the Rewriter.
+    FlatTree optimize() const;
+
+    uint32_t size() const;
+    uint32_t getRoot() const;
+    ASTNode::Type getType(uint32_t node) const;
+    uint32_t getFirst(uint32_t node) const;
+    uint32_t getSecond(uint32_t node) const;
+    uint32_t getThird(uint32_t node) const;
+    double getConstant(uint32_t node) const;
+    uint32_t getParameterIndex(uint32_t node) const;
+
+private:
+    friend class FlatTreeOptimizer;
+
+    uint32_t append(ASTNode::Type type, uint32_t first, uint32_t second, uint32_t third = 0);
+    uint32_t appendConstant(double value);
+    uint32_t flatten(const ASTNode& node);
+    std::unique_ptr<ASTNode> build(uint32_t node) const;
+    void print(std::ostream& out, uint32_t node) const;
+
+    std::vector<uint8_t> types;
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> second;
+    std::vector<uint32_t> third;
+    std::vector<double> constants;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,414 @@
+#include "lib/JIT.hpp"
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/RegisterProgram.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define AST_JIT_X86_64 1
+#endif
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+#ifdef AST_JIT_X86_64
+namespace {
+//---------------------------------------------------------------------------
+/// The general purpose registers we address
+enum GPR : uint8_t {
+    RAX = 0,
+    RSP = 4,
+    RBX = 3
+};
+//---------------------------------------------------------------------------
+/// SSE opcodes (after the 0x0F escape)
+enum SSE : uint8_t {
+    MOVSD_LOAD = 0x10,
+    MOVSD_STORE = 0x11,
+    ADDSD = 0x58,
+    MULSD = 0x59,
+    SUBSD = 0x5C,
+    DIVSD = 0x5E,
+    XORPD = 0x57
+};
+//---------------------------------------------------------------------------
+/// FMA3 opcodes (after the VEX 0F38 escape), xmm = xmm * op2 +/- xmm
+enum FMA : uint8_t {
+    VFMADD231SD = 0xB9,
+    VFMSUB231SD = 0xBB
+};
+//---------------------------------------------------------------------------
+/// Virtual registers below this limit live in xmm2..xmm15, the others in stack slots
+constexpr uint32_t xmmRegisterCount = 14;
+//---------------------------------------------------------------------------
+/// A minimal x86-64 encoder for the instructions the code generator needs
+class Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    void byte(uint8_t b) { code.push_back(b); }
+    void imm32(uint32_t v) {
+        for (unsigned i = 0; i < 4; ++i) byte(v >> (8 * i));
+    }
+    void imm64(uint64_t v) {
+        for (unsigned i = 0; i < 8; ++i) byte(v >> (8 * i));
+    }
+
+    /// op xmm, xmm with the given mandatory prefix
+    void sse(uint8_t prefix, uint8_t op, uint8_t reg, uint8_t rm) {
+        byte(prefix);
+        if (reg >= 8 || rm >= 8)
+            byte(0x40 | ((reg >= 8) ? 4 : 0) | ((rm >= 8) ? 1 : 0));
+        byte(0x0F);
+        byte(op);
+        byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+    /// op xmm, [base + disp32] with the given mandatory prefix
+    void sse(uint8_t prefix, uint8_t op, uint8_t reg, GPR base, int32_t disp) {
+        byte(prefix);
+        if (reg >= 8)
+            byte(0x44);
+        byte(0x0F);
+        byte(op);
+        byte(0x80 | ((reg & 7) << 3) | base);
+        if (base == RSP)
+            byte(0x24);
+        imm32(disp);
+    }
+    /// op xmm, vvvv, xmm with a three byte VEX prefix for 66.0F38.W1
+    void fma(uint8_t op, uint8_t reg, uint8_t vvvv, uint8_t rm) {
+        vex(reg, vvvv, rm >= 8);
+        byte(op);
+        byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+    /// op xmm, vvvv, [base + disp32] with a three byte VEX prefix for 66.0F38.W1
+    void fma(uint8_t op, uint8_t reg, uint8_t vvvv, GPR base, int32_t disp) {
+        vex(reg, vvvv, false);
+        byte(op);
+        byte(0x80 | ((reg & 7) << 3) | base);
+        if (base == RSP)
+            byte(0x24);
+        imm32(disp);
+    }
+    /// The register extension bits are stored inverted
+    void vex(uint8_t reg, uint8_t vvvv, bool extendRm) {
+        byte(0xC4);
+        byte(((reg >= 8) ? 0 : 0x80) | 0x40 | (extendRm ? 0 : 0x20) | 0x02);
+        byte(0x80 | ((~vvvv & 15) << 3) | 0x01);
+    }
+    /// mov rax, imm64
+    void movRaxImm(uint64_t value) {
+        byte(0x48);
+        byte(0xB8);
+        imm64(value);
+    }
+    /// movq xmm, rax
+    void movqXmmRax(uint8_t xmm) {
+        byte(0x66);
+        byte(0x48 | ((xmm >= 8) ? 4 : 0));
+        byte(0x0F);
+        byte(0x6E);
+        byte(0xC0 | ((xmm & 7) << 3));
+    }
+    void pushRbx() { byte(0x53); }
+    void popRbx() { byte(0x5B); }
+    /// mov rbx, rdi
+    void movRbxRdi() {
+        byte(0x48);
+        byte(0x89);
+        byte(0xFB);
+    }
+    void subRsp(uint32_t size) {
+        byte(0x48);
+        byte(0x81);
+        byte(0xEC);
+        imm32(size);
+    }
+    void addRsp(uint32_t size) {
+        byte(0x48);
+        byte(0x81);
+        byte(0xC4);
+        imm32(size);
+    }
+    void callRax() {
+        byte(0xFF);
+        byte(0xD0);
+    }
+    void ret() { byte(0xC3); }
+};
+//---------------------------------------------------------------------------
+/// Translates register code into machine code
+class CodeGenerator {
+public:
+    explicit CodeGenerator(const RegisterProgram& program);
+
+    std::vector<uint8_t> generate();
+
+private:
+    bool inXmm(uint32_t reg) const { return reg < xmmRegisterCount; }
+    uint8_t xmmOf(uint32_t reg) const { return reg + 2; }
+    int32_t slotOf(uint32_t reg) const { return 8 * (reg - xmmRegisterCount); }
+
+    /// xmm0 = reg
+    void load(uint32_t reg);
+    /// reg = xmm0
+    void store(uint32_t reg);
+    /// xmm0 = xmm0 op reg
+    void apply(uint8_t op, uint32_t reg);
+    /// xmm0 = pow(reg1, reg2)
+    void power(uint32_t reg1, uint32_t reg2);
+    /// xmm0 = pow(reg, 0.5)
+    void squareRoot(uint32_t reg);
+    /// xmm0 = reg1 * reg2 + reg3 or reg1 * reg2 - reg3, rounded once
+    void fusedMultiplyAdd(bool subtract, uint32_t reg1, uint32_t reg2, uint32_t reg3);
+    /// Call a function that takes its arguments in xmm0 and xmm1 and returns
+    /// in xmm0, a third argument is loaded into xmm2 once it has been saved
+    void call(uint64_t function, std::optional<uint32_t> third = std::nullopt);
+
+    const RegisterProgram& program;
+    Assembler assembler;
+    uint32_t spillBytes;
+    uint32_t saveBytes;
+    uint32_t frameSize;
+};
+//---------------------------------------------------------------------------
+CodeGenerator::CodeGenerator(const RegisterProgram& program) : program(program) {
+    uint32_t count = program.getRegisterCount();
+    spillBytes = (count > xmmRegisterCount) ? 8 * (count - xmmRegisterCount) : 0;
+    // Calls clobber all SSE registers, we save the live ones around them
+    saveBytes = 8 * std::min(count, xmmRegisterCount);
+    // After pushing rbx the stack is 16 byte aligned, keep it that way for calls
+    frameSize = (spillBytes + saveBytes + 15) & ~15u;
+}
+//---------------------------------------------------------------------------
+void CodeGenerator::load(uint32_t reg) {
+    if (inXmm(reg))
+        assembler.sse(0xF2, MOVSD_LOAD, 0, xmmOf(reg));
+    else
+        assembler.sse(0xF2, MOVSD_LOAD, 0, RSP, slotOf(reg));
+}
+//---------------------------------------------------------------------------
+void CodeGenerator::store(uint32_t reg) {
+    if (inXmm(reg))
+        assembler.sse(0xF2, MOVSD_LOAD, xmmOf(reg), 0);
+    else
+        assembler.sse(0xF2, MOVSD_STORE, 0, RSP, slotOf(reg));
+}
+//---------------------------------------------------------------------------
+void CodeGenerator::apply(uint8_t op, uint32_t reg) {
+    if (inXmm(reg))
+        assembler.sse(0xF2, op, 0, xmmOf(reg));
+    else
+        assembler.sse(0xF2, op, 0, RSP, slotOf(reg));
+}
+//---------------------------------------------------------------------------
+void CodeGenerator::power(uint32_t reg1, uint32_t reg2) {
+    // xmm1 = reg2 first, loading reg1 goes through xmm0
+    load(reg2);
+    assembler.sse(0xF2, MOVSD_LOAD, 1, 0);
+    load(reg1);
+    double (*pow)(double, double) = std::pow;
+    call(reinterpret_cast<uint64_t>(pow));
+}
+//---------------------------------------------------------------------------
+void CodeGenerator::squareRoot(uint32_t reg) {
+    // sqrtsd alone gets -inf wrong, the special cases of pow are in SquareRoot::apply
+    load(reg);
+    double (*apply)(double) = SquareRoot::apply<double>;
+    call(reinterpret_cast<uint64_t>(apply));
+}
+//---------------------------------------------------------------------------
+void CodeGenerator::fusedMultiplyAdd(bool subtract, uint32_t reg1, uint32_t reg2, uint32_t reg3) {
+    static const bool hasFMA = __builtin_cpu_supports("fma");
+    if (!hasFMA) {
+        // std::fma emulates the single rounding in software
+        load(reg2);
+        assembler.sse(0xF2, MOVSD_LOAD, 1, 0);
+        load(reg1);
+        double (*apply)(double, double, double) = subtract ? FusedMultiplySubtract::apply<double> : FusedMultiplyAdd::apply<double>;
+        call(reinterpret_cast<uint64_t>(apply), reg3);
+        return;
+    }
+    // xmm0 = reg3, xmm1 = reg1, then xmm0 = xmm1 * reg2 +/- xmm0
+    load(reg1);
+    assembler.sse(0xF2, MOVSD_LOAD, 1, 0);
+    load(reg3);
+    uint8_t op = subtract ? VFMSUB231SD : VFMADD231SD;
+    if (inXmm(reg2))
+        assembler.fma(op, 0, 1, xmmOf(reg2));
+    else
+        assembler.fma(op, 0, 1, RSP, slotOf(reg2));
+}
+//---------------------------------------------------------------------------
+void CodeGenerator::call(uint64_t function, std::optional<uint32_t> third) {
+    uint32_t live = std::min(program.getRegisterCount(), xmmRegisterCount);
+    for (uint32_t i = 0; i < live; ++i)
+        assembler.sse(0xF2, MOVSD_STORE, xmmOf(i), RSP, spillBytes + 8 * i);
+    // xmm2 holds a virtual register, which is read from its saved copy
+    if (third)
+        assembler.sse(0xF2, MOVSD_LOAD, 2, RSP, inXmm(*third) ? spillBytes + 8 * *third : slotOf(*third));
+    assembler.movRaxImm(function);
+    assembler.callRax();
+    for (uint32_t i = 0; i < live; ++i)
+        assembler.sse(0xF2, MOVSD_LOAD, xmmOf(i), RSP, spillBytes + 8 * i);
+}
+//---------------------------------------------------------------------------
+std::vector<uint8_t> CodeGenerator::generate() {
+    // Prologue, the parameter pointer moves to rbx because calls clobber rdi
+    assembler.pushRbx();
+    assembler.movRbxRdi();
+    if (frameSize)
+        assembler.subRsp(frameSize);
+
+    const auto& constants = program.getConstants();
+    for (size_t i = 0; i < constants.size(); ++i) {
+        assembler.movRaxImm(std::bit_cast<uint64_t>(constants[i]));
+        assembler.movqXmmRax(0);
+        store(program.getConstantBase() + i);
+    }
+
+    using OpCode = RegisterProgram::OpCode;
+    for (const auto& instruction : program.getInstructions()) {
+        switch (instruction.opCode) {
+            case OpCode::LoadParameter:
+                assembler.sse(0xF2, MOVSD_LOAD, 0, RBX, static_cast<int32_t>(8 * instruction.src1));
+                break;
+            case OpCode::Negate:
+                load(instruction.src1);
+                assembler.movRaxImm(0x8000000000000000ull);
+                assembler.movqXmmRax(1);
+                assembler.sse(0x66, XORPD, 0, 1);
+                break;
+            case OpCode::Add:
+                load(instruction.src1);
+                apply(ADDSD, instruction.src2);
+                break;
+            case OpCode::Subtract:
+                load(instruction.src1);
+                apply(SUBSD, instruction.src2);
+                break;
+            case OpCode::Multiply:
+                load(instruction.src1);
+                apply(MULSD, instruction.src2);
+                break;
+            case OpCode::Divide:
+                load(instruction.src1);
+                apply(DIVSD, instruction.src2);
+                break;
+            case OpCode::SquareRoot:
+                squareRoot(instruction.src1);
+                break;
+            case OpCode::Power:
+                power(instruction.src1, instruction.src2);
+                break;
+            case OpCode::FusedMultiplyAdd:
+            case OpCode::FusedMultiplySubtract:
+                fusedMultiplyAdd(instruction.opCode == OpCode::FusedMultiplySubtract, instruction.src1, instruction.src2, instruction.src3);
+                break;
+        }
+        store(instruction.dst);
+    }
+
+    // Epilogue, the result is returned in xmm0
+    load(program.getResultRegister());
+    if (frameSize)
+        assembler.addRsp(frameSize);
+    assembler.popRbx();
+    assembler.ret();
+    return std::move(assembler.code);
+}
+//---------------------------------------------------------------------------
+} // namespace
+#endif
+//---------------------------------------------------------------------------
+JITFunction::JITFunction(void* memory, size_t mappingSize, size_t codeSize, size_t parameterCount)
+    : memory(memory), mappingSize(mappingSize), codeSize(codeSize), parameterCount(parameterCount) {}
+//---------------------------------------------------------------------------
+JITFunction::~JITFunction() {
+#ifdef AST_JIT_X86_64
+    munmap(memory, mappingSize);
+#endif
+}
+//---------------------------------------------------------------------------
+bool JITFunction::isSupported() {
+#ifdef AST_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+//---------------------------------------------------------------------------
+std::unique_ptr<JITFunction> JITFunction::compile(const ASTNode& node) {
+#ifdef AST_JIT_X86_64
+    RegisterProgram program;
+    try {
+        program = RegisterProgram::compile(node);
+    } catch (const std::out_of_range&) {
+        return nullptr;
+    }
+    size_t parameterCount = 0;
+    for (const auto& instruction : program.getInstructions())
+        if (instruction.opCode == RegisterProgram::OpCode::LoadParameter)
+            parameterCount = std::max<size_t>(parameterCount, instruction.src1 + size_t(1));
+    // Parameters are loaded with a 32 bit displacement, larger indexes are left to the interpreters
+    if (parameterCount && parameterCount - 1 > std::numeric_limits<int32_t>::max() / sizeof(double))
+        return nullptr;
+    std::vector<uint8_t> code = CodeGenerator(program).generate();
+
+    // Write the code into fresh pages and only then make them executable
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t mappingSize = (code.size() + pageSize - 1) / pageSize * pageSize;
+    void* memory = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return nullptr;
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, mappingSize, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, mappingSize);
+        return nullptr;
+    }
+    return std::unique_ptr<JITFunction>(new JITFunction(memory, mappingSize, code.size(), parameterCount));
+#else
+    (void) node;
+    return nullptr;
+#endif
+}
+//---------------------------------------------------------------------------
+JITFunction::Signature JITFunction::getFunction() const {
+    return reinterpret_cast<Signature>(memory);
+}
+//---------------------------------------------------------------------------
+double JITFunction::operator()(const double* params) const {
+    return getFunction()(params);
+}
+//---------------------------------------------------------------------------
+double JITFunction::evaluate(const EvaluationContext& context) const {
+    constexpr size_t inlineCount = 16;
+    double inlineParams[inlineCount];
+    std::vector<double> heapParams;
+    double* params = inlineParams;
+    if (parameterCount > inlineCount) {
+        heapParams.resize(parameterCount);
+        params = heapParams.data();
+    }
+    context.copyParameters(params, parameterCount);
+    return getFunction()(params);
+}
+//---------------------------------------------------------------------------
+size_t JITFunction::getParameterCount() const {
+    return parameterCount;
+}
+//---------------------------------------------------------------------------
+size_t JITFunction::getCodeSize() const {
+    return codeSize;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
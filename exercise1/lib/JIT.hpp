@@ -0,0 +1,55 @@
+#ifndef H_lib_JIT
+#define H_lib_JIT
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <memory>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+class EvaluationContext;
+//---------------------------------------------------------------------------
+/// Native x86-64 code for an expression tree.
+/// The tree is lowered through a RegisterProgram, the first registers are kept
+/// in SSE registers and the rest in stack slots. Power calls std::pow and an
+/// IntegerPower multiplies along its addition chain like IntegerPower::apply,
+/// so the results match ASTNode::evaluate exactly. The fused multiply-adds use
+/// the FMA instructions if the CPU has them and std::fma otherwise.
+class JITFunction {
+public:
+    /// The signature of the generated code, params[i] is the value of parameter i
+    using Signature = double (*)(const double* params);
+
+    /// Whether native code can be generated on this host
+    static bool isSupported();
+    /// Generate native code for a tree, returns nullptr if that is not possible
+    /// on this host or for parameter indexes of 2^28 and more. Callers are
+    /// expected to fall back to an interpreter in that case.
+    static std::unique_ptr<JITFunction> compile(const ASTNode& node);
+
+    JITFunction(const JITFunction&) = delete;
+    JITFunction& operator=(const JITFunction&) = delete;
+    ~JITFunction();
+
+    /// The entry point, params must hold at least getParameterCount() values
+    Signature getFunction() const;
+    double operator()(const double* params) const;
+    /// Evaluate with the same out of range semantics as EvaluationContext
+    double evaluate(const EvaluationContext& context) const;
+    /// One more than the largest parameter index used by the expression
+    size_t getParameterCount() const;
+    /// The size of the generated machine code in bytes
+    size_t getCodeSize() const;
+
+private:
+    JITFunction(void* memory, size_t mappingSize, size_t codeSize, size_t parameterCount);
+
+    void* memory;
+    size_t mappingSize;
+    size_t codeSize;
+    size_t parameterCount;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
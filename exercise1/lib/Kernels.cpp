@@ -0,0 +1,617 @@
+#include "lib/Kernels.hpp"
+#include "lib/AST.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <type_traits>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define AST_KERNELS_X86_64 1
+#define AST_TARGET(isa) __attribute__((target(isa)))
+#define AST_INLINE __attribute__((always_inline)) inline
+#endif
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The operators, with one apply for scalars and one per vector type
+struct AddOp {
+    template <typename T>
+    static T apply(T a, T b) { return a + b; }
+#ifdef AST_KERNELS_X86_64
+    AST_TARGET("sse2") static __m128d apply(__m128d a, __m128d b) { return _mm_add_pd(a, b); }
+    AST_TARGET("sse2") static __m128 apply(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+    AST_TARGET("avx2") static __m256d apply(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+    AST_TARGET("avx2") static __m256 apply(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+    AST_TARGET("avx512f") static __m512d apply(__m512d a, __m512d b) { return _mm512_add_pd(a, b); }
+    AST_TARGET("avx512f") static __m512 apply(__m512 a, __m512 b) { return _mm512_add_ps(a, b); }
+#endif
+};
+//---------------------------------------------------------------------------
+struct SubtractOp {
+    template <typename T>
+    static T apply(T a, T b) { return a - b; }
+#ifdef AST_KERNELS_X86_64
+    AST_TARGET("sse2") static __m128d apply(__m128d a, __m128d b) { return _mm_sub_pd(a, b); }
+    AST_TARGET("sse2") static __m128 apply(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+    AST_TARGET("avx2") static __m256d apply(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+    AST_TARGET("avx2") static __m256 apply(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+    AST_TARGET("avx512f") static __m512d apply(__m512d a, __m512d b) { return _mm512_sub_pd(a, b); }
+    AST_TARGET("avx512f") static __m512 apply(__m512 a, __m512 b) { return _mm512_sub_ps(a, b); }
+#endif
+};
+//---------------------------------------------------------------------------
+struct MultiplyOp {
+    template <typename T>
+    static T apply(T a, T b) { return a * b; }
+#ifdef AST_KERNELS_X86_64
+    AST_TARGET("sse2") static __m128d apply(__m128d a, __m128d b) { return _mm_mul_pd(a, b); }
+    AST_TARGET("sse2") static __m128 apply(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+    AST_TARGET("avx2") static __m256d apply(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+    AST_TARGET("avx2") static __m256 apply(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+    AST_TARGET("avx512f") static __m512d apply(__m512d a, __m512d b) { return _mm512_mul_pd(a, b); }
+    AST_TARGET("avx512f") static __m512 apply(__m512 a, __m512 b) { return _mm512_mul_ps(a, b); }
+#endif
+};
+//---------------------------------------------------------------------------
+struct DivideOp {
+    template <typename T>
+    static T apply(T a, T b) { return a / b; }
+#ifdef AST_KERNELS_X86_64
+    AST_TARGET("sse2") static __m128d apply(__m128d a, __m128d b) { return _mm_div_pd(a, b); }
+    AST_TARGET("sse2") static __m128 apply(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+    AST_TARGET("avx2") static __m256d apply(__m256d a, __m256d b) { return _mm256_div_pd(a, b); }
+    AST_TARGET("avx2") static __m256 apply(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+    AST_TARGET("avx512f") static __m512d apply(__m512d a, __m512d b) { return _mm512_div_pd(a, b); }
+    AST_TARGET("avx512f") static __m512 apply(__m512 a, __m512 b) { return _mm512_div_ps(a, b); }
+#endif
+};
+//---------------------------------------------------------------------------
+/// a * b + c and a * b - c with a single rounding, SSE2 has no FMA instructions
+struct MultiplyAddOp {
+    template <typename T>
+    static T apply(T a, T b, T c) { return std::fma(a, b, c); }
+#ifdef AST_KERNELS_X86_64
+    AST_TARGET("avx2,fma") static __m256d apply(__m256d a, __m256d b, __m256d c) { return _mm256_fmadd_pd(a, b, c); }
+    AST_TARGET("avx2,fma") static __m256 apply(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+    AST_TARGET("avx512f") static __m512d apply(__m512d a, __m512d b, __m512d c) { return _mm512_fmadd_pd(a, b, c); }
+    AST_TARGET("avx512f") static __m512 apply(__m512 a, __m512 b, __m512 c) { return _mm512_fmadd_ps(a, b, c); }
+#endif
+};
+//---------------------------------------------------------------------------
+struct MultiplySubtractOp {
+    template <typename T>
+    static T apply(T a, T b, T c) { return std::fma(a, b, -c); }
+#ifdef AST_KERNELS_X86_64
+    AST_TARGET("avx2,fma") static __m256d apply(__m256d a, __m256d b, __m256d c) { return _mm256_fmsub_pd(a, b, c); }
+    AST_TARGET("avx2,fma") static __m256 apply(__m256 a, __m256 b, __m256 c) { return _mm256_fmsub_ps(a, b, c); }
+    AST_TARGET("avx512f") static __m512d apply(__m512d a, __m512d b, __m512d c) { return _mm512_fmsub_pd(a, b, c); }
+    AST_TARGET("avx512f") static __m512 apply(__m512 a, __m512 b, __m512 c) { return _mm512_fmsub_ps(a, b, c); }
+#endif
+};
+//---------------------------------------------------------------------------
+/// Negation flips the sign bit, which matches -a also for zeros and NaNs
+struct NegateOp {
+    template <typename T>
+    static T apply(T a) { return -a; }
+#ifdef AST_KERNELS_X86_64
+    AST_TARGET("sse2") static __m128d apply(__m128d a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+    AST_TARGET("sse2") static __m128 apply(__m128 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+    AST_TARGET("avx2") static __m256d apply(__m256d a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    AST_TARGET("avx2") static __m256 apply(__m256 a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    // The floating-point xor needs avx512dq, the integer one does not
+    AST_TARGET("avx512f") static __m512d apply(__m512d a) {
+        return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(INT64_MIN)));
+    }
+    AST_TARGET("avx512f") static __m512 apply(__m512 a) {
+        return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32(INT32_MIN)));
+    }
+#endif
+};
+//---------------------------------------------------------------------------
+/// pow(a, 0.5), unlike sqrt it maps -0 to +0 and -inf to +inf
+struct SquareRootOp {
+    template <typename T>
+    static T apply(T a) { return SquareRoot::apply(a); }
+#ifdef AST_KERNELS_X86_64
+    AST_TARGET("sse2") static __m128d apply(__m128d a) {
+        __m128d result = _mm_add_pd(_mm_sqrt_pd(a), _mm_setzero_pd());
+        __m128d minusInfinity = _mm_cmpeq_pd(a, _mm_set1_pd(-INFINITY));
+        return _mm_or_pd(_mm_andnot_pd(minusInfinity, result), _mm_and_pd(minusInfinity, _mm_set1_pd(INFINITY)));
+    }
+    AST_TARGET("sse2") static __m128 apply(__m128 a) {
+        __m128 result = _mm_add_ps(_mm_sqrt_ps(a), _mm_setzero_ps());
+        __m128 minusInfinity = _mm_cmpeq_ps(a, _mm_set1_ps(-INFINITY));
+        return _mm_or_ps(_mm_andnot_ps(minusInfinity, result), _mm_and_ps(minusInfinity, _mm_set1_ps(INFINITY)));
+    }
+    AST_TARGET("avx2") static __m256d apply(__m256d a) {
+        __m256d result = _mm256_add_pd(_mm256_sqrt_pd(a), _mm256_setzero_pd());
+        return _mm256_blendv_pd(result, _mm256_set1_pd(INFINITY), _mm256_cmp_pd(a, _mm256_set1_pd(-INFINITY), _CMP_EQ_OQ));
+    }
+    AST_TARGET("avx2") static __m256 apply(__m256 a) {
+        __m256 result = _mm256_add_ps(_mm256_sqrt_ps(a), _mm256_setzero_ps());
+        return _mm256_blendv_ps(result, _mm256_set1_ps(INFINITY), _mm256_cmp_ps(a, _mm256_set1_ps(-INFINITY), _CMP_EQ_OQ));
+    }
+    AST_TARGET("avx512f") static __m512d apply(__m512d a) {
+        // The masked form avoids GCC's false uninitialized warning for _mm512_sqrt_pd
+        __m512d result = _mm512_add_pd(_mm512_mask_sqrt_pd(a, 0xFF, a), _mm512_setzero_pd());
+        return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, _mm512_set1_pd(-INFINITY), _CMP_EQ_OQ), result, _mm512_set1_pd(INFINITY));
+    }
+    AST_TARGET("avx512f") static __m512 apply(__m512 a) {
+        __m512 result = _mm512_add_ps(_mm512_mask_sqrt_ps(a, 0xFFFF, a), _mm512_setzero_ps());
+        return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, _mm512_set1_ps(-INFINITY), _CMP_EQ_OQ), result, _mm512_set1_ps(INFINITY));
+    }
+#endif
+};
+//---------------------------------------------------------------------------
+/// pow(a, -0.5) as a division, which is accurate unlike the rsqrt approximations
+struct ReciprocalSquareRootOp {
+    template <typename T>
+    static T apply(T a) { return T(1) / SquareRootOp::apply(a); }
+#ifdef AST_KERNELS_X86_64
+    AST_TARGET("sse2") static __m128d apply(__m128d a) { return _mm_div_pd(_mm_set1_pd(1.0), SquareRootOp::apply(a)); }
+    AST_TARGET("sse2") static __m128 apply(__m128 a) { return _mm_div_ps(_mm_set1_ps(1.0f), SquareRootOp::apply(a)); }
+    AST_TARGET("avx2") static __m256d apply(__m256d a) { return _mm256_div_pd(_mm256_set1_pd(1.0), SquareRootOp::apply(a)); }
+    AST_TARGET("avx2") static __m256 apply(__m256 a) { return _mm256_div_ps(_mm256_set1_ps(1.0f), SquareRootOp::apply(a)); }
+    AST_TARGET("avx512f") static __m512d apply(__m512d a) { return _mm512_div_pd(_mm512_set1_pd(1.0), SquareRootOp::apply(a)); }
+    AST_TARGET("avx512f") static __m512 apply(__m512 a) { return _mm512_div_ps(_mm512_set1_ps(1.0f), SquareRootOp::apply(a)); }
+#endif
+};
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+void unaryScalar(T* a, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        a[i] = Op::apply(a[i]);
+}
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+void binaryScalar(T* a, const T* b, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        a[i] = Op::apply(a[i], b[i]);
+}
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+void ternaryScalar(T* a, const T* b, const T* c, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        a[i] = Op::apply(a[i], b[i], c[i]);
+}
+//---------------------------------------------------------------------------
+template <typename T>
+void powerScalar(T* a, const T* b, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        a[i] = std::pow(a[i], b[i]);
+}
+//---------------------------------------------------------------------------
+#ifdef AST_KERNELS_X86_64
+/// Unaligned loads and stores of the vector types of an instruction set
+template <typename T>
+struct SSE2Vector;
+template <>
+struct SSE2Vector<double> {
+    using Type = __m128d;
+    static constexpr size_t width = 2;
+    AST_TARGET("sse2") static Type load(const double* a) { return _mm_loadu_pd(a); }
+    AST_TARGET("sse2") static void store(double* a, Type value) { _mm_storeu_pd(a, value); }
+};
+template <>
+struct SSE2Vector<float> {
+    using Type = __m128;
+    static constexpr size_t width = 4;
+    AST_TARGET("sse2") static Type load(const float* a) { return _mm_loadu_ps(a); }
+    AST_TARGET("sse2") static void store(float* a, Type value) { _mm_storeu_ps(a, value); }
+};
+//---------------------------------------------------------------------------
+template <typename T>
+struct AVX2Vector;
+template <>
+struct AVX2Vector<double> {
+    using Type = __m256d;
+    static constexpr size_t width = 4;
+    AST_TARGET("avx2") static Type load(const double* a) { return _mm256_loadu_pd(a); }
+    AST_TARGET("avx2") static void store(double* a, Type value) { _mm256_storeu_pd(a, value); }
+};
+template <>
+struct AVX2Vector<float> {
+    using Type = __m256;
+    static constexpr size_t width = 8;
+    AST_TARGET("avx2") static Type load(const float* a) { return _mm256_loadu_ps(a); }
+    AST_TARGET("avx2") static void store(float* a, Type value) { _mm256_storeu_ps(a, value); }
+};
+//---------------------------------------------------------------------------
+/// The masked variants load the inactive lanes as 1, so that the tail never divides by zero
+template <typename T>
+struct AVX512Vector;
+template <>
+struct AVX512Vector<double> {
+    using Type = __m512d;
+    using Mask = __mmask8;
+    static constexpr size_t width = 8;
+    AST_TARGET("avx512f") static Type load(const double* a) { return _mm512_loadu_pd(a); }
+    AST_TARGET("avx512f") static void store(double* a, Type value) { _mm512_storeu_pd(a, value); }
+    AST_TARGET("avx512f") static Type load(const double* a, Mask mask) { return _mm512_mask_loadu_pd(_mm512_set1_pd(1.0), mask, a); }
+    AST_TARGET("avx512f") static void store(double* a, Type value, Mask mask) { _mm512_mask_storeu_pd(a, mask, value); }
+};
+template <>
+struct AVX512Vector<float> {
+    using Type = __m512;
+    using Mask = __mmask16;
+    static constexpr size_t width = 16;
+    AST_TARGET("avx512f") static Type load(const float* a) { return _mm512_loadu_ps(a); }
+    AST_TARGET("avx512f") static void store(float* a, Type value) { _mm512_storeu_ps(a, value); }
+    AST_TARGET("avx512f") static Type load(const float* a, Mask mask) { return _mm512_mask_loadu_ps(_mm512_set1_ps(1.0f), mask, a); }
+    AST_TARGET("avx512f") static void store(float* a, Type value, Mask mask) { _mm512_mask_storeu_ps(a, mask, value); }
+};
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+AST_TARGET("sse2") void unarySSE2(T* a, size_t count) {
+    using V = SSE2Vector<T>;
+    size_t i = 0;
+    for (; i + V::width <= count; i += V::width)
+        V::store(a + i, Op::apply(V::load(a + i)));
+    unaryScalar<T, Op>(a + i, count - i);
+}
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+AST_TARGET("sse2") void binarySSE2(T* a, const T* b, size_t count) {
+    using V = SSE2Vector<T>;
+    size_t i = 0;
+    for (; i + V::width <= count; i += V::width)
+        V::store(a + i, Op::apply(V::load(a + i), V::load(b + i)));
+    binaryScalar<T, Op>(a + i, b + i, count - i);
+}
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+AST_TARGET("avx2") void unaryAVX2(T* a, size_t count) {
+    using V = AVX2Vector<T>;
+    size_t i = 0;
+    for (; i + V::width <= count; i += V::width)
+        V::store(a + i, Op::apply(V::load(a + i)));
+    unaryScalar<T, Op>(a + i, count - i);
+}
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+AST_TARGET("avx2") void binaryAVX2(T* a, const T* b, size_t count) {
+    using V = AVX2Vector<T>;
+    size_t i = 0;
+    for (; i + V::width <= count; i += V::width)
+        V::store(a + i, Op::apply(V::load(a + i), V::load(b + i)));
+    binaryScalar<T, Op>(a + i, b + i, count - i);
+}
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+AST_TARGET("avx2,fma") void ternaryAVX2(T* a, const T* b, const T* c, size_t count) {
+    using V = AVX2Vector<T>;
+    size_t i = 0;
+    for (; i + V::width <= count; i += V::width)
+        V::store(a + i, Op::apply(V::load(a + i), V::load(b + i), V::load(c + i)));
+    ternaryScalar<T, Op>(a + i, b + i, c + i, count - i);
+}
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+AST_TARGET("avx512f") void unaryAVX512(T* a, size_t count) {
+    using V = AVX512Vector<T>;
+    size_t i = 0;
+    for (; i + V::width <= count; i += V::width)
+        V::store(a + i, Op::apply(V::load(a + i)));
+    // The tail uses masked loads and stores instead of a scalar loop
+    auto mask = static_cast<typename V::Mask>((1u << (count - i)) - 1);
+    V::store(a + i, Op::apply(V::load(a + i, mask)), mask);
+}
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+AST_TARGET("avx512f") void binaryAVX512(T* a, const T* b, size_t count) {
+    using V = AVX512Vector<T>;
+    size_t i = 0;
+    for (; i + V::width <= count; i += V::width)
+        V::store(a + i, Op::apply(V::load(a + i), V::load(b + i)));
+    auto mask = static_cast<typename V::Mask>((1u << (count - i)) - 1);
+    V::store(a + i, Op::apply(V::load(a + i, mask), V::load(b + i, mask)), mask);
+}
+//---------------------------------------------------------------------------
+template <typename T, typename Op>
+AST_TARGET("avx512f") void ternaryAVX512(T* a, const T* b, const T* c, size_t count) {
+    using V = AVX512Vector<T>;
+    size_t i = 0;
+    for (; i + V::width <= count; i += V::width)
+        V::store(a + i, Op::apply(V::load(a + i), V::load(b + i), V::load(c + i)));
+    auto mask = static_cast<typename V::Mask>((1u << (count - i)) - 1);
+    V::store(a + i, Op::apply(V::load(a + i, mask), V::load(b + i, mask), V::load(c + i, mask)), mask);
+}
+//---------------------------------------------------------------------------
+// The general pow is written with the GCC/Clang vector extensions and
+// inlined into its wrapper. It must not take or return vectors by value,
+// which would depend on the caller's ABI.
+//---------------------------------------------------------------------------
+/// Vectors with the given number of lanes and their 64 bit integers
+template <typename T, size_t width>
+struct Lanes;
+template <>
+struct Lanes<double, 8> {
+    using Type = double __attribute__((vector_size(64)));
+    using Int = int64_t __attribute__((vector_size(64)));
+};
+//---------------------------------------------------------------------------
+// The general pow only beats libm with 8 lanes. Its masks need avx512dq, and
+// GCC lowers vector code for the target of the function that contains it
+// before inlining, so the helpers are compiled for AVX-512 as a whole.
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq")
+//---------------------------------------------------------------------------
+/// sum + error = a + b exactly, requires |a| >= |b|
+template <typename D>
+AST_INLINE void fastTwoSum(const D& a, const D& b, D& sum, D& error) {
+    sum = a + b;
+    error = b - (sum - a);
+}
+//---------------------------------------------------------------------------
+/// sum + error = a + b exactly
+template <typename D>
+AST_INLINE void twoSum(const D& a, const D& b, D& sum, D& error) {
+    sum = a + b;
+    D b2 = sum - a;
+    error = (a - (sum - b2)) + (b - b2);
+}
+//---------------------------------------------------------------------------
+/// product + error = a * b up to 2^-105 relative. The operands are split by
+/// masking instead of Veltkamp's multiplication, so the result does not change
+/// when the compiler contracts multiplications and additions into FMAs.
+template <typename D, typename I>
+AST_INLINE void twoProduct(const D& a, const D& b, D& product, D& error) {
+    const I mask = I{} + static_cast<int64_t>(0xFFFFFFFFF8000000ull);
+    D aHigh = (D) ((I) a & mask);
+    D aLow = a - aHigh;
+    D bHigh = (D) ((I) b & mask);
+    D bLow = b - bHigh;
+    product = a * b;
+    error = ((aHigh * bHigh - product) + aHigh * bLow + aLow * bHigh) + aLow * bLow;
+}
+//---------------------------------------------------------------------------
+/// a = pow(a, b) for width lanes, computed as exp(b * log(a)) in double-double
+/// arithmetic. Lanes outside of the fast path (a not positive, normal and
+/// finite or b not finite) are recomputed with std::pow.
+AST_INLINE void powerLanes(double* a, const double* b) {
+    constexpr size_t width = 8;
+    using D = Lanes<double, width>::Type;
+    using I = Lanes<double, width>::Int;
+    D x, y;
+    std::memcpy(&x, a, sizeof(D));
+    std::memcpy(&y, b, sizeof(D));
+    const D zero = D{};
+    const D one = zero + 1.0;
+    const D infinity = zero + INFINITY;
+
+    D absY = (D) ((I) y & static_cast<int64_t>(0x7FFFFFFFFFFFFFFFull));
+    I fast = (x >= 0x1p-1022) & (x < infinity) & (absY < infinity);
+    x = fast ? x : one;
+    y = fast ? y : zero;
+
+    // log(x) = e * ln2 + log(m) with m in [sqrt(1/2), sqrt(2))
+    I bits = (I) x;
+    I e = (bits >> 52) - 1023;
+    D m = (D) ((bits & 0x000FFFFFFFFFFFFFll) | 0x3FF0000000000000ll);
+    I big = m > std::numbers::sqrt2;
+    m = big ? m * 0.5 : m;
+    e -= big;
+    // Adding the integer to the bits of 1.5 * 2^52 converts it exactly
+    const double magic = 0x1.8p52;
+    D eDouble = (D) (e + (I) (zero + magic)) - magic;
+
+    // log(m) = 2 atanh(s) = 2s + 2s^3/3 + 2s^5/5 + ... with s = f / (2 + f), |s| < 0.172
+    D f = m - 1.0;
+    D d = f + 2.0;
+    D dLow = f - (d - 2.0);
+    D s = f / d;
+    D p, pLow;
+    twoProduct<D, I>(s, d, p, pLow);
+    D sLow = (((f - p) - pLow) - s * dLow) / d;
+    // The s^3 term dominates the remaining error and is computed as double-double
+    D s2, s2Low, s3, s3Low;
+    twoProduct<D, I>(s, s, s2, s2Low);
+    twoProduct<D, I>(s, s2, s3, s3Low);
+    s3Low += s * s2Low + 3.0 * s2 * sLow;
+    const double twoThirds = 2.0 / 3;
+    const double twoThirdsLow = 3.700743415417188e-17;
+    D cubic, cubicLow;
+    twoProduct<D, I>(s3, zero + twoThirds, cubic, cubicLow);
+    cubicLow += s3 * twoThirdsLow + s3Low * twoThirds;
+    D tail = zero + 2.0 / 25;
+    tail = tail * s2 + 2.0 / 23;
+    tail = tail * s2 + 2.0 / 21;
+    tail = tail * s2 + 2.0 / 19;
+    tail = tail * s2 + 2.0 / 17;
+    tail = tail * s2 + 2.0 / 15;
+    tail = tail * s2 + 2.0 / 13;
+    tail = tail * s2 + 2.0 / 11;
+    tail = tail * s2 + 2.0 / 9;
+    tail = tail * s2 + 2.0 / 7;
+    tail = tail * s2 + 2.0 / 5;
+    tail = tail * s2 * s3;
+    D logM, logMLow, sum, sumLow;
+    fastTwoSum(2.0 * s, cubic, sum, sumLow);
+    fastTwoSum(sum, sumLow + (2.0 * sLow + cubicLow + tail), logM, logMLow);
+
+    // ln2High has enough trailing zeros that multiples up to 2^11 are exact
+    const double ln2High = 6.93147180369123816490e-01;
+    const double ln2Low = 1.90821492927058770002e-10;
+    D logX, logXLow;
+    twoSum(eDouble * ln2High, logM, sum, sumLow);
+    fastTwoSum(sum, sumLow + eDouble * ln2Low + logMLow, logX, logXLow);
+
+    // t = y * log(x), clamped to where the result is 0 or infinite anyway
+    D t, tLow;
+    twoProduct<D, I>(y, logX, t, tLow);
+    tLow += y * logXLow;
+    I inRange = (t < 1080.0) & (t > -1080.0);
+    t = inRange ? t : ((t > 0.0) ? zero + 1080.0 : zero - 1080.0);
+    tLow = inRange ? tLow : zero;
+
+    // exp(t) = 2^n * exp(r) with |r| <= ln2 / 2, the Taylor series up to r^13
+    D k = t * 1.4426950408889634 + magic;
+    I n = (I) k - (I) (zero + magic);
+    D nDouble = k - magic;
+    D r = (t - nDouble * ln2High) - nDouble * ln2Low + tLow;
+    D q = zero + 1.0 / 6227020800.0;
+    q = q * r + 1.0 / 479001600.0;
+    q = q * r + 1.0 / 39916800.0;
+    q = q * r + 1.0 / 3628800.0;
+    q = q * r + 1.0 / 362880.0;
+    q = q * r + 1.0 / 40320.0;
+    q = q * r + 1.0 / 5040.0;
+    q = q * r + 1.0 / 720.0;
+    q = q * r + 1.0 / 120.0;
+    q = q * r + 1.0 / 24.0;
+    q = q * r + 1.0 / 6.0;
+    q = q * r + 0.5;
+    D result = 1.0 + (r + r * r * q);
+    // Two factors keep 2^n representable close to overflow and underflow
+    I n1 = n >> 1;
+    I n2 = n - n1;
+    result = result * (D) ((n1 + 1023) << 52) * (D) ((n2 + 1023) << 52);
+
+    std::array<double, width> original;
+    std::memcpy(original.data(), a, sizeof(D));
+    std::memcpy(a, &result, sizeof(D));
+    auto lanes = std::bit_cast<std::array<int64_t, width>>(fast);
+    for (size_t i = 0; i < width; ++i)
+        if (!lanes[i])
+            a[i] = std::pow(original[i], b[i]);
+}
+//---------------------------------------------------------------------------
+AST_INLINE void powerVector(double* a, const double* b, size_t count) {
+    constexpr size_t width = 8;
+    size_t i = 0;
+    for (; i + width <= count; i += width)
+        powerLanes(a + i, b + i);
+    if (i == count)
+        return;
+    // The tail is padded with 1^1 and runs through the same code, so results
+    // do not depend on the position of a row
+    std::array<double, width> x, y;
+    x.fill(1.0);
+    y.fill(1.0);
+    std::copy_n(a + i, count - i, x.data());
+    std::copy_n(b + i, count - i, y.data());
+    powerLanes(x.data(), y.data());
+    std::copy_n(x.data(), count - i, a + i);
+}
+#pragma GCC pop_options
+//---------------------------------------------------------------------------
+AST_TARGET("avx512f,avx512dq") void powerAVX512(double* a, const double* b, size_t count) {
+    powerVector(a, b, count);
+}
+#endif
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+template <typename T>
+BasicKernels<T> makeKernels(InstructionSets::ISA isa) {
+    using ISA = InstructionSets::ISA;
+#ifdef AST_KERNELS_X86_64
+    // long double only exists in the x87 registers
+    if constexpr (!std::is_same_v<T, long double>) {
+        switch (isa) {
+            case ISA::SSE2:
+                return {{}, unarySSE2<T, NegateOp>, binarySSE2<T, AddOp>, binarySSE2<T, SubtractOp>, binarySSE2<T, MultiplyOp>, binarySSE2<T, DivideOp>,
+                        ternaryScalar<T, MultiplyAddOp>, ternaryScalar<T, MultiplySubtractOp>,
+                        powerScalar<T>, unarySSE2<T, SquareRootOp>, unarySSE2<T, ReciprocalSquareRootOp>};
+            case ISA::AVX2:
+                return {{}, unaryAVX2<T, NegateOp>, binaryAVX2<T, AddOp>, binaryAVX2<T, SubtractOp>, binaryAVX2<T, MultiplyOp>, binaryAVX2<T, DivideOp>,
+                        ternaryAVX2<T, MultiplyAddOp>, ternaryAVX2<T, MultiplySubtractOp>,
+                        powerScalar<T>, unaryAVX2<T, SquareRootOp>, unaryAVX2<T, ReciprocalSquareRootOp>};
+            case ISA::AVX512: {
+                BasicKernels<T> kernels = {{}, unaryAVX512<T, NegateOp>, binaryAVX512<T, AddOp>, binaryAVX512<T, SubtractOp>, binaryAVX512<T, MultiplyOp>, binaryAVX512<T, DivideOp>,
+                                           ternaryAVX512<T, MultiplyAddOp>, ternaryAVX512<T, MultiplySubtractOp>,
+                                           powerScalar<T>, unaryAVX512<T, SquareRootOp>, unaryAVX512<T, ReciprocalSquareRootOp>};
+                // The general pow for float goes through libm's powf
+                if constexpr (std::is_same_v<T, double>)
+                    kernels.power = powerAVX512;
+                return kernels;
+            }
+            default:
+                break;
+        }
+    }
+#else
+    (void) isa;
+#endif
+    return {{}, unaryScalar<T, NegateOp>, binaryScalar<T, AddOp>, binaryScalar<T, SubtractOp>, binaryScalar<T, MultiplyOp>, binaryScalar<T, DivideOp>,
+            ternaryScalar<T, MultiplyAddOp>, ternaryScalar<T, MultiplySubtractOp>,
+            powerScalar<T>, unaryScalar<T, SquareRootOp>, unaryScalar<T, ReciprocalSquareRootOp>};
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+bool InstructionSets::isSupported(ISA isa) {
+    switch (isa) {
+        case ISA::Scalar:
+            return true;
+#ifdef AST_KERNELS_X86_64
+        case ISA::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case ISA::AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case ISA::AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+#endif
+        default:
+            return false;
+    }
+}
+//---------------------------------------------------------------------------
+InstructionSets::ISA InstructionSets::getBestISA() {
+    static const ISA best = [] {
+        ISA result = ISA::Scalar;
+        for (size_t i = 1; i < isaCount; ++i)
+            if (isSupported(static_cast<ISA>(i)))
+                result = static_cast<ISA>(i);
+        return result;
+    }();
+    return best;
+}
+//---------------------------------------------------------------------------
+const char* InstructionSets::getISAName(ISA isa) {
+    switch (isa) {
+        case ISA::Scalar: return "Scalar";
+        case ISA::SSE2: return "SSE2";
+        case ISA::AVX2: return "AVX2";
+        case ISA::AVX512: return "AVX512";
+    }
+    return "";
+}
+//---------------------------------------------------------------------------
+template <typename T>
+const BasicKernels<T>& BasicKernels<T>::get(ISA isa) {
+    static const BasicKernels kernels[isaCount] = {makeKernels<T>(ISA::Scalar), makeKernels<T>(ISA::SSE2), makeKernels<T>(ISA::AVX2), makeKernels<T>(ISA::AVX512)};
+    isa = std::min(isa, getBestISA());
+    return kernels[static_cast<size_t>(isa)];
+}
+//---------------------------------------------------------------------------
+template <typename T>
+const BasicKernels<T>& BasicKernels<T>::get() {
+    return get(getBestISA());
+}
+//---------------------------------------------------------------------------
+template <typename T>
+void BasicKernels<T>::powerConstant(T* a, T exponent, size_t count) const {
+    if (exponent == T(0.5)) {
+        squareRoot(a, count);
+    } else if (exponent == T(-0.5)) {
+        reciprocalSquareRoot(a, count);
+    } else {
+        constexpr size_t chunkSize = 256;
+        T exponents[chunkSize];
+        std::fill_n(exponents, chunkSize, exponent);
+        for (size_t i = 0; i < count; i += chunkSize)
+            power(a + i, exponents, std::min(chunkSize, count - i));
+    }
+}
+//---------------------------------------------------------------------------
+template struct BasicKernels<float>;
+template struct BasicKernels<double>;
+template struct BasicKernels<long double>;
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
@@ -0,0 +1,85 @@
+#ifndef H_lib_Kernels
+#define H_lib_Kernels
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+/// The instruction set levels of the kernels and their detection, shared by
+/// the kernels of all scalar types
+struct InstructionSets {
+    /// The instruction set levels, each one includes the previous ones
+    enum class ISA : uint8_t {
+        Scalar,
+        SSE2,
+        /// AVX2 and FMA
+        AVX2,
+        /// AVX-512 F and DQ
+        AVX512
+    };
+    static constexpr size_t isaCount = 4;
+
+    /// Whether the CPU and the build support the instruction set
+    static bool isSupported(ISA isa);
+    /// The best supported instruction set, detected once
+    static ISA getBestISA();
+
+    static const char* getISAName(ISA isa);
+};
+//---------------------------------------------------------------------------
+/// Elementwise loops over blocks of values of type T (float, double or long
+/// double), one variant per instruction set. The binary kernels compute
+/// a[i] = a[i] op b[i] in place. The variants are compiled with per-function
+/// target attributes, so one binary contains all of them and picks the best
+/// one for the CPU it runs on. float fits twice as many lanes into a vector as
+/// double, long double has no vector instructions and always runs the scalar
+/// loops.
+///
+/// The multiply-add kernels round a[i] * b[i] + c[i] once, exactly like
+/// std::fma, which the scalar and SSE2 variants call.
+///
+/// The scalar pow kernels call std::pow. The vectorized ones trade a little
+/// accuracy for speed, measured against std::pow: power() computes
+/// exp(y * log(x)) in double-double arithmetic and is within 2 ulp (only for
+/// double with AVX-512, with fewer lanes it is not faster than std::pow),
+/// squareRoot() is exact and reciprocalSquareRoot() within 1 ulp. Special
+/// cases such as negative, zero, subnormal or infinite bases and non-finite
+/// exponents give the same results as std::pow. Integer exponents have no
+/// kernel, the optimizer turns them into an IntegerPower, which runs on the
+/// multiply kernels.
+template <typename T>
+struct BasicKernels : InstructionSets {
+    void (*negate)(T* a, size_t count);
+    void (*add)(T* a, const T* b, size_t count);
+    void (*subtract)(T* a, const T* b, size_t count);
+    void (*multiply)(T* a, const T* b, size_t count);
+    void (*divide)(T* a, const T* b, size_t count);
+    /// a[i] = fma(a[i], b[i], c[i])
+    void (*multiplyAdd)(T* a, const T* b, const T* c, size_t count);
+    /// a[i] = fma(a[i], b[i], -c[i])
+    void (*multiplySubtract)(T* a, const T* b, const T* c, size_t count);
+    /// a[i] = pow(a[i], b[i])
+    void (*power)(T* a, const T* b, size_t count);
+    /// a[i] = pow(a[i], 0.5)
+    void (*squareRoot)(T* a, size_t count);
+    /// a[i] = pow(a[i], -0.5)
+    void (*reciprocalSquareRoot)(T* a, size_t count);
+
+    /// a[i] = pow(a[i], exponent) with the cheapest kernel for the exponent
+    void powerConstant(T* a, T exponent, size_t count) const;
+
+    /// The kernels for an instruction set, unsupported ones fall back to the best supported one
+    static const BasicKernels& get(ISA isa);
+    /// The kernels for the best supported instruction set
+    static const BasicKernels& get();
+};
+//---------------------------------------------------------------------------
+using Kernels = BasicKernels<double>;
+extern template struct BasicKernels<float>;
+extern template struct BasicKernels<double>;
+extern template struct BasicKernels<long double>;
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,157 @@
+#include "lib/NodeFactory.hpp"
+#include <bit>
+#include <memory>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+uint64_t identityOf(const ASTNode& node) {
+    return reinterpret_cast<uintptr_t>(&node);
+}
+//---------------------------------------------------------------------------
+/// Another owner of a shared node. Deleting it never frees anything since the
+/// node lives in an arena, and the factory never destroys its nodes.
+std::unique_ptr<ASTNode> share(const ASTNode& node) {
+    return std::unique_ptr<ASTNode>(const_cast<ASTNode*>(&node));
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+size_t NodeFactory::KeyHash::operator()(const Key& key) const {
+    // Mix the fields, the children's addresses are 16 byte aligned
+    uint64_t hash = static_cast<uint64_t>(key.type) * 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ key.first) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ key.second) * 0x94D049BB133111EBull;
+    hash = (hash ^ key.third) * 0xBF58476D1CE4E5B9ull;
+    return hash ^ (hash >> 31);
+}
+//---------------------------------------------------------------------------
+template <typename Create>
+const ASTNode& NodeFactory::intern(const Key& key, Create create) {
+    auto [it, inserted] = nodes.try_emplace(key, nullptr);
+    if (inserted)
+        it->second = create().release();
+    return *it->second;
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::constant(double value) {
+    return intern({ASTNode::Type::Constant, std::bit_cast<uint64_t>(value), 0}, [&] { return arena.make<Constant>(value); });
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::parameter(size_t index) {
+    return intern({ASTNode::Type::Parameter, index, 0}, [&] { return arena.make<Parameter>(index); });
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::unaryPlus(const ASTNode& input) {
+    return make(ASTNode::Type::UnaryPlus, input);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::unaryMinus(const ASTNode& input) {
+    return make(ASTNode::Type::UnaryMinus, input);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::squareRoot(const ASTNode& input) {
+    return make(ASTNode::Type::SquareRoot, input);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::add(const ASTNode& left, const ASTNode& right) {
+    return make(ASTNode::Type::Add, left, &right);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::subtract(const ASTNode& left, const ASTNode& right) {
+    return make(ASTNode::Type::Subtract, left, &right);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::multiply(const ASTNode& left, const ASTNode& right) {
+    return make(ASTNode::Type::Multiply, left, &right);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::divide(const ASTNode& left, const ASTNode& right) {
+    return make(ASTNode::Type::Divide, left, &right);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::power(const ASTNode& left, const ASTNode& right) {
+    return make(ASTNode::Type::Power, left, &right);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::integerPower(const ASTNode& left, const ASTNode& right) {
+    return make(ASTNode::Type::IntegerPower, left, &right);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::fusedMultiplyAdd(const ASTNode& a, const ASTNode& b, const ASTNode& c) {
+    return make(ASTNode::Type::FusedMultiplyAdd, a, &b, &c);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::fusedMultiplySubtract(const ASTNode& a, const ASTNode& b, const ASTNode& c) {
+    return make(ASTNode::Type::FusedMultiplySubtract, a, &b, &c);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::make(ASTNode::Type type, const ASTNode& left, const ASTNode* right, const ASTNode* third) {
+    bool unary = (type == ASTNode::Type::UnaryPlus) || (type == ASTNode::Type::UnaryMinus) || (type == ASTNode::Type::SquareRoot);
+    bool ternary = (type == ASTNode::Type::FusedMultiplyAdd) || (type == ASTNode::Type::FusedMultiplySubtract);
+    Key key{type, identityOf(left), unary ? 0 : identityOf(*right), ternary ? identityOf(*third) : 0};
+    return intern(key, [&]() -> std::unique_ptr<ASTNode> {
+        switch (type) {
+            case ASTNode::Type::UnaryPlus: return arena.make<UnaryPlus>(share(left));
+            case ASTNode::Type::UnaryMinus: return arena.make<UnaryMinus>(share(left));
+            case ASTNode::Type::SquareRoot: return arena.make<SquareRoot>(share(left));
+            case ASTNode::Type::Add: return arena.make<Add>(share(left), share(*right));
+            case ASTNode::Type::Subtract: return arena.make<Subtract>(share(left), share(*right));
+            case ASTNode::Type::Multiply: return arena.make<Multiply>(share(left), share(*right));
+            case ASTNode::Type::Divide: return arena.make<Divide>(share(left), share(*right));
+            case ASTNode::Type::Power: return arena.make<Power>(share(left), share(*right));
+            case ASTNode::Type::IntegerPower: return arena.make<IntegerPower>(share(left), share(*right));
+            case ASTNode::Type::FusedMultiplyAdd: return arena.make<FusedMultiplyAdd>(share(left), share(*right), share(*third));
+            case ASTNode::Type::FusedMultiplySubtract: return arena.make<FusedMultiplySubtract>(share(left), share(*right), share(*third));
+            default: return nullptr;
+        }
+    });
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::import(const ASTNode& node) {
+    std::unordered_map<const ASTNode*, const ASTNode*> imported;
+    return import(node, imported);
+}
+//---------------------------------------------------------------------------
+const ASTNode& NodeFactory::import(const ASTNode& node, std::unordered_map<const ASTNode*, const ASTNode*>& imported) {
+    switch (node.getType()) {
+        case ASTNode::Type::Constant:
+            return constant(static_cast<const Constant&>(node).getValue());
+        case ASTNode::Type::Parameter:
+            return parameter(static_cast<const Parameter&>(node).getIndex());
+        default:
+            break;
+    }
+    if (auto it = imported.find(&node); it != imported.end())
+        return *it->second;
+
+    const ASTNode* result;
+    if (node.getType() == ASTNode::Type::UnaryPlus || node.getType() == ASTNode::Type::UnaryMinus || node.getType() == ASTNode::Type::SquareRoot) {
+        result = &make(node.getType(), import(static_cast<const UnaryASTNode&>(node).getInput(), imported));
+    } else if (node.getType() == ASTNode::Type::FusedMultiplyAdd || node.getType() == ASTNode::Type::FusedMultiplySubtract) {
+        const auto& ternary = static_cast<const TernaryASTNode&>(node);
+        const ASTNode& first = import(ternary.getFirst(), imported);
+        const ASTNode& second = import(ternary.getSecond(), imported);
+        const ASTNode& third = import(ternary.getThird(), imported);
+        result = &make(node.getType(), first, &second, &third);
+    } else {
+        const auto& binary = static_cast<const BinaryASTNode&>(node);
+        const ASTNode& left = import(binary.getLeft(), imported);
+        const ASTNode& right = import(binary.getRight(), imported);
+        result = &make(node.getType(), left, &right);
+    }
+    imported.emplace(&node, result);
+    return *result;
+}
+//---------------------------------------------------------------------------
+bool NodeFactory::owns(const ASTNode& node) const {
+    return Arena::of(node) == &arena;
+}
+//---------------------------------------------------------------------------
+size_t NodeFactory::size() const {
+    return nodes.size();
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
@@ -0,0 +1,80 @@
+#ifndef H_lib_NodeFactory
+#define H_lib_NodeFactory
+//---------------------------------------------------------------------------
+#include "lib/AST.hpp"
+#include "lib/Arena.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+/// Creates hash-consed nodes.
+/// Every node is looked up by its type, value and the identity of its
+/// children before it is created, so structurally equal subexpressions are
+/// the same node and the result is a DAG instead of a tree. The nodes live in
+/// the factory's arena and are shared by several parents, so they are handed
+/// out as references and must never be released into a unique_ptr. Children
+/// must have been created by the same factory. Program computes shared nodes
+/// once, the tree walking backends expand them again.
+class NodeFactory {
+public:
+    NodeFactory() = default;
+    NodeFactory(const NodeFactory&) = delete;
+    NodeFactory& operator=(const NodeFactory&) = delete;
+
+    /// Constants are shared by bit pattern, so 0.0 and -0.0 stay distinct
+    const ASTNode& constant(double value);
+    const ASTNode& parameter(size_t index);
+    const ASTNode& unaryPlus(const ASTNode& input);
+    const ASTNode& unaryMinus(const ASTNode& input);
+    const ASTNode& squareRoot(const ASTNode& input);
+    const ASTNode& add(const ASTNode& left, const ASTNode& right);
+    const ASTNode& subtract(const ASTNode& left, const ASTNode& right);
+    const ASTNode& multiply(const ASTNode& left, const ASTNode& right);
+    const ASTNode& divide(const ASTNode& left, const ASTNode& right);
+    const ASTNode& power(const ASTNode& left, const ASTNode& right);
+    const ASTNode& integerPower(const ASTNode& left, const ASTNode& right);
+    const ASTNode& fusedMultiplyAdd(const ASTNode& a, const ASTNode& b, const ASTNode& c);
+    const ASTNode& fusedMultiplySubtract(const ASTNode& a, const ASTNode& b, const ASTNode& c);
+    /// Create an operator node of the given type, right is ignored for unary
+    /// types and third is only used by the ternary ones
+    const ASTNode& make(ASTNode::Type type, const ASTNode& left, const ASTNode* right = nullptr, const ASTNode* third = nullptr);
+
+    /// Copy an arbitrary tree or DAG into the factory, sharing all repeated
+    /// subtrees. Every node of the input is visited once.
+    const ASTNode& import(const ASTNode& node);
+
+    /// Whether the node was created by this factory
+    bool owns(const ASTNode& node) const;
+    /// The number of distinct nodes
+    size_t size() const;
+
+private:
+    /// The structural identity of a node, children are compared by address
+    struct Key {
+        ASTNode::Type type;
+        uint64_t first;
+        uint64_t second;
+        uint64_t third = 0;
+
+        bool operator==(const Key& other) const = default;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    /// Find the node for key or create it with create()
+    template <typename Create>
+    const ASTNode& intern(const Key& key, Create create);
+    /// Import node, the operator nodes that were already imported are looked
+    /// up in imported so that a foreign DAG is not expanded into a tree
+    const ASTNode& import(const ASTNode& node, std::unordered_map<const ASTNode*, const ASTNode*>& imported);
+
+    Arena arena;
+    std::unordered_map<Key, const ASTNode*, KeyHash> nodes;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
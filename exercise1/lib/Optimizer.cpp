@@ -0,0 +1,61 @@
+#include "lib/Optimizer.hpp"
+#include "lib/AST.hpp"
+#include "lib/Rewriter.hpp"
+#include <utility>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+Optimizer::Optimizer() : Optimizer(Options()) {}
+//---------------------------------------------------------------------------
+Optimizer::Optimizer(Options options) : Optimizer({[](std::unique_ptr<ASTNode>& root, Clock::time_point deadline, bool& stopped) { return Rewriter::optimize(root, deadline, stopped); }}, options) {
+    if (options.fuseMultiplyAdd)
+        addPass([](std::unique_ptr<ASTNode>& root, Clock::time_point deadline, bool& stopped) { return Rewriter::fuse(root, deadline, stopped); });
+}
+//---------------------------------------------------------------------------
+Optimizer::Optimizer(std::vector<Pass> passes, Options options) : passes(std::move(passes)), options(options) {}
+//---------------------------------------------------------------------------
+void Optimizer::addPass(Pass pass) {
+    passes.push_back(std::move(pass));
+}
+//---------------------------------------------------------------------------
+size_t Optimizer::getPassCount() const {
+    return passes.size();
+}
+//---------------------------------------------------------------------------
+Optimizer::Result Optimizer::run(std::unique_ptr<ASTNode>& root) const {
+    auto start = Clock::now();
+    // Saturate instead of overflowing for huge budgets
+    auto deadline = (options.timeBudget >= Clock::time_point::max() - start) ? Clock::time_point::max() : start + std::chrono::duration_cast<Clock::duration>(options.timeBudget);
+
+    Result result;
+    while (result.iterations < options.maxIterations && Clock::now() < deadline) {
+        ++result.iterations;
+        size_t changes = 0;
+        bool complete = true;
+        for (size_t i = 0; i < passes.size(); ++i) {
+            bool stopped = false;
+            changes += passes[i](root, deadline, stopped);
+            // A pass that reached the end of its tree is complete even if the budget is used up now
+            if (stopped) {
+                complete = false;
+                break;
+            }
+            // No further pass starts after the budget is used up
+            if (i + 1 < passes.size() && Clock::now() >= deadline) {
+                complete = false;
+                break;
+            }
+        }
+        result.changes += changes;
+        // Only a complete iteration without changes proves the fixpoint
+        if (complete && !changes) {
+            result.converged = true;
+            break;
+        }
+    }
+    result.elapsed = Clock::now() - start;
+    return result;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
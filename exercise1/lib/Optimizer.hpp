@@ -0,0 +1,68 @@
+#ifndef H_lib_Optimizer
+#define H_lib_Optimizer
+//---------------------------------------------------------------------------
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+//---------------------------------------------------------------------------
+/// Runs a pipeline of optimization passes until a fixpoint is reached.
+/// One iteration runs every pass in order. The pipeline is repeated until an
+/// iteration changes nothing, or until the iteration or time budget is used
+/// up. No pass starts after the budget is used up, and every pass gets the
+/// end of the budget as a deadline at which it should stop early, so huge
+/// trees are left partially optimized instead of blocking the caller.
+class Optimizer {
+public:
+    using Clock = std::chrono::steady_clock;
+    /// Rewrites the tree of root in place and returns the number of changes
+    /// it made. A pass that stops at the deadline leaves a valid tree and sets
+    /// stopped, which is false when it is called.
+    using Pass = std::function<size_t(std::unique_ptr<ASTNode>& root, Clock::time_point deadline, bool& stopped)>;
+
+    struct Options {
+        /// The maximum number of pipeline iterations
+        unsigned maxIterations = 16;
+        /// No pass starts once this much time has passed
+        std::chrono::nanoseconds timeBudget = std::chrono::milliseconds(100);
+        /// Append the multiply-add fusion of Rewriter to the default pipeline,
+        /// which changes the rounding of the results
+        bool fuseMultiplyAdd = false;
+    };
+
+    struct Result {
+        /// Whether an iteration ran every pass to completion without changes, so no pass can simplify the tree further
+        bool converged = false;
+        /// The number of started iterations, including the one that found the fixpoint
+        unsigned iterations = 0;
+        /// The number of changes of all passes
+        size_t changes = 0;
+        std::chrono::nanoseconds elapsed{0};
+    };
+
+    /// The default pipeline, the rewrite rules of Rewriter and optionally its fusion
+    Optimizer();
+    explicit Optimizer(Options options);
+    /// A custom pipeline
+    Optimizer(std::vector<Pass> passes, Options options);
+
+    /// Append a pass to the pipeline
+    void addPass(Pass pass);
+    size_t getPassCount() const;
+
+    /// Optimize the tree of root
+    Result run(std::unique_ptr<ASTNode>& root) const;
+
+private:
+    std::vector<Pass> passes;
+    Options options;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
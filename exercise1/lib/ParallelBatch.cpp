@@ -0,0 +1,28 @@
+#include "lib/ParallelBatch.hpp"
+#include "lib/ThreadPool.hpp"
+#include <algorithm>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+ParallelBatchEvaluator::ParallelBatchEvaluator(const ASTNode& node, ThreadPool& pool, size_t chunkSize)
+    : pool(pool), chunkSize(chunkSize ? chunkSize : defaultChunkSize) {
+    evaluators.reserve(pool.getThreadCount());
+    for (size_t i = 0; i < pool.getThreadCount(); ++i)
+        evaluators.emplace_back(node);
+}
+//---------------------------------------------------------------------------
+void ParallelBatchEvaluator::evaluate(const ColumnarContext& context, std::span<double> out) {
+    size_t chunkCount = (out.size() + chunkSize - 1) / chunkSize;
+    pool.run(chunkCount, [&](size_t chunk, size_t worker) {
+        size_t begin = chunk * chunkSize;
+        size_t count = std::min(chunkSize, out.size() - begin);
+        evaluators[worker].evaluate(context, begin, out.subspan(begin, count));
+    });
+}
+//---------------------------------------------------------------------------
+size_t ParallelBatchEvaluator::getChunkSize() const {
+    return chunkSize;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
@@ -0,0 +1,42 @@
+#ifndef H_lib_ParallelBatch
+#define H_lib_ParallelBatch
+//---------------------------------------------------------------------------
+#include "lib/Batch.hpp"
+#include <cstddef>
+#include <span>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+class ThreadPool;
+//---------------------------------------------------------------------------
+/// Evaluates an expression over many rows on all threads of a ThreadPool.
+/// The rows are split into chunks of chunkSize rows, which the pool spreads
+/// over its workers with work stealing. Every worker has its own
+/// BatchEvaluator. A chunk writes exactly its rows of the output, so the
+/// result is the same as with a single BatchEvaluator, independent of the
+/// thread count, the chunk size and the scheduling.
+class ParallelBatchEvaluator {
+public:
+    /// Large enough to amortize taking a task, small enough to balance the load
+    static constexpr size_t defaultChunkSize = BatchEvaluator::maxTileSize;
+
+    /// A chunkSize of 0 uses the default
+    ParallelBatchEvaluator(const ASTNode& node, ThreadPool& pool, size_t chunkSize = defaultChunkSize);
+
+    /// Evaluate the first out.size() rows of context into out
+    void evaluate(const ColumnarContext& context, std::span<double> out);
+
+    size_t getChunkSize() const;
+
+private:
+    ThreadPool& pool;
+    size_t chunkSize;
+    /// One evaluator per worker of the pool
+    std::vector<BatchEvaluator> evaluators;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -9,6 +9,12 @@ void PrintVisitor::visit(const UnaryMinus& node) const {
     std::cout << ")";
 }
 
+void PrintVisitor::visit(const SquareRoot& node) const {
+    std::cout << "sqrt(";
+    node.getInput().accept(*this);
+    std::cout << ")";
+}
+
 void PrintVisitor::visit(const Add& node) const {
     std::cout << "(";
     node.getLeft().accept(*this);
@@ -49,6 +55,35 @@ void PrintVisitor::visit(const Power& node) const {
     std::cout << ")";
 }
 
+void PrintVisitor::visit(const IntegerPower& node) const {
+    // Prints like the power it replaced
+    std::cout << "(";
+    node.getLeft().accept(*this);
+    std::cout << " ^ ";
+    node.getRight().accept(*this);
+    std::cout << ")";
+}
+
+void PrintVisitor::visit(const FusedMultiplyAdd& node) const {
+    std::cout << "fma(";
+    node.getFirst().accept(*this);
+    std::cout << ", ";
+    node.getSecond().accept(*this);
+    std::cout << ", ";
+    node.getThird().accept(*this);
+    std::cout << ")";
+}
+
+void PrintVisitor::visit(const FusedMultiplySubtract& node) const {
+    std::cout << "fms(";
+    node.getFirst().accept(*this);
+    std::cout << ", ";
+    node.getSecond().accept(*this);
+    std::cout << ", ";
+    node.getThird().accept(*this);
+    std::cout << ")";
+}
+
 void PrintVisitor::visit(const Constant& node) const {
     std::cout << node.getValue();
 }
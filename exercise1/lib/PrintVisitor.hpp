@@ -13,11 +13,15 @@ public:
     void visit(const UnaryMinus& node) const override;
      
     void visit(const UnaryPlus& node) const override;
+    void visit(const SquareRoot& node) const override;
     void visit(const Add& node) const override;
     void visit(const Subtract& node) const override;
     void visit(const Multiply& node) const override;
     void visit(const Divide& node) const override;
     void visit(const Power& node) const override;
+    void visit(const IntegerPower& node) const override;
+    void visit(const FusedMultiplyAdd& node) const override;
+    void visit(const FusedMultiplySubtract& node) const override;
     void visit(const Constant& node) const override;
     void visit(const Parameter& node) const override;
     void visit(const ASTNode& node) const override;
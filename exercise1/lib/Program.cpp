@@ -0,0 +1,229 @@
+#include "lib/Program.hpp"
+#include "lib/AST.hpp"
+#include "lib/AdditionChain.hpp"
+#include "lib/NodeFactory.hpp"
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+/// Lowers a tree or DAG into a program
+class ProgramCompiler {
+public:
+    /// Count the parents of every operator node, shared nodes are visited once
+    void countUses(const ASTNode& node);
+    /// Append node to program, slots are shared between all programs
+    void compile(Program& program, const ASTNode& node);
+    /// The number of slots used by all programs
+    uint32_t getSlotCount() const { return slotCount; }
+
+private:
+    void compileNode(const ASTNode& node);
+    void compileOperator(const ASTNode& node);
+    /// base ^ exponent along the addition chain of the exponent, the same
+    /// multiplications as IntegerPower::apply
+    void compileChain(const ASTNode& base, double exponent);
+
+    Program* program = nullptr;
+    std::unordered_map<const ASTNode*, uint32_t> uses;
+    /// The slots of shared nodes that were already computed
+    std::unordered_map<const ASTNode*, uint32_t> slots;
+    uint32_t slotCount = 0;
+};
+//---------------------------------------------------------------------------
+void ProgramCompiler::countUses(const ASTNode& node) {
+    switch (node.getType()) {
+        case ASTNode::Type::Constant:
+        case ASTNode::Type::Parameter:
+            // Pushing a leaf again is as cheap as loading it
+            return;
+        default:
+            break;
+    }
+    if (uses[&node]++)
+        return;
+    if (node.getType() == ASTNode::Type::UnaryPlus || node.getType() == ASTNode::Type::UnaryMinus || node.getType() == ASTNode::Type::SquareRoot) {
+        countUses(static_cast<const UnaryASTNode&>(node).getInput());
+        return;
+    }
+    if (node.getType() == ASTNode::Type::FusedMultiplyAdd || node.getType() == ASTNode::Type::FusedMultiplySubtract) {
+        const auto& ternary = static_cast<const TernaryASTNode&>(node);
+        countUses(ternary.getFirst());
+        countUses(ternary.getSecond());
+        countUses(ternary.getThird());
+        return;
+    }
+    const auto& binary = static_cast<const BinaryASTNode&>(node);
+    countUses(binary.getLeft());
+    countUses(binary.getRight());
+}
+//---------------------------------------------------------------------------
+void ProgramCompiler::compile(Program& program, const ASTNode& node) {
+    this->program = &program;
+    compileNode(node);
+    this->program = nullptr;
+}
+//---------------------------------------------------------------------------
+void ProgramCompiler::compileNode(const ASTNode& node) {
+    using OpCode = Program::OpCode;
+    switch (node.getType()) {
+        case ASTNode::Type::Constant:
+            program->constants.push_back(static_cast<const Constant&>(node).getValue());
+            program->emit(OpCode::PushConstant, program->constants.size() - 1, 1);
+            return;
+        case ASTNode::Type::Parameter: {
+            size_t index = static_cast<const Parameter&>(node).getIndex();
+            if (index > std::numeric_limits<uint32_t>::max())
+                throw std::out_of_range("parameter index does not fit into an operand");
+            program->emit(OpCode::PushParameter, index, 1);
+            return;
+        }
+        default:
+            break;
+    }
+
+    auto it = uses.find(&node);
+    if (it == uses.end() || it->second < 2) {
+        compileOperator(node);
+        return;
+    }
+    if (auto slot = slots.find(&node); slot != slots.end()) {
+        program->emit(OpCode::Load, slot->second, 1);
+        return;
+    }
+    compileOperator(node);
+    uint32_t slot = slotCount++;
+    slots.emplace(&node, slot);
+    program->emit(OpCode::Store, slot, 0);
+}
+//---------------------------------------------------------------------------
+void ProgramCompiler::compileOperator(const ASTNode& node) {
+    using OpCode = Program::OpCode;
+    switch (node.getType()) {
+        case ASTNode::Type::UnaryPlus:
+            // +a evaluates to a, there is nothing to execute
+            compileNode(static_cast<const UnaryASTNode&>(node).getInput());
+            return;
+        case ASTNode::Type::UnaryMinus:
+            compileNode(static_cast<const UnaryASTNode&>(node).getInput());
+            program->emit(OpCode::Negate, 0, 0);
+            return;
+        case ASTNode::Type::SquareRoot:
+            compileNode(static_cast<const UnaryASTNode&>(node).getInput());
+            program->emit(OpCode::SquareRoot, 0, 0);
+            return;
+        case ASTNode::Type::FusedMultiplyAdd:
+        case ASTNode::Type::FusedMultiplySubtract: {
+            const auto& ternary = static_cast<const TernaryASTNode&>(node);
+            compileNode(ternary.getFirst());
+            compileNode(ternary.getSecond());
+            compileNode(ternary.getThird());
+            program->emit((node.getType() == ASTNode::Type::FusedMultiplyAdd) ? OpCode::FusedMultiplyAdd : OpCode::FusedMultiplySubtract, 0, -2);
+            return;
+        }
+        default:
+            break;
+    }
+
+    // All remaining node types are binary
+    const auto& binary = static_cast<const BinaryASTNode&>(node);
+    if (node.getType() == ASTNode::Type::IntegerPower) {
+        compileChain(binary.getLeft(), static_cast<const Constant&>(binary.getRight()).getValue());
+        return;
+    }
+    compileNode(binary.getLeft());
+    compileNode(binary.getRight());
+    switch (node.getType()) {
+        case ASTNode::Type::Add: program->emit(OpCode::Add, 0, -1); break;
+        case ASTNode::Type::Subtract: program->emit(OpCode::Subtract, 0, -1); break;
+        case ASTNode::Type::Multiply: program->emit(OpCode::Multiply, 0, -1); break;
+        case ASTNode::Type::Divide: program->emit(OpCode::Divide, 0, -1); break;
+        case ASTNode::Type::Power: program->emit(OpCode::Power, 0, -1); break;
+        default: break;
+    }
+}
+//---------------------------------------------------------------------------
+void ProgramCompiler::compileChain(const ASTNode& base, double exponent) {
+    using OpCode = Program::OpCode;
+    AdditionChain chain(exponent);
+    if (exponent < 0) {
+        program->constants.push_back(1.0);
+        program->emit(OpCode::PushConstant, program->constants.size() - 1, 1);
+    }
+    // The top of the stack holds the latest power, the earlier ones that are
+    // read again wait in slots
+    std::vector<uint32_t> powerSlots;
+    compileNode(base);
+    for (size_t k = 0, length = chain.getLength(); k <= length; ++k) {
+        if (k) {
+            program->emit(OpCode::Load, powerSlots[chain.getOperand(k)], 1);
+            program->emit(OpCode::Multiply, 0, -1);
+        } else if (auto slot = slots.find(&base); slot != slots.end()) {
+            // A shared base is already stored
+            powerSlots.push_back(slot->second);
+            continue;
+        }
+        powerSlots.push_back(slotCount);
+        if (chain.isReused(k))
+            program->emit(OpCode::Store, slotCount++, 0);
+    }
+    if (exponent < 0)
+        program->emit(OpCode::Divide, 0, -1);
+}
+//---------------------------------------------------------------------------
+Program Program::compile(const ASTNode& node) {
+    // Hash-consing turns structurally equal subtrees into shared nodes
+    NodeFactory factory;
+    const ASTNode& shared = factory.import(node);
+    Program program;
+    ProgramCompiler compiler;
+    compiler.countUses(shared);
+    compiler.compile(program, shared);
+    program.slotCount = compiler.getSlotCount();
+    return program;
+}
+//---------------------------------------------------------------------------
+std::vector<Program> Program::compile(std::span<const ASTNode* const> nodes) {
+    NodeFactory factory;
+    std::vector<const ASTNode*> shared;
+    shared.reserve(nodes.size());
+    for (const ASTNode* node : nodes)
+        shared.push_back(&factory.import(*node));
+    ProgramCompiler compiler;
+    for (const ASTNode* node : shared)
+        compiler.countUses(*node);
+    std::vector<Program> programs(nodes.size());
+    for (size_t i = 0; i < shared.size(); ++i)
+        compiler.compile(programs[i], *shared[i]);
+    for (auto& program : programs)
+        program.slotCount = compiler.getSlotCount();
+    return programs;
+}
+//---------------------------------------------------------------------------
+const std::vector<Program::Instruction>& Program::getInstructions() const {
+    return instructions;
+}
+//---------------------------------------------------------------------------
+const std::vector<double>& Program::getConstants() const {
+    return constants;
+}
+//---------------------------------------------------------------------------
+size_t Program::getMaxStackDepth() const {
+    return maxStackDepth;
+}
+//---------------------------------------------------------------------------
+size_t Program::getSlotCount() const {
+    return slotCount;
+}
+//---------------------------------------------------------------------------
+void Program::emit(OpCode opCode, uint32_t operand, int stackEffect) {
+    instructions.push_back({opCode, operand});
+    stackDepth += stackEffect;
+    if (stackDepth > maxStackDepth)
+        maxStackDepth = stackDepth;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
@@ -0,0 +1,78 @@
+#ifndef H_lib_Program
+#define H_lib_Program
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+//---------------------------------------------------------------------------
+/// A compact post-order bytecode program for an expression tree.
+/// The expression is hash-consed with a NodeFactory first, so structurally
+/// equal subexpressions are computed once, stored into a slot and loaded
+/// again at their other uses. An IntegerPower multiplies along its addition
+/// chain, every other power calls pow, so the program computes exactly what
+/// the tree does.
+class Program {
+public:
+    /// All opcodes of the stack machine
+    enum class OpCode : uint8_t {
+        PushConstant,
+        PushParameter,
+        Negate,
+        SquareRoot,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Power,
+        /// Pop c, b and a and push a * b + c rounded once
+        FusedMultiplyAdd,
+        /// Pop c, b and a and push a * b - c rounded once
+        FusedMultiplySubtract,
+        /// Copy the top of the stack into a slot, without popping it
+        Store,
+        /// Push a slot
+        Load
+    };
+
+    /// A single instruction, the operand indexes constants, parameters or slots
+    struct Instruction {
+        OpCode opCode;
+        uint32_t operand;
+    };
+
+    /// Lower a tree into bytecode, throws std::out_of_range for parameter
+    /// indexes that do not fit into the 32 bit operand
+    static Program compile(const ASTNode& node);
+    /// Lower several trees into one program each. The programs share their
+    /// slots: a subexpression that occurs in several trees is computed by the
+    /// first program that needs it and loaded by the later ones, so they must
+    /// run in order on the same slots.
+    static std::vector<Program> compile(std::span<const ASTNode* const> nodes);
+
+    const std::vector<Instruction>& getInstructions() const;
+    const std::vector<double>& getConstants() const;
+    /// The number of stack slots the program needs at most
+    size_t getMaxStackDepth() const;
+    /// The number of slots for shared subexpressions
+    size_t getSlotCount() const;
+
+private:
+    friend class ProgramCompiler;
+
+    void emit(OpCode opCode, uint32_t operand, int stackEffect);
+
+    std::vector<Instruction> instructions;
+    std::vector<double> constants;
+    size_t stackDepth = 0;
+    size_t maxStackDepth = 0;
+    size_t slotCount = 0;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
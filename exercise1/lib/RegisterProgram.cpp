@@ -0,0 +1,290 @@
+#include "lib/RegisterProgram.hpp"
+#include "lib/AST.hpp"
+#include "lib/AdditionChain.hpp"
+#include "lib/NodeFactory.hpp"
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The exponent of an IntegerPower, which is computed along its addition chain, or 0
+double getChainExponent(const ASTNode& node) {
+    if (node.getType() != ASTNode::Type::IntegerPower)
+        return 0;
+    return static_cast<const Constant&>(static_cast<const BinaryASTNode&>(node).getRight()).getValue();
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+/// Lowers a tree or DAG in two passes: labelling assigns leaf registers,
+/// counts the uses of every node and computes Sethi-Ullman numbers,
+/// generation emits code in the order the labels dictate
+class RegisterCompiler {
+public:
+    explicit RegisterCompiler(RegisterProgram& program) : program(program) {}
+
+    /// Compute the number of temporaries a subtree needs and collect its leaves
+    uint32_t label(const ASTNode& node);
+    /// Finish the register layout once all leaves are known
+    void layout();
+    /// Emit code for a subtree using temporaries from base upwards, returns the result register
+    uint32_t generate(const ASTNode& node, uint32_t base);
+
+    uint32_t getTemporaryBase() const { return temporaryBase; }
+
+private:
+    /// Give value a constant register
+    void addConstant(double value);
+    /// Emit base ^ exponent along the addition chain of the exponent into dst,
+    /// the same multiplications as IntegerPower::apply
+    void generateChain(const ASTNode& base, double exponent, uint32_t dst, uint32_t temporary);
+
+    RegisterProgram& program;
+    std::unordered_map<const ASTNode*, uint32_t> needs;
+    std::unordered_map<const ASTNode*, uint32_t> uses;
+    /// The registers of shared nodes that were already computed
+    std::unordered_map<const ASTNode*, uint32_t> sharedRegisters;
+    std::unordered_map<size_t, uint32_t> parameterRegisters;
+    std::unordered_map<uint64_t, uint32_t> constantIndexes;
+    uint32_t sharedBase = 0;
+    uint32_t sharedCount = 0;
+    uint32_t temporaryBase = 0;
+};
+//---------------------------------------------------------------------------
+uint32_t RegisterCompiler::label(const ASTNode& node) {
+    switch (node.getType()) {
+        case ASTNode::Type::Constant:
+            addConstant(static_cast<const Constant&>(node).getValue());
+            return 0;
+        case ASTNode::Type::Parameter: {
+            size_t index = static_cast<const Parameter&>(node).getIndex();
+            if (index > std::numeric_limits<uint32_t>::max())
+                throw std::out_of_range("parameter index does not fit into an operand");
+            if (parameterRegisters.emplace(index, parameterRegisters.size()).second)
+                program.instructions.push_back({RegisterProgram::OpCode::LoadParameter, parameterRegisters[index], static_cast<uint32_t>(index), 0});
+            return 0;
+        }
+        default:
+            break;
+    }
+
+    // A node with several parents gets its own register, +a has no code
+    // and stays in the register of a. Its Sethi-Ullman number is kept for
+    // all uses although only the first one computes it, which wastes at
+    // most a temporary at the others.
+    if (uses[&node]++) {
+        if (uses[&node] == 2 && node.getType() != ASTNode::Type::UnaryPlus)
+            ++sharedCount;
+        return needs[&node];
+    }
+    uint32_t need = 0;
+    switch (node.getType()) {
+        case ASTNode::Type::UnaryPlus:
+            need = label(static_cast<const UnaryASTNode&>(node).getInput());
+            break;
+        case ASTNode::Type::UnaryMinus:
+        case ASTNode::Type::SquareRoot:
+            need = std::max<uint32_t>(label(static_cast<const UnaryASTNode&>(node).getInput()), 1);
+            break;
+        case ASTNode::Type::FusedMultiplyAdd:
+        case ASTNode::Type::FusedMultiplySubtract: {
+            // The operands run in decreasing order of their needs, each
+            // computed one occupies a temporary below the later ones
+            const auto& ternary = static_cast<const TernaryASTNode&>(node);
+            uint32_t operands[] = {label(ternary.getFirst()), label(ternary.getSecond()), label(ternary.getThird())};
+            std::sort(std::begin(operands), std::end(operands), std::greater<>());
+            uint32_t occupied = 0;
+            need = 1;
+            for (uint32_t operand : operands) {
+                need = std::max(need, operand + occupied);
+                occupied += (operand > 0) ? 1 : 0;
+            }
+            break;
+        }
+        default: {
+            const auto& binary = static_cast<const BinaryASTNode&>(node);
+            if (double exponent = getChainExponent(node)) {
+                // Every power of the chain but the first one gets a temporary
+                uint32_t length = AdditionChain(exponent).getLength();
+                need = std::max(label(binary.getLeft()), length);
+                if (exponent < 0)
+                    addConstant(1.0);
+                break;
+            }
+            uint32_t left = label(binary.getLeft());
+            uint32_t right = label(binary.getRight());
+            need = (left == right) ? left + 1 : std::max(left, right);
+            break;
+        }
+    }
+    needs[&node] = need;
+    return need;
+}
+//---------------------------------------------------------------------------
+void RegisterCompiler::addConstant(double value) {
+    // Deduplicate by bit pattern so that 0.0 and -0.0 stay distinct
+    auto bits = std::bit_cast<uint64_t>(value);
+    if (constantIndexes.emplace(bits, program.constants.size()).second)
+        program.constants.push_back(value);
+}
+//---------------------------------------------------------------------------
+void RegisterCompiler::layout() {
+    program.constantBase = parameterRegisters.size();
+    sharedBase = program.constantBase + program.constants.size();
+    temporaryBase = sharedBase + sharedCount;
+    program.registerCount = temporaryBase;
+}
+//---------------------------------------------------------------------------
+uint32_t RegisterCompiler::generate(const ASTNode& node, uint32_t base) {
+    using OpCode = RegisterProgram::OpCode;
+
+    switch (node.getType()) {
+        case ASTNode::Type::Constant: {
+            double value = static_cast<const Constant&>(node).getValue();
+            return program.constantBase + constantIndexes[std::bit_cast<uint64_t>(value)];
+        }
+        case ASTNode::Type::Parameter:
+            return parameterRegisters[static_cast<const Parameter&>(node).getIndex()];
+        case ASTNode::Type::UnaryPlus:
+            return generate(static_cast<const UnaryASTNode&>(node).getInput(), base);
+        default:
+            break;
+    }
+
+    // The first use of a shared node computes it into its register, the others read it
+    uint32_t dst = base;
+    if (uses[&node] > 1) {
+        auto [it, inserted] = sharedRegisters.try_emplace(&node, sharedBase + sharedRegisters.size());
+        if (!inserted)
+            return it->second;
+        dst = it->second;
+    }
+
+    if (node.getType() == ASTNode::Type::UnaryMinus || node.getType() == ASTNode::Type::SquareRoot) {
+        uint32_t src = generate(static_cast<const UnaryASTNode&>(node).getInput(), base);
+        OpCode opCode = (node.getType() == ASTNode::Type::UnaryMinus) ? OpCode::Negate : OpCode::SquareRoot;
+        program.instructions.push_back({opCode, dst, src, 0});
+        program.registerCount = std::max(program.registerCount, dst + 1);
+        return dst;
+    }
+
+    auto needOf = [this](const ASTNode& n) {
+        auto it = needs.find(&n);
+        return (it == needs.end()) ? 0u : it->second;
+    };
+
+    if (node.getType() == ASTNode::Type::FusedMultiplyAdd || node.getType() == ASTNode::Type::FusedMultiplySubtract) {
+        const auto& ternary = static_cast<const TernaryASTNode&>(node);
+        const ASTNode* operands[] = {&ternary.getFirst(), &ternary.getSecond(), &ternary.getThird()};
+        // The same order as in label(), so the temporaries suffice
+        size_t order[] = {0, 1, 2};
+        std::stable_sort(std::begin(order), std::end(order), [&](size_t a, size_t b) { return needOf(*operands[a]) > needOf(*operands[b]); });
+        uint32_t sources[3];
+        uint32_t next = base;
+        for (size_t i : order) {
+            sources[i] = generate(*operands[i], next);
+            next += (needOf(*operands[i]) > 0) ? 1 : 0;
+        }
+        OpCode opCode = (node.getType() == ASTNode::Type::FusedMultiplyAdd) ? OpCode::FusedMultiplyAdd : OpCode::FusedMultiplySubtract;
+        program.instructions.push_back({opCode, dst, sources[0], sources[1], sources[2]});
+        program.registerCount = std::max(program.registerCount, dst + 1);
+        return dst;
+    }
+
+    const auto& binary = static_cast<const BinaryASTNode&>(node);
+    if (double exponent = getChainExponent(node)) {
+        generateChain(binary.getLeft(), exponent, dst, base);
+        return dst;
+    }
+
+    // Evaluate the more demanding subtree first, its result then occupies
+    // base while the other subtree runs above it
+    const ASTNode& left = binary.getLeft();
+    const ASTNode& right = binary.getRight();
+    uint32_t src1, src2;
+    if (needOf(left) >= needOf(right)) {
+        src1 = generate(left, base);
+        src2 = generate(right, base + (needOf(left) > 0 ? 1 : 0));
+    } else {
+        src2 = generate(right, base);
+        src1 = generate(left, base + 1);
+    }
+
+    OpCode opCode = OpCode::Add;
+    switch (node.getType()) {
+        case ASTNode::Type::Add: opCode = OpCode::Add; break;
+        case ASTNode::Type::Subtract: opCode = OpCode::Subtract; break;
+        case ASTNode::Type::Multiply: opCode = OpCode::Multiply; break;
+        case ASTNode::Type::Divide: opCode = OpCode::Divide; break;
+        case ASTNode::Type::Power: opCode = OpCode::Power; break;
+        default: break;
+    }
+    program.instructions.push_back({opCode, dst, src1, src2});
+    program.registerCount = std::max(program.registerCount, dst + 1);
+    return dst;
+}
+//---------------------------------------------------------------------------
+void RegisterCompiler::generateChain(const ASTNode& base, double exponent, uint32_t dst, uint32_t temporary) {
+    using OpCode = RegisterProgram::OpCode;
+    AdditionChain chain(exponent);
+    uint32_t length = chain.getLength();
+    // Power k of 0 < k < length lives in temporary + k, above the base. The
+    // last one goes to dst, or replaces power length - 1 before the reciprocal.
+    std::vector<uint32_t> powers{generate(base, temporary)};
+    for (uint32_t k = 1; k <= length; ++k) {
+        uint32_t power = temporary + k;
+        if (k == length)
+            power = (exponent > 0) ? dst : temporary + k - 1;
+        program.instructions.push_back({OpCode::Multiply, power, powers[k - 1], powers[chain.getOperand(k)]});
+        program.registerCount = std::max(program.registerCount, power + 1);
+        powers.push_back(power);
+    }
+    if (exponent < 0) {
+        uint32_t one = program.constantBase + constantIndexes[std::bit_cast<uint64_t>(1.0)];
+        program.instructions.push_back({OpCode::Divide, dst, one, powers.back()});
+        program.registerCount = std::max(program.registerCount, dst + 1);
+    }
+}
+//---------------------------------------------------------------------------
+RegisterProgram RegisterProgram::compile(const ASTNode& node) {
+    // Hash-consing turns structurally equal subtrees into shared nodes
+    NodeFactory factory;
+    const ASTNode& shared = factory.import(node);
+    RegisterProgram program;
+    RegisterCompiler compiler(program);
+    compiler.label(shared);
+    compiler.layout();
+    program.resultRegister = compiler.generate(shared, compiler.getTemporaryBase());
+    return program;
+}
+//---------------------------------------------------------------------------
+const std::vector<RegisterProgram::Instruction>& RegisterProgram::getInstructions() const {
+    return instructions;
+}
+//---------------------------------------------------------------------------
+const std::vector<double>& RegisterProgram::getConstants() const {
+    return constants;
+}
+//---------------------------------------------------------------------------
+uint32_t RegisterProgram::getConstantBase() const {
+    return constantBase;
+}
+//---------------------------------------------------------------------------
+uint32_t RegisterProgram::getRegisterCount() const {
+    return registerCount;
+}
+//---------------------------------------------------------------------------
+uint32_t RegisterProgram::getResultRegister() const {
+    return resultRegister;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
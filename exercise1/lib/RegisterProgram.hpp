@@ -0,0 +1,69 @@
+#ifndef H_lib_RegisterProgram
+#define H_lib_RegisterProgram
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+//---------------------------------------------------------------------------
+/// A three-address program for an expression tree.
+/// The register file is laid out as [parameters | constants | shared |
+/// temporaries]: every distinct parameter is loaded once per run, constants
+/// are stored once when the machine is created, structurally equal
+/// subexpressions are computed once into a shared register and temporaries
+/// are allocated with Sethi-Ullman numbering, so the register count is small
+/// and known at compile time.
+class RegisterProgram {
+public:
+    /// All opcodes of the register machine
+    enum class OpCode : uint8_t {
+        LoadParameter,         ///< dst = P[src1]
+        Negate,                ///< dst = -src1
+        SquareRoot,            ///< dst = pow(src1, 0.5)
+        Add,                   ///< dst = src1 + src2
+        Subtract,              ///< dst = src1 - src2
+        Multiply,              ///< dst = src1 * src2
+        Divide,                ///< dst = src1 / src2
+        Power,                 ///< dst = src1 ^ src2
+        FusedMultiplyAdd,      ///< dst = src1 * src2 + src3, rounded once
+        FusedMultiplySubtract  ///< dst = src1 * src2 - src3, rounded once
+    };
+
+    struct Instruction {
+        OpCode opCode;
+        uint32_t dst;
+        uint32_t src1;
+        uint32_t src2;
+        /// Only used by the fused multiply-adds
+        uint32_t src3 = 0;
+    };
+
+    /// Lower a tree into register code, throws std::out_of_range for parameter
+    /// indexes that do not fit into the 32 bit operand
+    static RegisterProgram compile(const ASTNode& node);
+
+    const std::vector<Instruction>& getInstructions() const;
+    /// The constants, constant i lives in register getConstantBase() + i
+    const std::vector<double>& getConstants() const;
+    uint32_t getConstantBase() const;
+    /// The total number of registers the program needs
+    uint32_t getRegisterCount() const;
+    /// The register that holds the result after the program has run
+    uint32_t getResultRegister() const;
+
+private:
+    friend class RegisterCompiler;
+
+    std::vector<Instruction> instructions;
+    std::vector<double> constants;
+    uint32_t constantBase = 0;
+    uint32_t registerCount = 0;
+    uint32_t resultRegister = 0;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
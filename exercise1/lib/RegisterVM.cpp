@@ -0,0 +1,55 @@
+#include "lib/RegisterVM.hpp"
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <algorithm>
+#include <cmath>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+RegisterVM::RegisterVM(const RegisterProgram& program) : program(program), registers(program.getRegisterCount()) {
+    const auto& constants = program.getConstants();
+    std::copy(constants.begin(), constants.end(), registers.begin() + program.getConstantBase());
+}
+//---------------------------------------------------------------------------
+double RegisterVM::run(const EvaluationContext& context) {
+    double* r = registers.data();
+
+    for (const auto& instruction : program.getInstructions()) {
+        switch (instruction.opCode) {
+            case RegisterProgram::OpCode::LoadParameter:
+                r[instruction.dst] = context.getParameter(instruction.src1);
+                break;
+            case RegisterProgram::OpCode::Negate:
+                r[instruction.dst] = -r[instruction.src1];
+                break;
+            case RegisterProgram::OpCode::SquareRoot:
+                r[instruction.dst] = SquareRoot::apply(r[instruction.src1]);
+                break;
+            case RegisterProgram::OpCode::Add:
+                r[instruction.dst] = r[instruction.src1] + r[instruction.src2];
+                break;
+            case RegisterProgram::OpCode::Subtract:
+                r[instruction.dst] = r[instruction.src1] - r[instruction.src2];
+                break;
+            case RegisterProgram::OpCode::Multiply:
+                r[instruction.dst] = r[instruction.src1] * r[instruction.src2];
+                break;
+            case RegisterProgram::OpCode::Divide:
+                r[instruction.dst] = r[instruction.src1] / r[instruction.src2];
+                break;
+            case RegisterProgram::OpCode::Power:
+                r[instruction.dst] = std::pow(r[instruction.src1], r[instruction.src2]);
+                break;
+            case RegisterProgram::OpCode::FusedMultiplyAdd:
+                r[instruction.dst] = FusedMultiplyAdd::apply(r[instruction.src1], r[instruction.src2], r[instruction.src3]);
+                break;
+            case RegisterProgram::OpCode::FusedMultiplySubtract:
+                r[instruction.dst] = FusedMultiplySubtract::apply(r[instruction.src1], r[instruction.src2], r[instruction.src3]);
+                break;
+        }
+    }
+    return r[program.getResultRegister()];
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
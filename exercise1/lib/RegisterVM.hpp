@@ -0,0 +1,29 @@
+#ifndef H_lib_RegisterVM
+#define H_lib_RegisterVM
+//---------------------------------------------------------------------------
+#include "lib/RegisterProgram.hpp"
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class EvaluationContext;
+//---------------------------------------------------------------------------
+/// A register machine that executes a compiled register program.
+/// The register file is allocated and filled with the constants once,
+/// a RegisterVM must not be shared between threads.
+class RegisterVM {
+public:
+    explicit RegisterVM(const RegisterProgram& program);
+    /// The VM references the program, which must outlive it
+    explicit RegisterVM(RegisterProgram&&) = delete;
+
+    double run(const EvaluationContext& context);
+
+private:
+    const RegisterProgram& program;
+    std::vector<double> registers;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,434 @@
+#include "lib/Rewriter.hpp"
+#include "lib/AST.hpp"
+#include "lib/AdditionChain.hpp"
+#include "lib/Arena.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+using Type = ASTNode::Type;
+using Slot = std::unique_ptr<ASTNode>;
+//---------------------------------------------------------------------------
+/// What an operand must be for a rule to match
+enum class Operand : uint8_t {
+    Any,
+    Constant,
+    Zero,
+    One,
+    MinusOne,
+    Half,
+    MinusHalf,
+    /// An integer constant n with an addition chain, see AdditionChain
+    ChainExponent,
+    /// A unary minus
+    Negated,
+    /// A subtraction
+    Difference,
+    /// A multiplication
+    Product
+};
+//---------------------------------------------------------------------------
+/// A rewrite replaces the node in its slot
+using Rewrite = void (*)(Slot& node);
+//---------------------------------------------------------------------------
+/// A declarative rule, unary nodes only have a left operand and only the
+/// fused multiply-adds have a third one
+struct Rule {
+    Type type;
+    Operand left;
+    Operand right;
+    Rewrite rewrite;
+    Operand third = Operand::Any;
+};
+//---------------------------------------------------------------------------
+bool isUnary(Type type) {
+    return type == Type::UnaryPlus || type == Type::UnaryMinus || type == Type::SquareRoot;
+}
+//---------------------------------------------------------------------------
+bool isTernary(Type type) {
+    return type == Type::FusedMultiplyAdd || type == Type::FusedMultiplySubtract;
+}
+//---------------------------------------------------------------------------
+bool matches(Operand operand, const ASTNode& node) {
+    Type type = node.getType();
+    switch (operand) {
+        case Operand::Any: return true;
+        case Operand::Constant: return type == Type::Constant;
+        case Operand::Zero: return type == Type::Constant && static_cast<const Constant&>(node).getValue() == 0.0;
+        case Operand::One: return type == Type::Constant && static_cast<const Constant&>(node).getValue() == 1.0;
+        case Operand::MinusOne: return type == Type::Constant && static_cast<const Constant&>(node).getValue() == -1.0;
+        case Operand::Half: return type == Type::Constant && static_cast<const Constant&>(node).getValue() == 0.5;
+        case Operand::MinusHalf: return type == Type::Constant && static_cast<const Constant&>(node).getValue() == -0.5;
+        case Operand::ChainExponent: return type == Type::Constant && AdditionChain::isExponent(static_cast<const Constant&>(node).getValue());
+        case Operand::Negated: return type == Type::UnaryMinus;
+        case Operand::Difference: return type == Type::Subtract;
+        case Operand::Product: return type == Type::Multiply;
+    }
+    return false;
+}
+//---------------------------------------------------------------------------
+UnaryASTNode& unary(Slot& node) {
+    return static_cast<UnaryASTNode&>(*node);
+}
+//---------------------------------------------------------------------------
+BinaryASTNode& binary(Slot& node) {
+    return static_cast<BinaryASTNode&>(*node);
+}
+//---------------------------------------------------------------------------
+/// The rules of every node type
+using RuleTable = std::array<std::span<const Rule>, static_cast<size_t>(Type::Parameter) + 1>;
+//---------------------------------------------------------------------------
+/// The input of a unary minus operand, the operand itself is dropped
+Slot releaseNegated(Slot operand) {
+    return static_cast<UnaryASTNode&>(*operand).releaseInput();
+}
+//---------------------------------------------------------------------------
+/// Create a replacement for node in the arena of node
+template <typename T, typename... Args>
+Slot make(const Slot& node, Args&&... args) {
+    return makeNode<T>(Arena::of(*node), std::forward<Args>(args)...);
+}
+//---------------------------------------------------------------------------
+const Rule* match(const ASTNode& node);
+//---------------------------------------------------------------------------
+/// Apply rules to a new node whose operands are already optimized
+void simplify(Slot& node) {
+    while (const Rule* rule = match(*node))
+        rule->rewrite(node);
+}
+//---------------------------------------------------------------------------
+/// All operands are constants: c1 op c2 -> c
+void fold(Slot& node) {
+    EvaluationContext context;
+    node = make<Constant>(node, node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+/// +a -> a
+void keepInput(Slot& node) {
+    node = unary(node).releaseInput();
+}
+//---------------------------------------------------------------------------
+/// a op neutral -> a
+void keepLeft(Slot& node) {
+    node = binary(node).releaseLeft();
+}
+//---------------------------------------------------------------------------
+/// neutral op a -> a
+void keepRight(Slot& node) {
+    node = binary(node).releaseRight();
+}
+//---------------------------------------------------------------------------
+/// a * 0 -> 0, 0 / a -> 0, 0 ^ a -> 0
+void zero(Slot& node) {
+    node = make<Constant>(node, 0.0);
+}
+//---------------------------------------------------------------------------
+/// a ^ 0 -> 1, 1 ^ a -> 1
+void one(Slot& node) {
+    node = make<Constant>(node, 1.0);
+}
+//---------------------------------------------------------------------------
+/// -(-a) -> a
+void doubleNegation(Slot& node) {
+    node = releaseNegated(unary(node).releaseInput());
+}
+//---------------------------------------------------------------------------
+/// -(a - b) -> b - a
+void negateDifference(Slot& node) {
+    Slot difference = unary(node).releaseInput();
+    auto& subtract = static_cast<BinaryASTNode&>(*difference);
+    Slot a = subtract.releaseLeft();
+    node = make<Subtract>(node, subtract.releaseRight(), std::move(a));
+}
+//---------------------------------------------------------------------------
+/// (-a) + b -> b - a
+void addNegatedLeft(Slot& node) {
+    Slot a = releaseNegated(binary(node).releaseLeft());
+    node = make<Subtract>(node, binary(node).releaseRight(), std::move(a));
+}
+//---------------------------------------------------------------------------
+/// a + (-b) -> a - b
+void addNegatedRight(Slot& node) {
+    Slot b = releaseNegated(binary(node).releaseRight());
+    node = make<Subtract>(node, binary(node).releaseLeft(), std::move(b));
+}
+//---------------------------------------------------------------------------
+/// 0 - a -> -a
+void subtractFromZero(Slot& node) {
+    node = make<UnaryMinus>(node, binary(node).releaseRight());
+}
+//---------------------------------------------------------------------------
+/// a - (-b) -> a + b
+void subtractNegated(Slot& node) {
+    Slot b = releaseNegated(binary(node).releaseRight());
+    node = make<Add>(node, binary(node).releaseLeft(), std::move(b));
+}
+//---------------------------------------------------------------------------
+/// (-a) op (-b) -> a op b, for multiplication and division
+template <typename T>
+void cancelNegations(Slot& node) {
+    Slot a = releaseNegated(binary(node).releaseLeft());
+    Slot b = releaseNegated(binary(node).releaseRight());
+    node = make<T>(node, std::move(a), std::move(b));
+}
+//---------------------------------------------------------------------------
+/// a / c -> a * (1 / c)
+void divideByConstant(Slot& node) {
+    double c = static_cast<const Constant&>(binary(node).getRight()).getValue();
+    node = make<Multiply>(node, binary(node).releaseLeft(), make<Constant>(node, 1.0 / c));
+}
+//---------------------------------------------------------------------------
+/// a ^ -1 -> 1 / a
+void reciprocal(Slot& node) {
+    node = make<Divide>(node, make<Constant>(node, 1.0), binary(node).releaseLeft());
+}
+//---------------------------------------------------------------------------
+/// a ^ 0.5 -> sqrt(a)
+void squareRoot(Slot& node) {
+    node = make<SquareRoot>(node, binary(node).releaseLeft());
+}
+//---------------------------------------------------------------------------
+/// a ^ -0.5 -> 1 / sqrt(a)
+void reciprocalSquareRoot(Slot& node) {
+    Slot root = make<SquareRoot>(node, binary(node).releaseLeft());
+    simplify(root);
+    node = make<Divide>(node, make<Constant>(node, 1.0), std::move(root));
+}
+//---------------------------------------------------------------------------
+/// a ^ n -> a ^ n multiplied along the addition chain of n, see IntegerPower
+void integerPower(Slot& node) {
+    Slot a = binary(node).releaseLeft();
+    node = make<IntegerPower>(node, std::move(a), binary(node).releaseRight());
+}
+//---------------------------------------------------------------------------
+/// The operands of a multiplication, the multiplication itself is dropped
+std::pair<Slot, Slot> releaseProduct(Slot product) {
+    auto& multiply = static_cast<BinaryASTNode&>(*product);
+    Slot a = multiply.releaseLeft();
+    return {std::move(a), multiply.releaseRight()};
+}
+//---------------------------------------------------------------------------
+/// -a for an operand of a new node, without a double negation
+Slot negate(const Slot& node, Slot a) {
+    if (a->getType() == Type::Constant)
+        return make<Constant>(node, -static_cast<const Constant&>(*a).getValue());
+    if (a->getType() == Type::UnaryMinus)
+        return releaseNegated(std::move(a));
+    return make<UnaryMinus>(node, std::move(a));
+}
+//---------------------------------------------------------------------------
+/// a * b + c -> fma(a, b, c)
+void fuseLeft(Slot& node) {
+    auto [a, b] = releaseProduct(binary(node).releaseLeft());
+    node = make<FusedMultiplyAdd>(node, std::move(a), std::move(b), binary(node).releaseRight());
+}
+//---------------------------------------------------------------------------
+/// c + a * b -> fma(a, b, c)
+void fuseRight(Slot& node) {
+    auto [a, b] = releaseProduct(binary(node).releaseRight());
+    node = make<FusedMultiplyAdd>(node, std::move(a), std::move(b), binary(node).releaseLeft());
+}
+//---------------------------------------------------------------------------
+/// a * b - c -> fms(a, b, c)
+void fuseDifference(Slot& node) {
+    auto [a, b] = releaseProduct(binary(node).releaseLeft());
+    node = make<FusedMultiplySubtract>(node, std::move(a), std::move(b), binary(node).releaseRight());
+}
+//---------------------------------------------------------------------------
+/// c - a * b -> fma(-a, b, c), negating a is exact
+void fuseNegatedProduct(Slot& node) {
+    auto [a, b] = releaseProduct(binary(node).releaseRight());
+    node = make<FusedMultiplyAdd>(node, negate(node, std::move(a)), std::move(b), binary(node).releaseLeft());
+}
+//---------------------------------------------------------------------------
+/// All rules grouped by node type, the first matching rule of a type wins
+constexpr Rule rules[] = {
+    {Type::UnaryPlus, Operand::Any, Operand::Any, keepInput},
+
+    {Type::UnaryMinus, Operand::Constant, Operand::Any, fold},
+    {Type::UnaryMinus, Operand::Negated, Operand::Any, doubleNegation},
+    {Type::UnaryMinus, Operand::Difference, Operand::Any, negateDifference},
+
+    {Type::SquareRoot, Operand::Constant, Operand::Any, fold},
+
+    {Type::Add, Operand::Constant, Operand::Constant, fold},
+    {Type::Add, Operand::Any, Operand::Zero, keepLeft},
+    {Type::Add, Operand::Zero, Operand::Any, keepRight},
+    {Type::Add, Operand::Negated, Operand::Any, addNegatedLeft},
+    {Type::Add, Operand::Any, Operand::Negated, addNegatedRight},
+
+    {Type::Subtract, Operand::Constant, Operand::Constant, fold},
+    {Type::Subtract, Operand::Any, Operand::Zero, keepLeft},
+    {Type::Subtract, Operand::Zero, Operand::Any, subtractFromZero},
+    {Type::Subtract, Operand::Any, Operand::Negated, subtractNegated},
+
+    {Type::Multiply, Operand::Constant, Operand::Constant, fold},
+    {Type::Multiply, Operand::Any, Operand::Zero, zero},
+    {Type::Multiply, Operand::Any, Operand::One, keepLeft},
+    {Type::Multiply, Operand::Zero, Operand::Any, zero},
+    {Type::Multiply, Operand::One, Operand::Any, keepRight},
+    {Type::Multiply, Operand::Negated, Operand::Negated, cancelNegations<Multiply>},
+
+    {Type::Divide, Operand::Constant, Operand::Constant, fold},
+    {Type::Divide, Operand::Any, Operand::One, keepLeft},
+    {Type::Divide, Operand::Zero, Operand::Any, zero},
+    {Type::Divide, Operand::Any, Operand::Constant, divideByConstant},
+    {Type::Divide, Operand::Negated, Operand::Negated, cancelNegations<Divide>},
+
+    {Type::Power, Operand::Constant, Operand::Constant, fold},
+    {Type::Power, Operand::Any, Operand::Zero, one},
+    {Type::Power, Operand::Any, Operand::One, keepLeft},
+    {Type::Power, Operand::Any, Operand::MinusOne, reciprocal},
+    {Type::Power, Operand::Any, Operand::Half, squareRoot},
+    {Type::Power, Operand::Any, Operand::MinusHalf, reciprocalSquareRoot},
+    {Type::Power, Operand::Any, Operand::ChainExponent, integerPower},
+    {Type::Power, Operand::Zero, Operand::Any, zero},
+    {Type::Power, Operand::One, Operand::Any, one},
+
+    {Type::IntegerPower, Operand::Constant, Operand::Any, fold},
+
+    {Type::FusedMultiplyAdd, Operand::Constant, Operand::Constant, fold, Operand::Constant},
+
+    {Type::FusedMultiplySubtract, Operand::Constant, Operand::Constant, fold, Operand::Constant},
+};
+//---------------------------------------------------------------------------
+/// The rules of the fusion pass. They change the rounding, so they are not
+/// part of the optimization rules.
+constexpr Rule fusionRules[] = {
+    {Type::Add, Operand::Product, Operand::Any, fuseLeft},
+    {Type::Add, Operand::Any, Operand::Product, fuseRight},
+
+    {Type::Subtract, Operand::Product, Operand::Any, fuseDifference},
+    {Type::Subtract, Operand::Any, Operand::Product, fuseNegatedProduct},
+};
+//---------------------------------------------------------------------------
+/// Group rules by node type
+constexpr RuleTable groupByType(std::span<const Rule> rules) {
+    RuleTable result{};
+    for (size_t begin = 0; begin < rules.size();) {
+        size_t end = begin;
+        while (end < rules.size() && rules[end].type == rules[begin].type)
+            ++end;
+        result[static_cast<size_t>(rules[begin].type)] = rules.subspan(begin, end - begin);
+        begin = end;
+    }
+    return result;
+}
+//---------------------------------------------------------------------------
+constexpr RuleTable optimizationRules = groupByType(rules);
+constexpr RuleTable fusionRulesByType = groupByType(fusionRules);
+//---------------------------------------------------------------------------
+/// The first rule of table that matches node, nullptr if there is none
+const Rule* match(const ASTNode& node, const RuleTable& table) {
+    auto candidates = table[static_cast<size_t>(node.getType())];
+    if (candidates.empty())
+        return nullptr;
+    const ASTNode* operands[3] = {};
+    if (isUnary(node.getType())) {
+        operands[0] = &static_cast<const UnaryASTNode&>(node).getInput();
+    } else if (isTernary(node.getType())) {
+        const auto& ternary = static_cast<const TernaryASTNode&>(node);
+        operands[0] = &ternary.getFirst();
+        operands[1] = &ternary.getSecond();
+        operands[2] = &ternary.getThird();
+    } else {
+        operands[0] = &static_cast<const BinaryASTNode&>(node).getLeft();
+        operands[1] = &static_cast<const BinaryASTNode&>(node).getRight();
+    }
+    for (const auto& rule : candidates)
+        if (matches(rule.left, *operands[0]) && (!operands[1] || matches(rule.right, *operands[1])) && (!operands[2] || matches(rule.third, *operands[2])))
+            return &rule;
+    return nullptr;
+}
+//---------------------------------------------------------------------------
+/// The first optimization rule that matches node
+const Rule* match(const ASTNode& node) {
+    return match(node, optimizationRules);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+size_t Rewriter::optimize(std::unique_ptr<ASTNode>& root) {
+    bool stopped;
+    return optimize(root, std::chrono::steady_clock::time_point::max(), stopped);
+}
+//---------------------------------------------------------------------------
+size_t Rewriter::optimize(std::unique_ptr<ASTNode>& root, std::chrono::steady_clock::time_point deadline, bool& stopped) {
+    return rewrite(root, deadline, RuleSet::Optimization, stopped);
+}
+//---------------------------------------------------------------------------
+size_t Rewriter::fuse(std::unique_ptr<ASTNode>& root) {
+    bool stopped;
+    return fuse(root, std::chrono::steady_clock::time_point::max(), stopped);
+}
+//---------------------------------------------------------------------------
+size_t Rewriter::fuse(std::unique_ptr<ASTNode>& root, std::chrono::steady_clock::time_point deadline, bool& stopped) {
+    return rewrite(root, deadline, RuleSet::Fusion, stopped);
+}
+//---------------------------------------------------------------------------
+size_t Rewriter::rewrite(std::unique_ptr<ASTNode>& root, std::chrono::steady_clock::time_point deadline, RuleSet rules, bool& stopped) {
+    const RuleTable& table = (rules == RuleSet::Fusion) ? fusionRulesByType : optimizationRules;
+    // Reading the clock is checked every few thousand nodes only
+    constexpr size_t deadlineInterval = 4096;
+    size_t visits = 0;
+    size_t rewrites = 0;
+    // Post-order with an explicit stack, an entry is expanded once its operands are pushed
+    struct Entry {
+        Slot* slot;
+        bool expanded;
+    };
+    std::vector<Entry> stack{{&root, false}};
+    stopped = false;
+    while (!stack.empty()) {
+        if (++visits % deadlineInterval == 0 && std::chrono::steady_clock::now() >= deadline) {
+            stopped = true;
+            break;
+        }
+        Slot* slot = stack.back().slot;
+        if (!stack.back().expanded) {
+            stack.back().expanded = true;
+            switch ((*slot)->getType()) {
+                case Type::UnaryPlus:
+                case Type::UnaryMinus:
+                case Type::SquareRoot:
+                    stack.push_back({&static_cast<UnaryASTNode&>(**slot).child, false});
+                    break;
+                case Type::FusedMultiplyAdd:
+                case Type::FusedMultiplySubtract: {
+                    auto& node = static_cast<TernaryASTNode&>(**slot);
+                    stack.push_back({&node.third, false});
+                    stack.push_back({&node.second, false});
+                    stack.push_back({&node.first, false});
+                    break;
+                }
+                case Type::Constant:
+                case Type::Parameter:
+                    break;
+                default: {
+                    auto& node = static_cast<BinaryASTNode&>(**slot);
+                    stack.push_back({&node.right, false});
+                    stack.push_back({&node.left, false});
+                    break;
+                }
+            }
+            continue;
+        }
+        stack.pop_back();
+        // A replacement combines optimized operands, only it has to be matched again
+        while (const Rule* rule = match(**slot, table)) {
+            rule->rewrite(*slot);
+            ++rewrites;
+        }
+    }
+    return rewrites;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
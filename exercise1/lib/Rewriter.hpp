@@ -0,0 +1,53 @@
+#ifndef H_lib_Rewriter
+#define H_lib_Rewriter
+//---------------------------------------------------------------------------
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+//---------------------------------------------------------------------------
+/// Optimizes trees with a table of rewrite rules.
+/// A rule names a node type, a pattern for each operand and a rewrite. The
+/// patterns only look at the type tags and constant values of the operands,
+/// so matching needs no dynamic_cast. The rules of a type are tried in table
+/// order and the first match replaces the node.
+///
+/// The tree is traversed once bottom-up with an explicit stack, so deep
+/// generated trees do not overflow the call stack. When a node is visited its
+/// operands are already optimized, and a rewrite only combines such operands,
+/// so only the replacement itself has to be matched again. Rewrites that build
+/// several new nodes, like 1 / sqrt(a) for a ^ -0.5, match each one as it is
+/// built. Rewrites reuse the operand nodes and allocate only when the node
+/// type changes, in the arena of the replaced node.
+class Rewriter {
+public:
+    /// Rewrite the tree of root until no rule matches any node, returns the number of rewrites
+    static size_t optimize(std::unique_ptr<ASTNode>& root);
+    /// Stop early once deadline has passed, which leaves a valid but partially
+    /// optimized tree. Sets stopped to whether that happened.
+    static size_t optimize(std::unique_ptr<ASTNode>& root, std::chrono::steady_clock::time_point deadline, bool& stopped);
+
+    /// Fuse a * b + c, c + a * b, a * b - c and c - a * b into fused
+    /// multiply-adds, returns the number of fusions. This is a separate pass
+    /// because the single rounding changes the results, usually for the
+    /// better. Run it after optimize(), which folds the constant products.
+    static size_t fuse(std::unique_ptr<ASTNode>& root);
+    static size_t fuse(std::unique_ptr<ASTNode>& root, std::chrono::steady_clock::time_point deadline, bool& stopped);
+
+private:
+    /// The rule tables
+    enum class RuleSet : uint8_t {
+        Optimization,
+        Fusion
+    };
+
+    static size_t rewrite(std::unique_ptr<ASTNode>& root, std::chrono::steady_clock::time_point deadline, RuleSet rules, bool& stopped);
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,146 @@
+#include "lib/Streaming.hpp"
+#include "lib/ColumnFile.hpp"
+#include "lib/ColumnarContext.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// One of the two buffers, it cycles through the states Free, Loaded and Computed
+struct Chunk {
+    enum class State : uint8_t {
+        Free,
+        Loaded,
+        Computed
+    };
+
+    std::vector<std::vector<double>> columns;
+    std::vector<double> out;
+    size_t firstRow = 0;
+    size_t rowCount = 0;
+    State state = State::Free;
+};
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+StreamingEvaluator::StreamingEvaluator(const ASTNode& node, size_t chunkRows) : evaluator(node), chunkRows(chunkRows ? chunkRows : defaultChunkRows) {
+    for (const auto& instruction : evaluator.getProgram().getInstructions()) {
+        if (instruction.opCode != Program::OpCode::PushParameter)
+            continue;
+        if (referenced.size() <= instruction.operand)
+            referenced.resize(instruction.operand + 1);
+        referenced[instruction.operand] = true;
+    }
+}
+//---------------------------------------------------------------------------
+bool StreamingEvaluator::evaluate(const ColumnFileReader& input, ColumnFileWriter& output) {
+    if (output.getColumnCount() < 1 || output.getRowCount() != input.getRowCount())
+        return false;
+    size_t rowCount = input.getRowCount();
+    size_t chunkCount = (rowCount + chunkRows - 1) / chunkRows;
+    // Parameters that are missing in the file read as 0 like in every context
+    size_t columnCount = std::min(referenced.size(), input.getColumnCount());
+
+    Chunk chunks[2];
+    for (auto& chunk : chunks) {
+        chunk.columns.resize(columnCount);
+        for (size_t c = 0; c < columnCount; ++c)
+            if (referenced[c])
+                chunk.columns[c].resize(chunkRows);
+        chunk.out.resize(chunkRows);
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool failed = false;
+    // Wait until the chunk is in one of the states or the other side failed
+    auto waitFor = [&](Chunk& chunk, Chunk::State state, Chunk::State other) {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return failed || chunk.state == state || chunk.state == other; });
+        return !failed;
+    };
+    auto setState = [&](Chunk& chunk, Chunk::State state) {
+        {
+            std::lock_guard lock(mutex);
+            chunk.state = state;
+        }
+        changed.notify_all();
+    };
+    auto fail = [&] {
+        {
+            std::lock_guard lock(mutex);
+            failed = true;
+        }
+        changed.notify_all();
+    };
+    auto write = [&](Chunk& chunk) {
+        return output.write(0, chunk.firstRow, std::span(chunk.out).first(chunk.rowCount));
+    };
+
+    // The I/O thread writes the results of a buffer and refills it, chunk i
+    // uses buffer i % 2
+    std::thread io([&] {
+        for (size_t i = 0; i < chunkCount; ++i) {
+            Chunk& chunk = chunks[i % 2];
+            if (!waitFor(chunk, Chunk::State::Free, Chunk::State::Computed))
+                return;
+            if (chunk.state == Chunk::State::Computed && !write(chunk))
+                return fail();
+            chunk.firstRow = i * chunkRows;
+            chunk.rowCount = std::min(chunkRows, rowCount - chunk.firstRow);
+            for (size_t c = 0; c < columnCount; ++c)
+                if (referenced[c] && !input.read(c, chunk.firstRow, std::span(chunk.columns[c]).first(chunk.rowCount)))
+                    return fail();
+            setState(chunk, Chunk::State::Loaded);
+        }
+        for (size_t i = chunkCount < 2 ? 0 : chunkCount - 2; i < chunkCount; ++i) {
+            Chunk& chunk = chunks[i % 2];
+            if (!waitFor(chunk, Chunk::State::Computed, Chunk::State::Computed))
+                return;
+            if (!write(chunk))
+                return fail();
+            setState(chunk, Chunk::State::Free);
+        }
+    });
+
+    try {
+        for (size_t i = 0; i < chunkCount; ++i) {
+            Chunk& chunk = chunks[i % 2];
+            if (!waitFor(chunk, Chunk::State::Loaded, Chunk::State::Loaded))
+                break;
+            ColumnarContext context;
+            for (const auto& column : chunk.columns)
+                context.pushColumn(std::span(column).first(column.empty() ? 0 : chunk.rowCount));
+            evaluator.evaluate(context, std::span(chunk.out).first(chunk.rowCount));
+            setState(chunk, Chunk::State::Computed);
+        }
+    } catch (...) {
+        // Stop the I/O thread before the exception leaves, destroying a
+        // joinable thread would terminate the process
+        fail();
+        io.join();
+        throw;
+    }
+    io.join();
+    return !failed;
+}
+//---------------------------------------------------------------------------
+bool StreamingEvaluator::evaluate(const std::string& inputPath, const std::string& outputPath) {
+    auto input = ColumnFileReader::open(inputPath);
+    if (!input)
+        return false;
+    auto output = ColumnFileWriter::create(outputPath, 1, input->getRowCount());
+    return output && evaluate(*input, *output);
+}
+//---------------------------------------------------------------------------
+size_t StreamingEvaluator::getChunkRows() const {
+    return chunkRows;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
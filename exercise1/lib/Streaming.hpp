@@ -0,0 +1,45 @@
+#ifndef H_lib_Streaming
+#define H_lib_Streaming
+//---------------------------------------------------------------------------
+#include "lib/Batch.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class ASTNode;
+class ColumnFileReader;
+class ColumnFileWriter;
+//---------------------------------------------------------------------------
+/// Evaluates an expression over a column file that does not fit into memory.
+/// The rows are processed in chunks with two buffers: while the expression
+/// runs on one chunk, an I/O thread writes the results of the previous chunk
+/// and reads the parameters of the next one into the other buffer. Only the
+/// columns the expression references are read, so the memory use is bounded
+/// by 2 * chunkRows * (referenced columns + 1) doubles.
+class StreamingEvaluator {
+public:
+    static constexpr size_t defaultChunkRows = 64 * 1024;
+
+    /// A chunkRows of 0 uses the default
+    explicit StreamingEvaluator(const ASTNode& node, size_t chunkRows = defaultChunkRows);
+
+    /// Write the result of every row of input into column 0 of output, which
+    /// must have as many rows. Returns false on I/O errors.
+    bool evaluate(const ColumnFileReader& input, ColumnFileWriter& output);
+    /// Evaluate a file into a new file with one column, false on I/O errors
+    bool evaluate(const std::string& inputPath, const std::string& outputPath);
+
+    size_t getChunkRows() const;
+
+private:
+    BatchEvaluator evaluator;
+    size_t chunkRows;
+    /// Whether the expression reads a parameter
+    std::vector<bool> referenced;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
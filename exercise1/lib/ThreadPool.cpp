@@ -0,0 +1,111 @@
+#include "lib/ThreadPool.hpp"
+#include <algorithm>
+#include <utility>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (!threadCount)
+        threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t i = 0; i < threadCount; ++i)
+        queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back([this, i] { work(i); });
+}
+//---------------------------------------------------------------------------
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+//---------------------------------------------------------------------------
+void ThreadPool::run(size_t taskCount, const Task& task) {
+    if (!taskCount)
+        return;
+    size_t threadCount = queues.size();
+    for (size_t worker = 0; worker < threadCount; ++worker) {
+        std::lock_guard lock(queues[worker]->mutex);
+        for (size_t i = taskCount * worker / threadCount; i < taskCount * (worker + 1) / threadCount; ++i)
+            queues[worker]->tasks.push_back(i);
+    }
+    {
+        std::lock_guard lock(mutex);
+        current = &task;
+        busy = threadCount;
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain(0);
+    std::unique_lock lock(mutex);
+    --busy;
+    // Every thread takes part in every run, so the next run cannot start
+    // before all threads saw this one
+    done.wait(lock, [this] { return !busy; });
+    current = nullptr;
+    if (error)
+        std::rethrow_exception(std::exchange(error, nullptr));
+}
+//---------------------------------------------------------------------------
+size_t ThreadPool::getThreadCount() const {
+    return queues.size();
+}
+//---------------------------------------------------------------------------
+void ThreadPool::work(size_t worker) {
+    size_t seen = 0;
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping)
+            return;
+        seen = generation;
+        lock.unlock();
+        drain(worker);
+        lock.lock();
+        if (!--busy)
+            done.notify_all();
+    }
+}
+//---------------------------------------------------------------------------
+void ThreadPool::drain(size_t worker) {
+    size_t task;
+    while (take(worker, task)) {
+        try {
+            (*current)(task, worker);
+        } catch (...) {
+            std::lock_guard lock(mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+}
+//---------------------------------------------------------------------------
+bool ThreadPool::take(size_t worker, size_t& task) {
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    // No new tasks arrive during a run, so one pass over the others suffices
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue& victim = *queues[(worker + i) % queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
@@ -0,0 +1,71 @@
+#ifndef H_lib_ThreadPool
+#define H_lib_ThreadPool
+//---------------------------------------------------------------------------
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+/// A fixed set of worker threads that run parallel loops with work stealing.
+/// run() splits the tasks into one contiguous range per worker. A worker
+/// takes tasks from the front of its own queue and, once that is empty, steals
+/// from the back of the other queues, so uneven tasks still keep all workers
+/// busy. The calling thread is worker 0, a pool with one thread runs
+/// everything inline. Only one run() may be active at a time.
+class ThreadPool {
+public:
+    /// The task index and the worker that runs it, in [0, getThreadCount())
+    using Task = std::function<void(size_t task, size_t worker)>;
+
+    /// Use one thread per hardware thread if threadCount is 0
+    explicit ThreadPool(size_t threadCount = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    /// Run task(i, worker) for all i in [0, taskCount) and wait for them.
+    /// The first exception thrown by a task is rethrown after all tasks ran.
+    void run(size_t taskCount, const Task& task);
+
+    size_t getThreadCount() const;
+
+private:
+    /// The pending tasks of one worker
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    /// The main loop of the threads 1 to threadCount - 1
+    void work(size_t worker);
+    /// Run tasks until all queues are empty
+    void drain(size_t worker);
+    /// Take a task from the own queue or steal one, false if there is none
+    bool take(size_t worker, size_t& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    /// Protects the fields below
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    /// Incremented for every run(), wakes up the workers
+    size_t generation = 0;
+    /// The threads that are still draining the current run
+    size_t busy = 0;
+    bool stopping = false;
+    const Task* current = nullptr;
+    std::exception_ptr error;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,151 @@
+#include "lib/ThreadedVM.hpp"
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <cmath>
+//---------------------------------------------------------------------------
+#if defined(__GNUC__)
+#define AST_DIRECT_THREADED 1
+#endif
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The program's opcodes plus the end marker of the threaded code
+constexpr uint32_t haltOpCode = static_cast<uint32_t>(Program::OpCode::Load) + 1;
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+ThreadedVM::ThreadedVM(const Program& program) : program(program), stack(program.getMaxStackDepth()), slots(program.getSlotCount()) {
+    execute(nullptr);
+}
+//---------------------------------------------------------------------------
+double ThreadedVM::run(const EvaluationContext& context) {
+    return execute(&context);
+}
+//---------------------------------------------------------------------------
+bool ThreadedVM::isDirectThreaded() {
+#ifdef AST_DIRECT_THREADED
+    return true;
+#else
+    return false;
+#endif
+}
+//---------------------------------------------------------------------------
+#ifdef AST_DIRECT_THREADED
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+double ThreadedVM::execute(const EvaluationContext* context) {
+#ifdef AST_DIRECT_THREADED
+    // Indexed by opcode, the handler labels only exist inside this function
+    static const void* const handlers[] = {&&PushConstant, &&PushParameter, &&Negate, &&SquareRoot, &&Add, &&Subtract, &&Multiply, &&Divide, &&Power, &&FusedMultiplyAdd, &&FusedMultiplySubtract, &&Store, &&Load, &&Halt};
+#else
+    static const void* const handlers[haltOpCode + 1] = {};
+#endif
+
+    if (!context) {
+        code.clear();
+        code.reserve(program.getInstructions().size() + 1);
+        for (const auto& instruction : program.getInstructions()) {
+            auto opCode = static_cast<uint32_t>(instruction.opCode);
+            code.push_back({handlers[opCode], opCode, instruction.operand});
+        }
+        code.push_back({handlers[haltOpCode], haltOpCode, 0});
+        return 0.0;
+    }
+
+    const double* constants = program.getConstants().data();
+    // top points one past the topmost stack entry, pc one past the current cell
+    double* top = stack.data();
+    const Cell* pc = code.data();
+
+#ifdef AST_DIRECT_THREADED
+#define DISPATCH() goto* (pc++)->handler
+#define HANDLER(name) name:
+    DISPATCH();
+#else
+#define DISPATCH() break
+#define HANDLER(name) case static_cast<uint32_t>(Program::OpCode::name):
+    for (;;) {
+        switch ((pc++)->opCode) {
+#endif
+
+    HANDLER(PushConstant) {
+        *top++ = constants[pc[-1].operand];
+        DISPATCH();
+    }
+    HANDLER(PushParameter) {
+        *top++ = context->getParameter(pc[-1].operand);
+        DISPATCH();
+    }
+    HANDLER(Negate) {
+        top[-1] = -top[-1];
+        DISPATCH();
+    }
+    HANDLER(SquareRoot) {
+        top[-1] = SquareRoot::apply(top[-1]);
+        DISPATCH();
+    }
+    HANDLER(Add) {
+        --top;
+        top[-1] = top[-1] + top[0];
+        DISPATCH();
+    }
+    HANDLER(Subtract) {
+        --top;
+        top[-1] = top[-1] - top[0];
+        DISPATCH();
+    }
+    HANDLER(Multiply) {
+        --top;
+        top[-1] = top[-1] * top[0];
+        DISPATCH();
+    }
+    HANDLER(Divide) {
+        --top;
+        top[-1] = top[-1] / top[0];
+        DISPATCH();
+    }
+    HANDLER(Power) {
+        --top;
+        top[-1] = std::pow(top[-1], top[0]);
+        DISPATCH();
+    }
+    HANDLER(FusedMultiplyAdd) {
+        top -= 2;
+        top[-1] = FusedMultiplyAdd::apply(top[-1], top[0], top[1]);
+        DISPATCH();
+    }
+    HANDLER(FusedMultiplySubtract) {
+        top -= 2;
+        top[-1] = FusedMultiplySubtract::apply(top[-1], top[0], top[1]);
+        DISPATCH();
+    }
+    HANDLER(Store) {
+        slots[pc[-1].operand] = top[-1];
+        DISPATCH();
+    }
+    HANDLER(Load) {
+        *top++ = slots[pc[-1].operand];
+        DISPATCH();
+    }
+
+#ifdef AST_DIRECT_THREADED
+Halt:
+    return top[-1];
+#else
+            default:
+                return top[-1];
+        }
+    }
+#endif
+#undef DISPATCH
+#undef HANDLER
+}
+#ifdef AST_DIRECT_THREADED
+#pragma GCC diagnostic pop
+#endif
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
@@ -0,0 +1,47 @@
+#ifndef H_lib_ThreadedVM
+#define H_lib_ThreadedVM
+//---------------------------------------------------------------------------
+#include "lib/Program.hpp"
+#include <cstdint>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class EvaluationContext;
+//---------------------------------------------------------------------------
+/// A direct-threaded variant of VM.
+/// The program is translated once into a sequence of handler addresses and
+/// every handler jumps straight to the next one (GCC/Clang labels as values),
+/// so each opcode gets its own indirect branch instead of one shared switch.
+/// Other compilers fall back to a switch over the same translated code.
+class ThreadedVM {
+public:
+    explicit ThreadedVM(const Program& program);
+    /// The VM references the program, which must outlive it
+    explicit ThreadedVM(Program&&) = delete;
+
+    double run(const EvaluationContext& context);
+
+    /// Whether the computed goto dispatch is used
+    static bool isDirectThreaded();
+
+private:
+    /// A threaded instruction, handler is only used with computed goto
+    struct Cell {
+        const void* handler;
+        uint32_t opCode;
+        uint32_t operand;
+    };
+
+    /// Runs the threaded code, or translates the program if context is null
+    double execute(const EvaluationContext* context);
+
+    const Program& program;
+    std::vector<Cell> code;
+    std::vector<double> stack;
+    std::vector<double> slots;
+};
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
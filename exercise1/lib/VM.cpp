@@ -0,0 +1,75 @@
+#include "lib/VM.hpp"
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <cmath>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+template <typename T>
+BasicVM<T>::BasicVM(const Program& program) : program(program), stack(program.getMaxStackDepth()), slots(program.getSlotCount()) {}
+//---------------------------------------------------------------------------
+template <typename T>
+T BasicVM<T>::run(const EvaluationContext& context) {
+    const double* constants = program.getConstants().data();
+    // top points one past the topmost stack entry
+    T* top = stack.data();
+
+    for (const auto& instruction : program.getInstructions()) {
+        switch (instruction.opCode) {
+            case Program::OpCode::PushConstant:
+                *top++ = static_cast<T>(constants[instruction.operand]);
+                break;
+            case Program::OpCode::PushParameter:
+                *top++ = static_cast<T>(context.getParameter(instruction.operand));
+                break;
+            case Program::OpCode::Negate:
+                top[-1] = -top[-1];
+                break;
+            case Program::OpCode::SquareRoot:
+                top[-1] = SquareRoot::apply(top[-1]);
+                break;
+            case Program::OpCode::Add:
+                --top;
+                top[-1] = top[-1] + top[0];
+                break;
+            case Program::OpCode::Subtract:
+                --top;
+                top[-1] = top[-1] - top[0];
+                break;
+            case Program::OpCode::Multiply:
+                --top;
+                top[-1] = top[-1] * top[0];
+                break;
+            case Program::OpCode::Divide:
+                --top;
+                top[-1] = top[-1] / top[0];
+                break;
+            case Program::OpCode::Power:
+                --top;
+                top[-1] = std::pow(top[-1], top[0]);
+                break;
+            case Program::OpCode::FusedMultiplyAdd:
+                top -= 2;
+                top[-1] = FusedMultiplyAdd::apply(top[-1], top[0], top[1]);
+                break;
+            case Program::OpCode::FusedMultiplySubtract:
+                top -= 2;
+                top[-1] = FusedMultiplySubtract::apply(top[-1], top[0], top[1]);
+                break;
+            case Program::OpCode::Store:
+                slots[instruction.operand] = top[-1];
+                break;
+            case Program::OpCode::Load:
+                *top++ = slots[instruction.operand];
+                break;
+        }
+    }
+    return top[-1];
+}
+//---------------------------------------------------------------------------
+template class BasicVM<float>;
+template class BasicVM<double>;
+template class BasicVM<long double>;
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
@@ -0,0 +1,36 @@
+#ifndef H_lib_VM
+#define H_lib_VM
+//---------------------------------------------------------------------------
+#include "lib/Program.hpp"
+#include <vector>
+//---------------------------------------------------------------------------
+namespace ast {
+//---------------------------------------------------------------------------
+class EvaluationContext;
+//---------------------------------------------------------------------------
+/// A stack machine that executes a compiled program.
+/// The stack and the slots are sized once from the program, a VM must not be shared between threads.
+/// All values are computed in T, the parameters and constants are converted on load.
+template <typename T>
+class BasicVM {
+public:
+    explicit BasicVM(const Program& program);
+    /// The VM references the program, which must outlive it
+    explicit BasicVM(Program&&) = delete;
+
+    T run(const EvaluationContext& context);
+
+private:
+    const Program& program;
+    std::vector<T> stack;
+    std::vector<T> slots;
+};
+//---------------------------------------------------------------------------
+using VM = BasicVM<double>;
+extern template class BasicVM<float>;
+extern template class BasicVM<double>;
+extern template class BasicVM<long double>;
+//---------------------------------------------------------------------------
+} // namespace ast
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,33 @@
+#ifndef H_test_Fixtures
+#define H_test_Fixtures
+//---------------------------------------------------------------------------
+#include "lib/AST.hpp"
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+//---------------------------------------------------------------------------
+/// Inputs shared by the tests of the column-wise evaluators
+namespace fixtures {
+//---------------------------------------------------------------------------
+/// (p0 - p1) * -p2 / (p0 + 3) ^ 0.5
+inline std::unique_ptr<ast::ASTNode> makeExpression() {
+    using namespace ast;
+    auto difference = std::make_unique<Subtract>(std::make_unique<Parameter>(0), std::make_unique<Parameter>(1));
+    auto product = std::make_unique<Multiply>(std::move(difference), std::make_unique<UnaryMinus>(std::make_unique<Parameter>(2)));
+    auto root = std::make_unique<Power>(std::make_unique<Add>(std::make_unique<Parameter>(0), std::make_unique<Constant>(3.0)), std::make_unique<Constant>(0.5));
+    return std::make_unique<Divide>(std::move(product), std::move(root));
+}
+//---------------------------------------------------------------------------
+/// Columns with distinct values per row and parameter
+inline std::vector<std::vector<double>> makeColumns(size_t columnCount, size_t rowCount) {
+    std::vector<std::vector<double>> columns(columnCount);
+    for (size_t c = 0; c < columnCount; ++c)
+        for (size_t r = 0; r < rowCount; ++r)
+            columns[c].push_back(0.5 * r + c - 0.25 * (r % 7));
+    return columns;
+}
+//---------------------------------------------------------------------------
+} // namespace fixtures
+//---------------------------------------------------------------------------
+#endif
@@ -55,6 +55,33 @@ TEST(TestAST, EvaluatePower) {
     EXPECT_EQ(node->evaluate(context), 8.0);
 }
 //---------------------------------------------------------------------------
+TEST(TestAST, EvaluateSquareRoot) {
+    // The special cases follow pow(a, 0.5), not sqrt(a)
+    EvaluationContext context;
+    const double values[] = {2.25, 0.0, -0.0, INFINITY, -INFINITY, -1.0, NAN};
+    for (double value : values) {
+        auto node = make_unique<SquareRoot>(make_unique<Constant>(value));
+        double expected = pow(value, 0.5);
+        double result = node->evaluate(context);
+        EXPECT_EQ(isnan(result), isnan(expected)) << value;
+        if (!isnan(expected)) {
+            EXPECT_EQ(result, expected) << value;
+            EXPECT_EQ(signbit(result), signbit(expected)) << value;
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestAST, EvaluateFusedMultiplyAdd) {
+    // The product 1 - 2^-60 is only kept without the intermediate rounding
+    EvaluationContext context;
+    double a = 1.0 + 0x1p-30;
+    double b = 1.0 - 0x1p-30;
+    auto add = make_unique<FusedMultiplyAdd>(make_unique<Constant>(a), make_unique<Constant>(b), make_unique<Constant>(-1.0));
+    EXPECT_EQ(add->evaluate(context), -0x1p-60);
+    auto subtract = make_unique<FusedMultiplySubtract>(make_unique<Constant>(a), make_unique<Constant>(b), make_unique<Constant>(1.0));
+    EXPECT_EQ(subtract->evaluate(context), -0x1p-60);
+}
+//---------------------------------------------------------------------------
 TEST(TestAST, EvaluateParameter) {
     EvaluationContext context;
     context.pushParameter(1.0);
@@ -0,0 +1,112 @@
+#include "lib/AST.hpp"
+#include "lib/Aggregate.hpp"
+#include "lib/Batch.hpp"
+#include "lib/ColumnarContext.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// p0 * p1 - 3
+unique_ptr<ASTNode> makeExpression() {
+    return make_unique<Subtract>(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(1)), make_unique<Constant>(3.0));
+}
+//---------------------------------------------------------------------------
+vector<vector<double>> makeColumns(size_t rowCount) {
+    vector<vector<double>> columns(2);
+    for (size_t r = 0; r < rowCount; ++r) {
+        columns[0].push_back(0.5 * (r % 13) - 2.0);
+        columns[1].push_back(1.0 + 0.25 * (r % 7));
+    }
+    return columns;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestAggregate, MatchesMaterialized) {
+    auto node = makeExpression();
+    size_t rowCount = 37 * BatchEvaluator::maxTileSize + 11;
+    auto columns = makeColumns(rowCount);
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+
+    vector<double> results(rowCount);
+    evaluateBatch(*node, context, results);
+    double sum = 0;
+    for (double result : results)
+        sum += result;
+
+    for (auto summation : {Summation::Pairwise, Summation::Kahan}) {
+        AggregateEvaluator evaluator(*node, summation, 1.0);
+        auto aggregates = evaluator.evaluate(context);
+        EXPECT_EQ(aggregates.count, rowCount);
+        EXPECT_NEAR(aggregates.sum, sum, 1e-9 * fabs(sum));
+        EXPECT_NEAR(aggregates.getMean(), sum / rowCount, 1e-9 * fabs(sum / rowCount));
+        EXPECT_EQ(aggregates.min, *min_element(results.begin(), results.end()));
+        EXPECT_EQ(aggregates.max, *max_element(results.begin(), results.end()));
+        EXPECT_EQ(aggregates.aboveCount, static_cast<size_t>(count_if(results.begin(), results.end(), [](double v) { return v > 1.0; })));
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestAggregate, RowRange) {
+    auto node = makeExpression();
+    auto columns = makeColumns(1000);
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+
+    AggregateEvaluator evaluator(*node);
+    auto aggregates = evaluator.evaluate(context, 500, 3);
+    double expected[] = {columns[0][500] * columns[1][500] - 3, columns[0][501] * columns[1][501] - 3, columns[0][502] * columns[1][502] - 3};
+    EXPECT_EQ(aggregates.count, 3u);
+    EXPECT_EQ(aggregates.sum, expected[0] + expected[1] + expected[2]);
+    EXPECT_EQ(aggregates.min, *min_element(begin(expected), end(expected)));
+    EXPECT_EQ(aggregates.aboveCount, 0u);
+
+    auto empty = evaluator.evaluate(context, 1000, 0);
+    EXPECT_EQ(empty.count, 0u);
+    EXPECT_EQ(empty.sum, 0.0);
+    EXPECT_TRUE(isnan(empty.getMean()));
+    EXPECT_EQ(empty.min, numeric_limits<double>::infinity());
+}
+//---------------------------------------------------------------------------
+TEST(TestAggregate, NaN) {
+    auto node = make_unique<Divide>(make_unique<Parameter>(0), make_unique<Parameter>(0));
+    vector<double> column{0.0, 1.0, 2.0, 0.0, 3.0};
+    ColumnarContext context;
+    context.pushColumn(column);
+    auto aggregates = AggregateEvaluator(*node, Summation::Pairwise, 0.5).evaluate(context);
+    EXPECT_TRUE(isnan(aggregates.sum));
+    EXPECT_EQ(aggregates.min, 1.0);
+    EXPECT_EQ(aggregates.max, 1.0);
+    EXPECT_EQ(aggregates.aboveCount, 3u);
+}
+//---------------------------------------------------------------------------
+TEST(TestAggregate, Accuracy) {
+    // A million floats of 0.1 lose several digits when added up one by one
+    size_t rowCount = 1 << 20;
+    vector<float> column(rowCount, 0.1f);
+    BasicColumnarContext<float> context;
+    context.pushColumn(column);
+    auto node = make_unique<Parameter>(0);
+    double exact = static_cast<double>(0.1f) * rowCount;
+
+    float naive = 0;
+    for (float value : column)
+        naive += value;
+    float pairwise = BasicAggregateEvaluator<float>(*node, Summation::Pairwise).evaluate(context).sum;
+    float kahan = BasicAggregateEvaluator<float>(*node, Summation::Kahan).evaluate(context).sum;
+    EXPECT_GT(fabs(naive - exact), 1e-3 * exact);
+    EXPECT_LT(fabs(pairwise - exact), 1e-6 * exact);
+    EXPECT_LE(fabs(kahan - exact), 0.5 * exact * numeric_limits<float>::epsilon());
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,88 @@
+#include "lib/AST.hpp"
+#include "lib/Arena.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <memory>
+#include <utility>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+unique_ptr<ASTNode> makeTree(Arena& arena, unsigned terms) {
+    unique_ptr<ASTNode> node = arena.make<Parameter>(0);
+    for (unsigned i = 0; i < terms; ++i) {
+        auto term = arena.make<Multiply>(arena.make<Parameter>(1), arena.make<Constant>(i));
+        node = arena.make<Add>(move(node), move(term));
+    }
+    return node;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestArena, Evaluate) {
+    Arena arena;
+    auto node = makeTree(arena, 10);
+    EvaluationContext context;
+    context.pushParameter(1.0);
+    context.pushParameter(2.0);
+    EXPECT_EQ(node->evaluate(context), 91.0);
+    EXPECT_EQ(Arena::of(*node), &arena);
+    EXPECT_EQ(arena.getBlockCount(), 1u);
+    // Dropping the tree in O(1), the arena owns the memory
+    node.release();
+}
+//---------------------------------------------------------------------------
+TEST(TestArena, HeapNodes) {
+    auto node = make_unique<Add>(make_unique<Constant>(1.0), make_unique<Parameter>(0));
+    EXPECT_EQ(Arena::of(*node), nullptr);
+}
+//---------------------------------------------------------------------------
+TEST(TestArena, Destroy) {
+    SCOPED_TRACE("destroying arena nodes through unique_ptr does not free them");
+    Arena arena;
+    auto node = makeTree(arena, 100);
+    node.reset();
+    node = makeTree(arena, 1);
+    EXPECT_EQ(node->getType(), ASTNode::Type::Add);
+}
+//---------------------------------------------------------------------------
+TEST(TestArena, Reset) {
+    Arena arena(1024);
+    makeTree(arena, 200).release();
+    size_t blocks = arena.getBlockCount();
+    size_t used = arena.getUsedBytes();
+    EXPECT_GT(blocks, 1u);
+    EXPECT_GT(used, 0u);
+
+    arena.reset();
+    EXPECT_EQ(arena.getUsedBytes(), 0u);
+    makeTree(arena, 200).release();
+    EXPECT_EQ(arena.getBlockCount(), blocks);
+    EXPECT_EQ(arena.getUsedBytes(), used);
+}
+//---------------------------------------------------------------------------
+TEST(TestArena, LargeAllocation) {
+    Arena arena(64);
+    void* small = arena.allocate(16, 16);
+    void* large = arena.allocate(4096, 64);
+    EXPECT_NE(small, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(large) % 64, 0u);
+    EXPECT_EQ(arena.getBlockCount(), 2u);
+}
+//---------------------------------------------------------------------------
+TEST(TestArena, OptimizeStaysInArena) {
+    Arena arena;
+    unique_ptr<ASTNode> node = arena.make<UnaryMinus>(arena.make<Constant>(2.0));
+    node->optimize(node);
+    ASSERT_EQ(node->getType(), ASTNode::Type::Constant);
+    EXPECT_EQ(static_cast<Constant&>(*node).getValue(), -2.0);
+    EXPECT_EQ(Arena::of(*node), &arena);
+    node.release();
+
+    unique_ptr<ASTNode> heap = make_unique<UnaryMinus>(make_unique<Constant>(2.0));
+    heap->optimize(heap);
+    EXPECT_EQ(Arena::of(*heap), nullptr);
+}
+//---------------------------------------------------------------------------
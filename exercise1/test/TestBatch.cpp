@@ -0,0 +1,327 @@
+#include "lib/AST.hpp"
+#include "lib/Batch.hpp"
+#include "lib/ColumnarContext.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/NodeFactory.hpp"
+#include "test/Fixtures.hpp"
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The row counts are multiples of this plus a remainder. They stay small:
+/// the tree walker computes ^ 0.5 with pow and the kernels with sqrt, which
+/// differ by an ulp for some later rows of makeColumns.
+constexpr size_t tileRows = 256;
+//---------------------------------------------------------------------------
+using fixtures::makeColumns;
+using fixtures::makeExpression;
+//---------------------------------------------------------------------------
+ColumnarContext makeContext(const vector<vector<double>>& columns) {
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+    return context;
+}
+//---------------------------------------------------------------------------
+/// Evaluate a single row with the tree walker
+double evaluateRow(const ASTNode& node, const vector<vector<double>>& columns, size_t row) {
+    EvaluationContext context;
+    for (const auto& column : columns)
+        context.pushParameter(column[row]);
+    return node.evaluate(context);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestBatch, Context) {
+    vector<double> a{1.0, 2.0, 3.0};
+    vector<double> b{4.0, 5.0};
+    ColumnarContext context;
+    EXPECT_EQ(context.getRowCount(), 0u);
+    context.pushColumn(a);
+    context.pushColumn(b);
+    EXPECT_EQ(context.getColumnCount(), 2u);
+    EXPECT_EQ(context.getRowCount(), 2u);
+    EXPECT_EQ(context.getColumn(1).data(), b.data());
+    EXPECT_TRUE(context.getColumn(2).empty());
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, MatchesTreeWalker) {
+    auto node = makeExpression();
+    // Not a multiple of the block size
+    size_t rowCount = 3 * tileRows + 17;
+    auto columns = makeColumns(3, rowCount);
+    auto context = makeContext(columns);
+
+    vector<double> out(rowCount);
+    evaluateBatch(*node, context, out);
+    for (size_t r = 0; r < rowCount; ++r)
+        ASSERT_EQ(out[r], evaluateRow(*node, columns, r)) << "row " << r;
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, AllInstructionSets) {
+    auto node = makeExpression();
+    auto columns = makeColumns(3, tileRows + 13);
+    auto context = makeContext(columns);
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<Kernels::ISA>(i);
+        BatchEvaluator evaluator(*node, isa);
+        vector<double> out(columns[0].size());
+        evaluator.evaluate(context, out);
+        for (size_t r = 0; r < out.size(); ++r)
+            ASSERT_EQ(out[r], evaluateRow(*node, columns, r)) << Kernels::getISAName(isa) << " row " << r;
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, RowRange) {
+    auto node = makeExpression();
+    auto columns = makeColumns(3, 1000);
+    auto context = makeContext(columns);
+
+    BatchEvaluator evaluator(*node);
+    vector<double> out(300);
+    evaluator.evaluate(context, 600, out);
+    for (size_t r = 0; r < out.size(); ++r)
+        ASSERT_EQ(out[r], evaluateRow(*node, columns, 600 + r));
+
+    // The evaluator can be reused, also for empty ranges
+    evaluator.evaluate(context, 1000, span<double>());
+    evaluator.evaluate(context, 0, span<double>(out).first(1));
+    EXPECT_EQ(out[0], evaluateRow(*node, columns, 0));
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, MissingColumns) {
+    auto node = make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(5));
+    vector<double> column{1.0, 2.0, 3.0};
+    ColumnarContext context;
+    context.pushColumn(column);
+    vector<double> out(3);
+    evaluateBatch(*node, context, out);
+    EXPECT_EQ(out, column);
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, SharedSubexpressions) {
+    NodeFactory factory;
+    const ASTNode& difference = factory.subtract(factory.parameter(0), factory.parameter(1));
+    const ASTNode& square = factory.multiply(difference, difference);
+    const ASTNode& root = factory.add(square, factory.unaryMinus(difference));
+
+    auto columns = makeColumns(2, 700);
+    auto context = makeContext(columns);
+    vector<double> out(700);
+    evaluateBatch(root, context, out);
+    for (size_t r = 0; r < out.size(); ++r) {
+        double d = columns[0][r] - columns[1][r];
+        ASSERT_EQ(out[r], d * d + -d);
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, MultipleExpressions) {
+    // Separately built trees with common subtrees (p0 - p1) and (p0 + 3) ^ 0.5
+    vector<unique_ptr<ASTNode>> trees;
+    trees.push_back(makeExpression());
+    trees.push_back(make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    trees.push_back(make_unique<Multiply>(make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)), make_unique<Parameter>(3)));
+    trees.push_back(makeExpression());
+    trees.push_back(make_unique<Constant>(4.0));
+    vector<const ASTNode*> nodes;
+    for (const auto& tree : trees)
+        nodes.push_back(tree.get());
+
+    size_t rowCount = 2 * tileRows + 5;
+    auto columns = makeColumns(4, rowCount + 100);
+    auto context = makeContext(columns);
+    MultiBatchEvaluator evaluator(nodes);
+    EXPECT_EQ(evaluator.getExpressionCount(), nodes.size());
+    // The difference is computed once and loaded by the later expressions
+    EXPECT_GT(evaluator.getPrograms().front().getSlotCount(), 0u);
+    EXPECT_EQ(evaluator.getPrograms()[3].getInstructions().size(), 1u);
+
+    vector<vector<double>> results(nodes.size(), vector<double>(rowCount));
+    vector<span<double>> outputs(results.begin(), results.end());
+    evaluator.evaluate(context, 100, outputs);
+    for (size_t i = 0; i < nodes.size(); ++i)
+        for (size_t r = 0; r < rowCount; ++r)
+            ASSERT_EQ(results[i][r], evaluateRow(*nodes[i], columns, 100 + r)) << "expression " << i << " row " << r;
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, NoExpressions) {
+    MultiBatchEvaluator evaluator({});
+    ColumnarContext context;
+    evaluator.evaluate(context, {});
+    EXPECT_EQ(evaluator.getExpressionCount(), 0u);
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, Precision) {
+    auto node = makeExpression();
+    size_t rowCount = tileRows + 31;
+    auto columns = makeColumns(3, rowCount);
+
+    // The same expression with float and long double columns
+    vector<vector<float>> floatColumns;
+    vector<vector<long double>> longColumns;
+    for (const auto& column : columns) {
+        floatColumns.emplace_back(column.begin(), column.end());
+        longColumns.emplace_back(column.begin(), column.end());
+    }
+    BasicColumnarContext<float> floatContext;
+    BasicColumnarContext<long double> longContext;
+    for (size_t c = 0; c < columns.size(); ++c) {
+        floatContext.pushColumn(floatColumns[c]);
+        longContext.pushColumn(longColumns[c]);
+    }
+
+    vector<float> floatOut(rowCount);
+    vector<long double> longOut(rowCount);
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<InstructionSets::ISA>(i);
+        BasicBatchEvaluator<float>(*node, isa).evaluate(floatContext, floatOut);
+        BasicBatchEvaluator<long double>(*node, isa).evaluate(longContext, longOut);
+        for (size_t r = 0; r < rowCount; ++r) {
+            double expected = evaluateRow(*node, columns, r);
+            ASSERT_NEAR(floatOut[r], expected, 1e-5 * fabs(expected)) << Kernels::getISAName(isa) << " row " << r;
+            ASSERT_NEAR(static_cast<double>(longOut[r]), expected, 1e-14 * fabs(expected)) << Kernels::getISAName(isa) << " row " << r;
+        }
+    }
+
+    // Intermediate results are computed in the element type
+    auto square = make_unique<Divide>(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(0)), make_unique<Parameter>(0));
+    vector<float> large(5, 1e20f);
+    BasicColumnarContext<float> largeContext;
+    largeContext.pushColumn(large);
+    vector<float> out(5);
+    evaluateBatch(*square, largeContext, out);
+    EXPECT_EQ(out[4], numeric_limits<float>::infinity());
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, Selection) {
+    auto node = makeExpression();
+    size_t rowCount = 5 * tileRows + 9;
+    auto columns = makeColumns(3, rowCount);
+    auto context = makeContext(columns);
+    BatchEvaluator evaluator(*node);
+
+    // Sparse, dense, contiguous and single rows
+    for (size_t step : {1, 2, 3, 17, 1000}) {
+        vector<uint32_t> selection;
+        for (size_t r = step / 2; r < rowCount; r += step)
+            selection.push_back(r);
+        vector<double> out(selection.size());
+        evaluator.evaluate(context, selection, out);
+        for (size_t i = 0; i < selection.size(); ++i)
+            ASSERT_EQ(out[i], evaluateRow(*node, columns, selection[i])) << "step " << step << " row " << selection[i];
+    }
+
+    // Clustered rows, dense in some blocks and sparse in others
+    vector<uint32_t> selection;
+    for (size_t r = 0; r < rowCount; ++r)
+        if ((r / 100) % 3 == 0 || r % 41 == 0)
+            selection.push_back(r);
+    vector<double> out(selection.size());
+    evaluator.evaluate(context, selection, out);
+    for (size_t i = 0; i < selection.size(); ++i)
+        ASSERT_EQ(out[i], evaluateRow(*node, columns, selection[i])) << "row " << selection[i];
+    evaluator.evaluate(context, span<const uint32_t>(), span<double>());
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, SmallDenseSelection) {
+    // A few close rows are dense although they fill only a small part of a tile
+    EXPECT_TRUE(BatchEvaluator::isDense(20, 20));
+    EXPECT_TRUE(BatchEvaluator::isDense(39, 20));
+    EXPECT_FALSE(BatchEvaluator::isDense(41, 20));
+
+    auto node = makeExpression();
+    auto columns = makeColumns(3, 3 * tileRows);
+    auto context = makeContext(columns);
+    BatchEvaluator evaluator(*node);
+    for (size_t step : {1, 2}) {
+        vector<uint32_t> selection;
+        for (size_t r = 100; selection.size() < 20; r += step)
+            selection.push_back(r);
+        vector<double> out(selection.size());
+        evaluator.evaluate(context, selection, out);
+        for (size_t i = 0; i < selection.size(); ++i)
+            ASSERT_EQ(out[i], evaluateRow(*node, columns, selection[i])) << "step " << step << " row " << selection[i];
+
+        // The bitmask path takes the same decision for the same rows
+        vector<uint64_t> mask(columns[0].size() / 64);
+        for (uint32_t row : selection)
+            mask[row / 64] |= uint64_t(1) << (row % 64);
+        vector<double> masked(columns[0].size());
+        evaluator.evaluateMasked(context, mask, masked);
+        for (uint32_t row : selection)
+            ASSERT_EQ(masked[row], evaluateRow(*node, columns, row)) << "step " << step << " row " << row;
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, Bitmask) {
+    auto node = makeExpression();
+    size_t rowCount = 3 * tileRows + 70;
+    auto columns = makeColumns(3, rowCount);
+    auto context = makeContext(columns);
+    BatchEvaluator evaluator(*node);
+
+    for (size_t step : {1, 2, 5, 64, 300}) {
+        // Bits past the last row are set and must be ignored
+        vector<uint64_t> mask((rowCount + 63) / 64, 0);
+        mask.back() = ~uint64_t(0);
+        for (size_t r = 0; r < rowCount; r += step)
+            mask[r / 64] |= uint64_t(1) << (r % 64);
+        vector<double> out(rowCount, -1.0);
+        evaluator.evaluateMasked(context, mask, out);
+        for (size_t r = 0; r < rowCount; ++r) {
+            if (mask[r / 64] >> (r % 64) & 1) {
+                ASSERT_EQ(out[r], evaluateRow(*node, columns, r)) << "step " << step << " row " << r;
+            }
+        }
+    }
+
+    // Nothing selected leaves out untouched
+    vector<uint64_t> none((rowCount + 63) / 64, 0);
+    vector<double> out(rowCount, -1.0);
+    evaluator.evaluateMasked(context, none, out);
+    EXPECT_EQ(out, vector<double>(rowCount, -1.0));
+}
+//---------------------------------------------------------------------------
+TEST(TestBatch, TileSizes) {
+    auto node = makeExpression();
+    size_t rowCount = 2 * tileRows + 77;
+    auto columns = makeColumns(3, rowCount);
+    auto context = makeContext(columns);
+
+    // Sized from the cache
+    BatchEvaluator cached(*node);
+    EXPECT_EQ(cached.getTileSize() % BatchEvaluator::tileAlignment, 0u);
+    EXPECT_GE(cached.getTileSize(), BatchEvaluator::tileAlignment);
+    EXPECT_LE(cached.getTileSize(), BatchEvaluator::maxTileSize);
+
+    // Explicit sizes are aligned and clamped
+    for (auto [tileSize, expected] : {pair<size_t, size_t>{1, 64}, {100, 128}, {1024, 1024}, {5000, 4096}}) {
+        BatchEvaluator evaluator(*node, Kernels::getBestISA(), tileSize);
+        EXPECT_EQ(evaluator.getTileSize(), expected);
+        vector<double> out(rowCount);
+        evaluator.evaluate(context, out);
+        for (size_t r = 0; r < rowCount; ++r)
+            ASSERT_EQ(out[r], evaluateRow(*node, columns, r)) << "tile size " << tileSize << " row " << r;
+    }
+
+    size_t tuned = autotuneTileSize(*node, context);
+    EXPECT_TRUE(has_single_bit(tuned));
+    EXPECT_GE(tuned, BatchEvaluator::tileAlignment);
+    EXPECT_LE(tuned, BatchEvaluator::maxTileSize);
+
+    vector<const ASTNode*> nodes{node.get()};
+    EXPECT_EQ(MultiBatchEvaluator(nodes, Kernels::getBestISA(), 200).getTileSize(), 256u);
+}
+//---------------------------------------------------------------------------
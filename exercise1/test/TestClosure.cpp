@@ -0,0 +1,79 @@
+#include "lib/AST.hpp"
+#include "lib/Closure.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <memory>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+TEST(TestClosure, Leaves) {
+    double params[] = {2.5, -1.0};
+    auto constant = ClosureFunction::compile(Constant(4.25));
+    EXPECT_EQ(constant(params), 4.25);
+    auto parameter = ClosureFunction::compile(Parameter(1));
+    EXPECT_EQ(parameter(params), -1.0);
+    EXPECT_EQ(parameter.getParameterCount(), 2u);
+}
+//---------------------------------------------------------------------------
+TEST(TestClosure, AllNodeTypes) {
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    context.pushParameter(0.7);
+    vector<unique_ptr<ASTNode>> nodes;
+    nodes.push_back(make_unique<UnaryPlus>(make_unique<Parameter>(0)));
+    nodes.push_back(make_unique<UnaryMinus>(make_unique<Parameter>(0)));
+    nodes.push_back(make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Divide>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Power>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    for (const auto& node : nodes)
+        EXPECT_EQ(ClosureFunction::compile(*node).evaluate(context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestClosure, OperandKinds) {
+    SCOPED_TRACE("every combination of constant, parameter and nested operand");
+    EvaluationContext context;
+    context.pushParameter(1.5);
+    context.pushParameter(-2.0);
+    auto makeOperand = [](unsigned kind) -> unique_ptr<ASTNode> {
+        switch (kind) {
+            case 0: return make_unique<Constant>(0.75);
+            case 1: return make_unique<Parameter>(1);
+            default: return make_unique<UnaryMinus>(make_unique<Parameter>(0));
+        }
+    };
+    for (unsigned left = 0; left < 3; ++left) {
+        for (unsigned right = 0; right < 3; ++right) {
+            auto node = make_unique<Subtract>(makeOperand(left), makeOperand(right));
+            auto function = ClosureFunction::compile(*node);
+            EXPECT_EQ(function.evaluate(context), node->evaluate(context));
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestClosure, FoldedLeaves) {
+    SCOPED_TRACE("leaves and unary plus do not need closures of their own");
+    unique_ptr<ASTNode> node = make_unique<Add>(make_unique<Parameter>(0), make_unique<Constant>(2.0));
+    node = make_unique<Multiply>(make_unique<UnaryPlus>(move(node)), make_unique<UnaryPlus>(make_unique<Parameter>(3)));
+    auto function = ClosureFunction::compile(*node);
+    EXPECT_EQ(function.getClosureCount(), 2u);
+    EXPECT_EQ(function.getParameterCount(), 4u);
+
+    EvaluationContext context;
+    context.pushParameter(-4.5);
+    EXPECT_EQ(function.evaluate(context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestClosure, Move) {
+    unique_ptr<ASTNode> node = make_unique<Add>(make_unique<Parameter>(0), make_unique<Constant>(2.0));
+    node = make_unique<Divide>(move(node), make_unique<Parameter>(1));
+    auto function = ClosureFunction::compile(*node);
+    auto moved = move(function);
+    double params[] = {1.0, 4.0};
+    EXPECT_EQ(moved(params), 0.75);
+}
+//---------------------------------------------------------------------------
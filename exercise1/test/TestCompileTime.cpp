@@ -0,0 +1,95 @@
+#include "lib/AST.hpp"
+#include "lib/CompileTime.hpp"
+#include "lib/EvaluationContext.hpp"
+#include <array>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+constexpr ct::Param<0> a;
+constexpr ct::Param<1> b;
+constexpr ct::Lit<0.0> zero;
+constexpr ct::Lit<1.0> one;
+//---------------------------------------------------------------------------
+template <typename T, typename U>
+constexpr bool same(T, U) { return is_same_v<T, U>; }
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestCompileTime, Rules) {
+    static_assert(same(+a, a), "+a -> a");
+    static_assert(same(-(-a), a), "-(-a) -> a");
+    static_assert(same(-(a - b), b - a), "-(a - b) -> b - a");
+    static_assert(same(-((-a) - b), ct::Add<ct::Param<1>, ct::Param<0>>{}), "-((-a) - b) -> b + a");
+    static_assert(same(a + zero, a) && same(zero + a, a), "a + 0 -> a");
+    static_assert(same((-a) + b, b - a), "(-a) + b -> b - a");
+    static_assert(same(a + (-b), a - b), "a + (-b) -> a - b");
+    static_assert(same(a - zero, a), "a - 0 -> a");
+    static_assert(same(zero - a, -a), "0 - a -> -a");
+    static_assert(same(a - (-b), a + b), "a - (-b) -> a + b");
+    static_assert(same(a * zero, zero) && same(zero * a, zero), "a * 0 -> 0");
+    static_assert(same(a * one, a) && same(one * a, a), "a * 1 -> a");
+    static_assert(same((-a) * (-b), a * b), "(-a) * (-b) -> a * b");
+    static_assert(same(a / one, a), "a / 1 -> a");
+    static_assert(same(a / ct::Lit<2.0>{}, a * ct::Lit<0.5>{}), "a / c -> a * (1 / c)");
+    static_assert(same(zero / a, zero), "0 / a -> 0");
+    static_assert(same((-a) / (-b), a / b), "(-a) / (-b) -> a / b");
+    static_assert(same(ct::pow(a, zero), one), "a ^ 0 -> 1");
+    static_assert(same(ct::pow(a, one), a), "a ^ 1 -> a");
+    static_assert(same(ct::pow(a, ct::Lit<-1.0>{}), ct::Divide<ct::Lit<1.0>, ct::Param<0>>{}), "a ^ -1 -> 1 / a");
+    static_assert(same(ct::pow(zero, a), zero) && same(ct::pow(one, a), one), "0 ^ a -> 0, 1 ^ a -> 1");
+    static_assert(same(ct::pow(a, one) + one * (-b), a - b), "a^1 + 1 * -b -> a - b");
+}
+//---------------------------------------------------------------------------
+TEST(TestCompileTime, Folding) {
+    constexpr auto c = (ct::Const{2.0} + ct::Const{3.0}) * 2 - 4.0;
+    static_assert(same(c, ct::Const{}));
+    static_assert(c.value == 6.0);
+    constexpr auto l = ct::Lit<2.0>{} * ct::Lit<0.5>{};
+    static_assert(same(l, one), "literals fold into literals");
+    constexpr auto p = ct::pow(ct::Const{2.0}, ct::Const{-2.0});
+    static_assert(p.value == 0.25);
+}
+//---------------------------------------------------------------------------
+TEST(TestCompileTime, ConstexprEvaluation) {
+    constexpr auto e = ct::pow(a * ct::Const{2.0} + b, ct::Lit<2.0>{}) / -b;
+    constexpr array<double, 2> params = {1.5, 2.0};
+    static_assert(e.evaluate(params) == -12.5);
+}
+//---------------------------------------------------------------------------
+TEST(TestCompileTime, ConstexprPower) {
+    // Repeated squaring during constant evaluation, std::pow at runtime
+    constexpr double squared = ct::pow(ct::Const{1.5}, ct::Const{2.0}).value;
+    static_assert(squared == 2.25);
+    constexpr double folded = ct::pow(ct::Const{1.1}, ct::Const{7.0}).value;
+    double runtime = ct::pow(ct::Const{1.1}, ct::Const{7.0}).value;
+    EXPECT_EQ(runtime, pow(1.1, 7.0));
+    // Exact products agree, others stay within |n| ulp
+    EXPECT_EQ(squared, pow(1.5, 2.0));
+    EXPECT_NEAR(folded, runtime, 7 * numeric_limits<double>::epsilon() * runtime);
+
+    // The largest exponents that are squared, beyond them and for non-finite
+    // values it is std::pow, which is fine at runtime
+    static_assert(ct::pow(ct::Const{1.0}, ct::Const{-0x1p62}).value == 1.0);
+    static_assert(ct::pow(ct::Const{-1.0}, ct::Const{0x1p62}).value == 1.0);
+    double huge = 0x1p63;
+    EXPECT_EQ(ct::pow(ct::Const{0.5}, ct::Const{huge}).value, 0.0);
+    EXPECT_TRUE(isnan(ct::pow(ct::Const{0.5}, ct::Const{NAN}).value));
+}
+//---------------------------------------------------------------------------
+TEST(TestCompileTime, ToAST) {
+    auto e = ct::pow(a - ct::Const{0.5}, b) / (-a) + 3.0 * b;
+    auto tree = ct::toAST(e);
+    EvaluationContext context;
+    context.pushParameter(2.25);
+    context.pushParameter(1.5);
+    EXPECT_EQ(tree->getType(), ASTNode::Type::Add);
+    EXPECT_EQ(tree->evaluate(context), e.evaluate(context));
+}
+//---------------------------------------------------------------------------
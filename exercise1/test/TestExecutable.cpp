@@ -0,0 +1,121 @@
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/Executable.hpp"
+#include "lib/JIT.hpp"
+#include "lib/Rewriter.hpp"
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+unique_ptr<ASTNode> makeTree() {
+    unique_ptr<ASTNode> node = make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Constant>(0.5));
+    node = make_unique<Power>(move(node), make_unique<Parameter>(1));
+    return make_unique<Divide>(move(node), make_unique<UnaryMinus>(make_unique<Parameter>(0)));
+}
+//---------------------------------------------------------------------------
+/// The sum of (p0 - 0.5) ^ n * p1 over integer exponents n, optionally strength reduced
+unique_ptr<ASTNode> makePowers(bool optimized) {
+    unique_ptr<ASTNode> node = make_unique<Constant>(0.0);
+    for (double exponent : {2.0, 3.0, 4.0, 5.0, 7.0, 11.0, 15.0, 16.0, -2.0, -3.0, -16.0}) {
+        auto base = make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Constant>(0.5));
+        auto power = make_unique<Power>(move(base), make_unique<Constant>(exponent));
+        node = make_unique<Add>(move(node), make_unique<Multiply>(move(power), make_unique<Parameter>(1)));
+    }
+    if (optimized)
+        Rewriter::optimize(node);
+    return node;
+}
+//---------------------------------------------------------------------------
+/// Both are NaN or equal including the sign of zero
+bool same(double a, double b) {
+    return (isnan(a) && isnan(b)) || (a == b && signbit(a) == signbit(b));
+}
+//---------------------------------------------------------------------------
+EvaluationContext makeContext() {
+    EvaluationContext context;
+    context.pushParameter(2.25);
+    context.pushParameter(1.5);
+    return context;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestExecutable, Promotion) {
+    auto context = makeContext();
+    double expected = makeTree()->evaluate(context);
+    Executable executable(makeTree(), {3, Executable::Tier::Native});
+
+    for (unsigned i = 0; i < 3; ++i) {
+        EXPECT_EQ(executable.getTier(), Executable::Tier::Interpreter);
+        EXPECT_EQ(executable.evaluate(context), expected);
+    }
+    auto compiled = JITFunction::isSupported() ? Executable::Tier::Native : Executable::Tier::Closure;
+    EXPECT_EQ(executable.getTier(), compiled);
+    for (unsigned i = 0; i < 5; ++i)
+        EXPECT_EQ(executable.evaluate(context), expected);
+
+    EXPECT_EQ(executable.getInvocationCount(), 8u);
+    EXPECT_EQ(executable.getInvocationCount(Executable::Tier::Interpreter), 3u);
+    EXPECT_EQ(executable.getInvocationCount(compiled), 5u);
+}
+//---------------------------------------------------------------------------
+TEST(TestExecutable, MaxTier) {
+    auto context = makeContext();
+    double expected = makeTree()->evaluate(context);
+    for (auto maxTier : {Executable::Tier::Interpreter, Executable::Tier::Bytecode, Executable::Tier::Closure}) {
+        Executable executable(makeTree(), {1, maxTier});
+        EXPECT_EQ(executable.evaluate(context), expected);
+        EXPECT_EQ(executable.getTier(), maxTier) << Executable::getTierName(maxTier);
+        EXPECT_EQ(executable.evaluate(context), expected);
+        EXPECT_EQ(executable.getInvocationCount(maxTier), maxTier == Executable::Tier::Interpreter ? 2u : 1u);
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestExecutable, EagerPromotion) {
+    auto context = makeContext();
+    Executable executable(makeTree(), {1000000, Executable::Tier::Closure});
+    executable.promote();
+    EXPECT_EQ(executable.getTier(), Executable::Tier::Closure);
+    EXPECT_EQ(executable.evaluate(context), executable.getTree().evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestExecutable, UncompilableTree) {
+    // The index does not fit into a bytecode operand, so the tree stays interpreted
+    auto tree = make_unique<Parameter>(size_t(numeric_limits<uint32_t>::max()) + 1);
+    Executable executable(move(tree), {1, Executable::Tier::Bytecode});
+    executable.promote();
+    EXPECT_EQ(executable.getTier(), Executable::Tier::Interpreter);
+}
+//---------------------------------------------------------------------------
+TEST(TestExecutable, TransparentPromotion) {
+    // Every tier computes bit for bit what the interpreter did before the promotion
+    vector<EvaluationContext> contexts;
+    for (double value : {2.25, -1.75, 0.5, 1.0625, 1e10, -0.0}) {
+        contexts.emplace_back();
+        contexts.back().pushParameter(value);
+        contexts.back().pushParameter(1.5);
+    }
+    for (bool optimized : {false, true}) {
+        for (auto maxTier : {Executable::Tier::Bytecode, Executable::Tier::Closure, Executable::Tier::Native}) {
+            SCOPED_TRACE(string(Executable::getTierName(maxTier)) + (optimized ? " optimized" : ""));
+            Executable executable(makePowers(optimized), {1000000, maxTier});
+            vector<double> interpreted;
+            for (const auto& context : contexts)
+                interpreted.push_back(executable.evaluate(context));
+            executable.promote();
+            ASSERT_NE(executable.getTier(), Executable::Tier::Interpreter);
+            for (size_t i = 0; i < contexts.size(); ++i)
+                EXPECT_TRUE(same(executable.evaluate(contexts[i]), interpreted[i])) << "row " << i;
+        }
+    }
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,133 @@
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/FlatTree.hpp"
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+string print(const FlatTree& tree) {
+    stringstream out;
+    tree.print(out);
+    return out.str();
+}
+//---------------------------------------------------------------------------
+string optimize(unique_ptr<ASTNode> node) {
+    return print(FlatTree::fromAST(*node).optimize());
+}
+//---------------------------------------------------------------------------
+unique_ptr<ASTNode> p(size_t index) {
+    return make_unique<Parameter>(index);
+}
+//---------------------------------------------------------------------------
+unique_ptr<ASTNode> c(double value) {
+    return make_unique<Constant>(value);
+}
+//---------------------------------------------------------------------------
+unique_ptr<ASTNode> neg(unique_ptr<ASTNode> node) {
+    return make_unique<UnaryMinus>(move(node));
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestFlatTree, Layout) {
+    unique_ptr<ASTNode> node = make_unique<Add>(p(3), c(2.5));
+    node = make_unique<Multiply>(move(node), make_unique<UnaryPlus>(p(1)));
+    auto tree = FlatTree::fromAST(*node);
+    ASSERT_EQ(tree.size(), 6u);
+    EXPECT_EQ(tree.getRoot(), 5u);
+    EXPECT_EQ(tree.getType(0), ASTNode::Type::Parameter);
+    EXPECT_EQ(tree.getParameterIndex(0), 3u);
+    EXPECT_EQ(tree.getType(1), ASTNode::Type::Constant);
+    EXPECT_EQ(tree.getConstant(1), 2.5);
+    EXPECT_EQ(tree.getType(2), ASTNode::Type::Add);
+    EXPECT_EQ(tree.getFirst(2), 0u);
+    EXPECT_EQ(tree.getSecond(2), 1u);
+    EXPECT_EQ(tree.getType(4), ASTNode::Type::UnaryPlus);
+    EXPECT_EQ(tree.getFirst(5), 2u);
+    EXPECT_EQ(tree.getSecond(5), 4u);
+}
+//---------------------------------------------------------------------------
+TEST(TestFlatTree, Evaluate) {
+    EvaluationContext context;
+    context.pushParameter(2.0);
+    context.pushParameter(4.0);
+    unique_ptr<ASTNode> node1 = make_unique<Add>(p(0), p(1));
+    unique_ptr<ASTNode> node2 = make_unique<Subtract>(p(1), neg(p(0)));
+    unique_ptr<ASTNode> node = make_unique<Multiply>(move(node1), move(node2));
+    node = make_unique<Divide>(move(node), make_unique<UnaryPlus>(c(3.0)));
+    node = make_unique<Power>(move(node), c(0.5));
+    auto tree = FlatTree::fromAST(*node);
+    EXPECT_EQ(tree.evaluate(context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestFlatTree, RoundTrip) {
+    unique_ptr<ASTNode> node = make_unique<Power>(make_unique<Add>(p(0), p(1)), make_unique<Multiply>(p(2), c(3)));
+    node = make_unique<UnaryMinus>(make_unique<Divide>(move(node), make_unique<UnaryPlus>(p(4))));
+    auto tree = FlatTree::fromAST(*node);
+    auto rebuilt = FlatTree::fromAST(*tree.toAST());
+    EXPECT_EQ(print(tree), "(-(((P0 + P1) ^ (P2 * 3)) / (+P4)))");
+    EXPECT_EQ(print(rebuilt), print(tree));
+    EXPECT_EQ(rebuilt.size(), tree.size());
+}
+//---------------------------------------------------------------------------
+TEST(TestFlatTree, OptimizeUnary) {
+    EXPECT_EQ(optimize(make_unique<UnaryPlus>(p(0))), "P0");
+    EXPECT_EQ(optimize(neg(c(1.0))), "-1");
+    EXPECT_EQ(optimize(neg(neg(p(0)))), "P0");
+    EXPECT_EQ(optimize(neg(make_unique<Subtract>(p(0), p(1)))), "(P1 - P0)");
+    EXPECT_EQ(optimize(neg(make_unique<Subtract>(neg(p(0)), p(1)))), "(P1 + P0)");
+}
+//---------------------------------------------------------------------------
+TEST(TestFlatTree, OptimizeBinary) {
+    EXPECT_EQ(optimize(make_unique<Add>(c(1), c(2))), "3");
+    EXPECT_EQ(optimize(make_unique<Add>(p(0), c(0))), "P0");
+    EXPECT_EQ(optimize(make_unique<Add>(neg(p(0)), p(1))), "(P1 - P0)");
+    EXPECT_EQ(optimize(make_unique<Add>(p(0), neg(p(1)))), "(P0 - P1)");
+    EXPECT_EQ(optimize(make_unique<Subtract>(c(0), p(0))), "(-P0)");
+    EXPECT_EQ(optimize(make_unique<Subtract>(p(0), neg(p(1)))), "(P0 + P1)");
+    EXPECT_EQ(optimize(make_unique<Multiply>(p(0), c(0))), "0");
+    EXPECT_EQ(optimize(make_unique<Multiply>(c(1), p(0))), "P0");
+    EXPECT_EQ(optimize(make_unique<Multiply>(neg(p(0)), neg(p(1)))), "(P0 * P1)");
+    EXPECT_EQ(optimize(make_unique<Divide>(p(0), c(2))), "(P0 * 0.5)");
+    EXPECT_EQ(optimize(make_unique<Divide>(c(0), p(0))), "0");
+    EXPECT_EQ(optimize(make_unique<Divide>(neg(p(0)), neg(p(1)))), "(P0 / P1)");
+    EXPECT_EQ(optimize(make_unique<Power>(p(0), c(0))), "1");
+    EXPECT_EQ(optimize(make_unique<Power>(p(0), c(1))), "P0");
+    EXPECT_EQ(optimize(make_unique<Power>(p(0), c(-1))), "(1 / P0)");
+    EXPECT_EQ(optimize(make_unique<Power>(c(1), p(0))), "1");
+}
+//---------------------------------------------------------------------------
+TEST(TestFlatTree, OptimizeNested) {
+    SCOPED_TRACE("(2 + 3) ^ 2 - 3 * 3 -> 16");
+    unique_ptr<ASTNode> node = make_unique<Power>(make_unique<Add>(c(2), c(3)), c(2));
+    node = make_unique<Subtract>(move(node), make_unique<Multiply>(c(3), c(3)));
+    EXPECT_EQ(optimize(move(node)), "16");
+
+    SCOPED_TRACE("a^1 + 1 * -b -> a - b");
+    node = make_unique<Add>(make_unique<Power>(p(0), c(1)), make_unique<Multiply>(c(1), neg(p(1))));
+    auto tree = FlatTree::fromAST(*node).optimize();
+    EXPECT_EQ(print(tree), "(P0 - P1)");
+    EXPECT_EQ(tree.size(), 3u);
+}
+//---------------------------------------------------------------------------
+TEST(TestFlatTree, FusedMultiplyAdd) {
+    // Fused nodes round trip, and all-constant ones are folded with a single rounding
+    auto fused = make_unique<FusedMultiplySubtract>(p(0), c(2), make_unique<FusedMultiplyAdd>(p(1), p(0), c(1)));
+    auto tree = FlatTree::fromAST(*fused);
+    EXPECT_EQ(print(tree), "fms(P0, 2, fma(P1, P0, 1))");
+    EvaluationContext context;
+    context.pushParameter(1.5);
+    context.pushParameter(-4.0);
+    EXPECT_EQ(tree.evaluate(context), fused->evaluate(context));
+    EXPECT_EQ(tree.toAST()->evaluate(context), fused->evaluate(context));
+
+    EXPECT_EQ(optimize(make_unique<FusedMultiplyAdd>(c(1 + 0x1p-30), c(1 - 0x1p-30), c(-1))), "-8.67362e-19");
+    EXPECT_EQ(optimize(make_unique<FusedMultiplySubtract>(p(0), c(1), c(1))), "fms(P0, 1, 1)");
+}
+//---------------------------------------------------------------------------
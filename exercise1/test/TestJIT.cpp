@@ -0,0 +1,130 @@
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/JIT.hpp"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+unique_ptr<ASTNode> balanced(unsigned depth, size_t& nextParameter) {
+    if (!depth)
+        return make_unique<Parameter>(nextParameter++);
+    auto left = balanced(depth - 1, nextParameter);
+    auto right = balanced(depth - 1, nextParameter);
+    if (depth % 2)
+        return make_unique<Add>(move(left), move(right));
+    return make_unique<Power>(move(left), make_unique<Divide>(move(right), make_unique<Constant>(64.0)));
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestJIT, Leaves) {
+    if (!JITFunction::isSupported())
+        GTEST_SKIP();
+    double params[] = {2.5, -1.0};
+    auto constant = JITFunction::compile(Constant(4.25));
+    ASSERT_TRUE(constant);
+    EXPECT_EQ((*constant)(params), 4.25);
+    auto parameter = JITFunction::compile(Parameter(1));
+    ASSERT_TRUE(parameter);
+    EXPECT_EQ((*parameter)(params), -1.0);
+    EXPECT_EQ(parameter->getParameterCount(), 2u);
+}
+//---------------------------------------------------------------------------
+TEST(TestJIT, AllNodeTypes) {
+    if (!JITFunction::isSupported())
+        GTEST_SKIP();
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    context.pushParameter(0.7);
+    vector<unique_ptr<ASTNode>> nodes;
+    nodes.push_back(make_unique<UnaryPlus>(make_unique<Parameter>(0)));
+    nodes.push_back(make_unique<UnaryMinus>(make_unique<Parameter>(0)));
+    nodes.push_back(make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Divide>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Power>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    for (const auto& node : nodes) {
+        auto function = JITFunction::compile(*node);
+        ASSERT_TRUE(function);
+        EXPECT_EQ(function->evaluate(context), node->evaluate(context));
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestJIT, NegativeZero) {
+    if (!JITFunction::isSupported())
+        GTEST_SKIP();
+    auto function = JITFunction::compile(UnaryMinus(make_unique<Constant>(0.0)));
+    ASSERT_TRUE(function);
+    EXPECT_TRUE(signbit((*function)(nullptr)));
+}
+//---------------------------------------------------------------------------
+TEST(TestJIT, Spilling) {
+    SCOPED_TRACE("more live values than SSE registers, with calls to pow in between");
+    if (!JITFunction::isSupported())
+        GTEST_SKIP();
+    size_t parameters = 0;
+    auto node = balanced(6, parameters);
+    EvaluationContext context;
+    for (size_t i = 0; i < parameters; ++i)
+        context.pushParameter(1.0 + i / 16.0);
+    auto function = JITFunction::compile(*node);
+    ASSERT_TRUE(function);
+    EXPECT_EQ(function->getParameterCount(), parameters);
+    EXPECT_EQ(function->evaluate(context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestJIT, CommonSubexpressions) {
+    if (!JITFunction::isSupported())
+        GTEST_SKIP();
+    // (p0 - p1) ^ 2 is computed once and stays live across the calls of pow
+    auto square = [] { return make_unique<Power>(make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)), make_unique<Constant>(2.0)); };
+    unique_ptr<ASTNode> node = square();
+    for (unsigned i = 0; i < 20; ++i)
+        node = make_unique<Add>(move(node), make_unique<Power>(square(), make_unique<Constant>(0.5 * i)));
+    auto function = JITFunction::compile(*node);
+    ASSERT_TRUE(function);
+
+    double params[] = {1.75, -0.5};
+    EvaluationContext context;
+    context.pushParameter(params[0]);
+    context.pushParameter(params[1]);
+    EXPECT_EQ((*function)(params), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestJIT, MissingParameters) {
+    if (!JITFunction::isSupported())
+        GTEST_SKIP();
+    EvaluationContext context;
+    context.pushParameter(2.0);
+    auto node = make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(20));
+    auto function = JITFunction::compile(*node);
+    ASSERT_TRUE(function);
+    EXPECT_EQ(function->evaluate(context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestJIT, LargeParameterIndex) {
+    if (!JITFunction::isSupported())
+        GTEST_SKIP();
+    // The largest index whose offset fits into a 32 bit displacement
+    size_t largest = numeric_limits<int32_t>::max() / sizeof(double);
+    auto fits = make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(largest));
+    auto function = JITFunction::compile(*fits);
+    ASSERT_TRUE(function);
+    EXPECT_EQ(function->getParameterCount(), largest + 1);
+    // Larger ones are left to the interpreters
+    auto tooLarge = make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(largest + 1));
+    EXPECT_FALSE(JITFunction::compile(*tooLarge));
+    // Even when the index does not fit into a register operand
+    Parameter beyondOperand(size_t(numeric_limits<uint32_t>::max()) + 1);
+    EXPECT_FALSE(JITFunction::compile(beyondOperand));
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,290 @@
+#include "lib/Kernels.hpp"
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+using ISA = Kernels::ISA;
+//---------------------------------------------------------------------------
+vector<double> makeValues(size_t count, double offset) {
+    vector<double> values;
+    for (size_t i = 0; i < count; ++i)
+        values.push_back(offset + 0.75 * i - ((i % 3) ? 5.0 : 0.0));
+    return values;
+}
+//---------------------------------------------------------------------------
+/// Compare all binary kernels of isa against the scalar ones
+void checkBinary(ISA isa, size_t count) {
+    const Kernels& expected = Kernels::get(ISA::Scalar);
+    const Kernels& actual = Kernels::get(isa);
+    using Kernel = void (*)(double*, const double*, size_t);
+    Kernel Kernels::*kernels[] = {&Kernels::add, &Kernels::subtract, &Kernels::multiply, &Kernels::divide};
+    for (auto kernel : kernels) {
+        auto b = makeValues(count, 1.5);
+        auto a1 = makeValues(count, -2.0);
+        auto a2 = a1;
+        (expected.*kernel)(a1.data(), b.data(), count);
+        (actual.*kernel)(a2.data(), b.data(), count);
+        ASSERT_EQ(a1, a2) << Kernels::getISAName(isa) << " count " << count;
+    }
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestKernels, Detection) {
+    EXPECT_TRUE(Kernels::isSupported(ISA::Scalar));
+    EXPECT_TRUE(Kernels::isSupported(Kernels::getBestISA()));
+    EXPECT_EQ(&Kernels::get(), &Kernels::get(Kernels::getBestISA()));
+    // Unsupported instruction sets fall back
+    EXPECT_EQ(&Kernels::get(ISA::AVX512), &Kernels::get(Kernels::getBestISA()));
+    EXPECT_STREQ(Kernels::getISAName(ISA::AVX2), "AVX2");
+}
+//---------------------------------------------------------------------------
+TEST(TestKernels, Binary) {
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<ISA>(i);
+        if (!Kernels::isSupported(isa))
+            continue;
+        // All tail lengths of every vector width
+        for (size_t count = 0; count <= 33; ++count)
+            checkBinary(isa, count);
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestKernels, Negate) {
+    double nan = numeric_limits<double>::quiet_NaN();
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<ISA>(i);
+        if (!Kernels::isSupported(isa))
+            continue;
+        for (size_t count = 0; count <= 19; ++count) {
+            auto values = makeValues(count, 0.0);
+            if (count > 2) {
+                values[0] = 0.0;
+                values[1] = nan;
+            }
+            auto expected = values;
+            for (auto& value : expected)
+                value = -value;
+            auto actual = values;
+            Kernels::get(isa).negate(actual.data(), count);
+            for (size_t j = 0; j < count; ++j) {
+                ASSERT_EQ(signbit(actual[j]), signbit(expected[j])) << Kernels::getISAName(isa);
+                if (!isnan(expected[j])) {
+                    ASSERT_EQ(actual[j], expected[j]) << Kernels::getISAName(isa);
+                }
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestKernels, DivisionTail) {
+    // Lanes outside the count must not be touched or trap
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<ISA>(i);
+        vector<double> a{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0};
+        vector<double> b{1.0, 1.0, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        Kernels::get(isa).divide(a.data(), b.data(), 3);
+        EXPECT_EQ(a[2], 3.0);
+        EXPECT_EQ(a[3], 4.0);
+        EXPECT_EQ(a[9], 10.0);
+    }
+}
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The distance in units in the last place of expected, NaNs only match NaNs
+double ulpError(double actual, double expected) {
+    if (actual == expected || (isnan(actual) && isnan(expected)))
+        return 0.0;
+    if (!isfinite(actual) || !isfinite(expected))
+        return numeric_limits<double>::infinity();
+    int exponent;
+    frexp(expected, &exponent);
+    return fabs(actual - expected) / ldexp(1.0, max(exponent - 53, -1074));
+}
+//---------------------------------------------------------------------------
+/// The largest error of a power kernel over pseudo random inputs
+template <typename Kernel>
+double maxPowerError(Kernel kernel, double xMin, double xMax, double yMin, double yMax) {
+    size_t count = 10007;
+    vector<double> x(count), y(count);
+    uint64_t state = 42;
+    auto next = [&] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<double>(state >> 11) * 0x1p-53;
+    };
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = xMin + (xMax - xMin) * next();
+        y[i] = yMin + (yMax - yMin) * next();
+    }
+    auto result = x;
+    kernel(result.data(), y.data(), count);
+    double error = 0.0;
+    for (size_t i = 0; i < count; ++i)
+        error = max(error, ulpError(result[i], pow(x[i], y[i])));
+    return error;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestKernels, Power) {
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<ISA>(i);
+        if (!Kernels::isSupported(isa))
+            continue;
+        SCOPED_TRACE(Kernels::getISAName(isa));
+        auto power = Kernels::get(isa).power;
+        EXPECT_LE(maxPowerError(power, 0.01, 10.0, -5.0, 5.0), 2.0);
+        EXPECT_LE(maxPowerError(power, 0.0, 1e300, -1.0, 1.0), 2.0);
+        // Results close to overflow and underflow need the full double-double precision
+        EXPECT_LE(maxPowerError(power, 0.7, 1.42, -2000.0, 2000.0), 2.0);
+        EXPECT_LE(maxPowerError(power, -10.0, 10.0, -3.0, 3.0), 2.0);
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestKernels, PowerSpecialCases) {
+    double inf = numeric_limits<double>::infinity();
+    double nan = numeric_limits<double>::quiet_NaN();
+    double denormal = numeric_limits<double>::denorm_min();
+    vector<double> x{0.0, -0.0, 0.0, -0.0, -2.0, -2.0, -2.0, inf, -inf, -inf, nan, nan, 1.0, 1.0, 2.0, 0.5, denormal, 1e300, 1e-300, 3.0, -1.0};
+    vector<double> y{2.0, 3.0, -1.0, -3.0, 3.0, 2.0, 0.5, -2.0, 3.0, 0.5, 0.0, 1.0, nan, inf, inf, -inf, 0.5, 10.0, 10.0, 1e-320, -inf};
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<ISA>(i);
+        auto result = x;
+        Kernels::get(isa).power(result.data(), y.data(), x.size());
+        for (size_t j = 0; j < x.size(); ++j) {
+            double expected = pow(x[j], y[j]);
+            EXPECT_EQ(ulpError(result[j], expected), 0.0) << Kernels::getISAName(isa) << " pow(" << x[j] << ", " << y[j] << ")";
+            EXPECT_EQ(signbit(result[j]), signbit(expected)) << Kernels::getISAName(isa) << " pow(" << x[j] << ", " << y[j] << ")";
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestKernels, PowerConstant) {
+    double inf = numeric_limits<double>::infinity();
+    vector<double> special{0.0, -0.0, inf, -inf, -2.0, 1e-310, 1e300, -1e300};
+    vector<double> exponents{0.0, 1.0, -1.0, 2.0, 3.0, -4.0, 4.0, 0.5, -0.5, 2.5, 5.0, -1.5};
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<ISA>(i);
+        const Kernels& kernels = Kernels::get(isa);
+        for (double exponent : exponents) {
+            SCOPED_TRACE(string(Kernels::getISAName(isa)) + " exponent " + to_string(exponent));
+            auto x = makeValues(101, 0.5);
+            for (auto& value : x)
+                value = fabs(value) + 0.125;
+            x.insert(x.end(), special.begin(), special.end());
+            auto result = x;
+            kernels.powerConstant(result.data(), exponent, result.size());
+            for (size_t j = 0; j < x.size(); ++j) {
+                double expected = pow(x[j], exponent);
+                ASSERT_LE(ulpError(result[j], expected), 2.0) << "pow(" << x[j] << ")";
+                ASSERT_EQ(signbit(result[j]), signbit(expected)) << "pow(" << x[j] << ")";
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestKernels, Float) {
+    using FloatKernels = BasicKernels<float>;
+    using Kernel = void (*)(float*, const float*, size_t);
+    Kernel FloatKernels::*kernels[] = {&FloatKernels::add, &FloatKernels::subtract, &FloatKernels::multiply, &FloatKernels::divide};
+    const FloatKernels& expected = FloatKernels::get(ISA::Scalar);
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<ISA>(i);
+        SCOPED_TRACE(Kernels::getISAName(isa));
+        const FloatKernels& actual = FloatKernels::get(isa);
+        // Float vectors have twice as many lanes, cover all their tails
+        for (size_t count = 0; count <= 65; ++count) {
+            auto values = makeValues(count, -2.0);
+            auto other = makeValues(count, 1.5);
+            vector<float> b(other.begin(), other.end());
+            vector<float> a1(values.begin(), values.end());
+            for (auto kernel : kernels) {
+                auto a2 = a1;
+                auto a3 = a1;
+                (expected.*kernel)(a2.data(), b.data(), count);
+                (actual.*kernel)(a3.data(), b.data(), count);
+                ASSERT_EQ(a2, a3) << "count " << count;
+            }
+            auto negated = a1;
+            actual.negate(negated.data(), count);
+            for (size_t j = 0; j < count; ++j)
+                ASSERT_EQ(negated[j], -a1[j]);
+
+            for (auto& value : a1)
+                value = fabs(value) + 0.125f;
+            // Small exponents keep the results finite
+            vector<float> exponents(b);
+            for (auto& value : exponents)
+                value /= 16.0f;
+            auto powered = a1;
+            actual.power(powered.data(), exponents.data(), count);
+            auto squared = a1;
+            actual.powerConstant(squared.data(), 2.0f, count);
+            for (size_t j = 0; j < count; ++j) {
+                ASSERT_NEAR(powered[j], pow(a1[j], exponents[j]), 1e-6f * pow(a1[j], exponents[j]));
+                ASSERT_EQ(squared[j], a1[j] * a1[j]);
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Compare the multiply-add kernels of all instruction sets against std::fma
+template <typename T>
+void checkMultiplyAdd() {
+    using TypedKernels = BasicKernels<T>;
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto isa = static_cast<ISA>(i);
+        SCOPED_TRACE(Kernels::getISAName(isa));
+        const TypedKernels& kernels = TypedKernels::get(isa);
+        for (size_t count = 0; count <= 33; ++count) {
+            // Products close to -c, where a separate rounding loses all digits
+            vector<T> a, b, c;
+            for (size_t j = 0; j < count; ++j) {
+                a.push_back(T(1) + T(j + 1) * numeric_limits<T>::epsilon());
+                b.push_back(T(1) - T(j + 1) * numeric_limits<T>::epsilon());
+                c.push_back(T(-1) - T(j % 3));
+            }
+            auto added = a;
+            kernels.multiplyAdd(added.data(), b.data(), c.data(), count);
+            auto subtracted = a;
+            kernels.multiplySubtract(subtracted.data(), b.data(), c.data(), count);
+            for (size_t j = 0; j < count; ++j) {
+                ASSERT_EQ(added[j], fma(a[j], b[j], c[j])) << "count " << count;
+                ASSERT_EQ(subtracted[j], fma(a[j], b[j], -c[j])) << "count " << count;
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestKernels, MultiplyAdd) {
+    checkMultiplyAdd<double>();
+    checkMultiplyAdd<float>();
+    checkMultiplyAdd<long double>();
+}
+//---------------------------------------------------------------------------
+TEST(TestKernels, LongDouble) {
+    // There are no vector instructions for long double, all tables are scalar
+    using LongKernels = BasicKernels<long double>;
+    vector<long double> a{1.0L, 2.0L, 3.0L};
+    vector<long double> b{3.0L, 3.0L, 3.0L};
+    for (size_t i = 0; i < Kernels::isaCount; ++i) {
+        auto result = a;
+        LongKernels::get(static_cast<ISA>(i)).divide(result.data(), b.data(), result.size());
+        for (size_t j = 0; j < a.size(); ++j)
+            EXPECT_EQ(result[j], a[j] / 3.0L);
+    }
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,163 @@
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/NodeFactory.hpp"
+#include "lib/Program.hpp"
+#include "lib/ThreadedVM.hpp"
+#include "lib/VM.hpp"
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+size_t countOpCode(const Program& program, Program::OpCode opCode) {
+    size_t count = 0;
+    for (const auto& instruction : program.getInstructions())
+        count += (instruction.opCode == opCode);
+    return count;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestNodeFactory, Leaves) {
+    NodeFactory factory;
+    EXPECT_EQ(&factory.constant(1.5), &factory.constant(1.5));
+    EXPECT_NE(&factory.constant(0.0), &factory.constant(-0.0));
+    EXPECT_EQ(&factory.parameter(3), &factory.parameter(3));
+    EXPECT_NE(&factory.parameter(3), &factory.parameter(4));
+    EXPECT_EQ(factory.size(), 5u);
+    EXPECT_TRUE(factory.owns(factory.parameter(3)));
+}
+//---------------------------------------------------------------------------
+TEST(TestNodeFactory, Operators) {
+    NodeFactory factory;
+    const ASTNode& p0 = factory.parameter(0);
+    const ASTNode& p1 = factory.parameter(1);
+    const ASTNode& difference = factory.subtract(p0, p1);
+    EXPECT_EQ(&difference, &factory.subtract(factory.parameter(0), factory.parameter(1)));
+    EXPECT_NE(&difference, &factory.subtract(p1, p0));
+    EXPECT_NE(&difference, &factory.add(p0, p1));
+    EXPECT_EQ(&factory.unaryMinus(difference), &factory.unaryMinus(difference));
+    EXPECT_NE(&factory.unaryMinus(difference), &factory.unaryPlus(difference));
+    EXPECT_EQ(difference.getType(), ASTNode::Type::Subtract);
+}
+//---------------------------------------------------------------------------
+TEST(TestNodeFactory, FusedMultiplyAdd) {
+    NodeFactory factory;
+    const ASTNode& p0 = factory.parameter(0);
+    const ASTNode& p1 = factory.parameter(1);
+    const ASTNode& p2 = factory.parameter(2);
+    const ASTNode& fused = factory.fusedMultiplyAdd(p0, p1, p2);
+    EXPECT_EQ(&fused, &factory.fusedMultiplyAdd(p0, p1, p2));
+    // The addend is part of the identity
+    EXPECT_NE(&fused, &factory.fusedMultiplyAdd(p0, p1, p1));
+    EXPECT_NE(&fused, &factory.fusedMultiplySubtract(p0, p1, p2));
+
+    auto tree = make_unique<Add>(make_unique<FusedMultiplyAdd>(make_unique<Parameter>(0), make_unique<Parameter>(1), make_unique<Parameter>(2)),
+                                 make_unique<FusedMultiplyAdd>(make_unique<Parameter>(0), make_unique<Parameter>(1), make_unique<Parameter>(2)));
+    const ASTNode& dag = factory.import(*tree);
+    EXPECT_EQ(&static_cast<const Add&>(dag).getLeft(), &fused);
+    EXPECT_EQ(&static_cast<const Add&>(dag).getRight(), &fused);
+}
+//---------------------------------------------------------------------------
+TEST(TestNodeFactory, Import) {
+    // (p0 - p1) * (p0 - p1) + -(p0 - p1)
+    auto difference = [] { return make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)); };
+    auto tree = make_unique<Add>(make_unique<Multiply>(difference(), difference()), make_unique<UnaryMinus>(difference()));
+
+    NodeFactory factory;
+    const ASTNode& dag = factory.import(*tree);
+    // p0, p1, p0 - p1, the product, the negation and the sum
+    EXPECT_EQ(factory.size(), 6u);
+    EXPECT_EQ(&factory.import(*tree), &dag);
+
+    EvaluationContext context;
+    context.pushParameter(5.0);
+    context.pushParameter(2.0);
+    EXPECT_EQ(dag.evaluate(context), tree->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestNodeFactory, SharedEvaluation) {
+    NodeFactory factory;
+    const ASTNode& difference = factory.subtract(factory.parameter(0), factory.parameter(1));
+    const ASTNode& square = factory.multiply(difference, difference);
+    const ASTNode& root = factory.add(square, factory.divide(square, difference));
+
+    Program program = Program::compile(root);
+    // The difference and the square are computed once each
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Subtract), 1u);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Multiply), 1u);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Store), 2u);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Load), 3u);
+    EXPECT_EQ(program.getSlotCount(), 2u);
+
+    EvaluationContext context;
+    context.pushParameter(7.0);
+    context.pushParameter(4.0);
+    VM vm(program);
+    ThreadedVM threaded(program);
+    EXPECT_EQ(vm.run(context), 12.0);
+    EXPECT_EQ(threaded.run(context), 12.0);
+    EXPECT_EQ(root.evaluate(context), 12.0);
+}
+//---------------------------------------------------------------------------
+TEST(TestNodeFactory, DeepSharing) {
+    // x_{i+1} = x_i + x_i expands to a tree of 2^60 nodes
+    NodeFactory factory;
+    const ASTNode* node = &factory.parameter(0);
+    for (unsigned i = 0; i < 60; ++i)
+        node = &factory.add(*node, *node);
+    EXPECT_EQ(factory.size(), 61u);
+
+    Program program = Program::compile(*node);
+    EXPECT_LT(program.getInstructions().size(), 200u);
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    VM vm(program);
+    EXPECT_EQ(vm.run(context), std::ldexp(3.0, 60));
+}
+//---------------------------------------------------------------------------
+TEST(TestNodeFactory, ImportDag) {
+    // Importing a DAG of another factory visits every node once
+    NodeFactory source;
+    const ASTNode* node = &source.parameter(0);
+    for (unsigned i = 0; i < 60; ++i)
+        node = &source.multiply(*node, source.add(*node, source.constant(1.0)));
+
+    NodeFactory factory;
+    const ASTNode& dag = factory.import(*node);
+    EXPECT_EQ(factory.size(), source.size());
+    EXPECT_TRUE(factory.owns(dag));
+    EXPECT_EQ(&factory.import(dag), &dag);
+}
+//---------------------------------------------------------------------------
+TEST(TestNodeFactory, CommonSubexpressions) {
+    // Trees are hash-consed when they are compiled: (p0 - p1) ^ 2 + (p0 - p1) ^ 2 * p2
+    auto square = [] { return make_unique<Power>(make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)), make_unique<Constant>(2.0)); };
+    auto tree = make_unique<Add>(square(), make_unique<Multiply>(square(), make_unique<Parameter>(2)));
+
+    Program program = Program::compile(*tree);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Subtract), 1u);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Power), 1u);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Store), 1u);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Load), 1u);
+
+    EvaluationContext context;
+    context.pushParameter(7.0);
+    context.pushParameter(4.0);
+    context.pushParameter(0.5);
+    EXPECT_EQ(VM(program).run(context), tree->evaluate(context));
+    EXPECT_EQ(ThreadedVM(program).run(context), tree->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestNodeFactory, TreesAreUnchanged) {
+    auto tree = make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(0));
+    Program program = Program::compile(*tree);
+    EXPECT_EQ(program.getSlotCount(), 0u);
+    EXPECT_EQ(program.getInstructions().size(), 3u);
+}
+//---------------------------------------------------------------------------
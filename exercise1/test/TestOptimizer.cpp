@@ -0,0 +1,185 @@
+#include "lib/AST.hpp"
+#include "lib/Arena.hpp"
+#include "lib/Optimizer.hpp"
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// A pass that wraps a parameter root into a double negation, which the rewrite rules remove again
+size_t negateTwice(unique_ptr<ASTNode>& root, Optimizer::Clock::time_point /*deadline*/, bool& /*stopped*/) {
+    if (root->getType() != ASTNode::Type::Parameter)
+        return 0;
+    root = make_unique<UnaryMinus>(make_unique<UnaryMinus>(move(root)));
+    return 1;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestOptimizer, Fixpoint) {
+    // a^1 + 1 * -b -> a - b, the second iteration proves the fixpoint
+    auto a = make_unique<Parameter>(0);
+    auto* aPtr = a.get();
+    unique_ptr<ASTNode> node = make_unique<Add>(make_unique<Power>(move(a), make_unique<Constant>(1)), make_unique<Multiply>(make_unique<Constant>(1), make_unique<UnaryMinus>(make_unique<Parameter>(1))));
+    auto result = Optimizer().run(node);
+    EXPECT_TRUE(result.converged);
+    EXPECT_EQ(result.iterations, 2u);
+    EXPECT_EQ(result.changes, 3u);
+    ASSERT_EQ(node->getType(), ASTNode::Type::Subtract);
+    EXPECT_EQ(&static_cast<Subtract&>(*node).getLeft(), aPtr);
+}
+//---------------------------------------------------------------------------
+TEST(TestOptimizer, AlreadyOptimal) {
+    unique_ptr<ASTNode> node = make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(1));
+    auto* before = node.get();
+    auto result = Optimizer().run(node);
+    EXPECT_TRUE(result.converged);
+    EXPECT_EQ(result.iterations, 1u);
+    EXPECT_EQ(result.changes, 0u);
+    EXPECT_EQ(node.get(), before);
+}
+//---------------------------------------------------------------------------
+TEST(TestOptimizer, Pipeline) {
+    // A pass that fires twice needs two changing iterations and a quiet one
+    unsigned remaining = 2;
+    Optimizer optimizer({}, Optimizer::Options());
+    optimizer.addPass([&](unique_ptr<ASTNode>&, Optimizer::Clock::time_point, bool&) -> size_t { return remaining ? remaining-- : 0; });
+    optimizer.addPass([](unique_ptr<ASTNode>&, Optimizer::Clock::time_point, bool&) -> size_t { return 0; });
+    EXPECT_EQ(optimizer.getPassCount(), 2u);
+
+    unique_ptr<ASTNode> node = make_unique<Parameter>(0);
+    auto result = optimizer.run(node);
+    EXPECT_TRUE(result.converged);
+    EXPECT_EQ(result.iterations, 3u);
+    EXPECT_EQ(result.changes, 3u);
+}
+//---------------------------------------------------------------------------
+TEST(TestOptimizer, IterationBudget) {
+    // The passes undo each other and never converge
+    Optimizer::Options options;
+    options.maxIterations = 5;
+    Optimizer optimizer(options);
+    optimizer.addPass(negateTwice);
+    unique_ptr<ASTNode> node = make_unique<Parameter>(0);
+    auto result = optimizer.run(node);
+    EXPECT_FALSE(result.converged);
+    EXPECT_EQ(result.iterations, 5u);
+    // The rewrite rules remove the double negation from the second iteration on
+    EXPECT_EQ(result.changes, 5u + 4u);
+}
+//---------------------------------------------------------------------------
+TEST(TestOptimizer, TimeBudget) {
+    Optimizer::Options options;
+    options.timeBudget = chrono::nanoseconds(0);
+    unique_ptr<ASTNode> node = make_unique<UnaryPlus>(make_unique<Parameter>(0));
+    auto result = Optimizer(options).run(node);
+    EXPECT_FALSE(result.converged);
+    EXPECT_EQ(result.iterations, 0u);
+    EXPECT_EQ(node->getType(), ASTNode::Type::UnaryPlus);
+
+    // A pass that overruns the budget stops the pipeline before the next pass
+    options.timeBudget = chrono::milliseconds(1);
+    options.maxIterations = 1000;
+    Optimizer slow({}, options);
+    unsigned calls = 0;
+    slow.addPass([&](unique_ptr<ASTNode>&, Optimizer::Clock::time_point, bool&) -> size_t {
+        ++calls;
+        auto start = chrono::steady_clock::now();
+        while (chrono::steady_clock::now() - start < chrono::milliseconds(2)) {
+        }
+        return 1;
+    });
+    slow.addPass([&](unique_ptr<ASTNode>&, Optimizer::Clock::time_point, bool&) -> size_t { ADD_FAILURE() << "the budget is exhausted"; return 0; });
+    result = slow.run(node);
+    EXPECT_FALSE(result.converged);
+    EXPECT_EQ(calls, 1u);
+    EXPECT_EQ(result.iterations, 1u);
+    EXPECT_GE(result.elapsed, chrono::milliseconds(2));
+}
+//---------------------------------------------------------------------------
+TEST(TestOptimizer, SlowFixpoint) {
+    // A pass that finishes after the budget still proves the fixpoint
+    Optimizer::Options options;
+    options.timeBudget = chrono::milliseconds(1);
+    Optimizer slow({}, options);
+    slow.addPass([](unique_ptr<ASTNode>&, Optimizer::Clock::time_point, bool&) -> size_t {
+        auto start = chrono::steady_clock::now();
+        while (chrono::steady_clock::now() - start < chrono::milliseconds(2)) {
+        }
+        return 0;
+    });
+    unique_ptr<ASTNode> node = make_unique<Parameter>(0);
+    auto result = slow.run(node);
+    EXPECT_TRUE(result.converged);
+    EXPECT_EQ(result.iterations, 1u);
+
+    // Unless it reports that the deadline stopped it
+    Optimizer stopped({}, options);
+    stopped.addPass([](unique_ptr<ASTNode>&, Optimizer::Clock::time_point deadline, bool& stopped) -> size_t {
+        while (chrono::steady_clock::now() < deadline) {
+        }
+        stopped = true;
+        return 0;
+    });
+    result = stopped.run(node);
+    EXPECT_FALSE(result.converged);
+    EXPECT_EQ(result.iterations, 1u);
+}
+//---------------------------------------------------------------------------
+TEST(TestOptimizer, DeepTree) {
+    // The default pipeline handles trees too deep for recursion
+    Optimizer::Options options;
+    options.timeBudget = chrono::seconds(60);
+    Arena arena;
+    auto a = arena.make<Parameter>(0);
+    auto* aPtr = a.get();
+    unique_ptr<ASTNode> node = move(a);
+    for (unsigned i = 0; i < 100000; ++i)
+        node = arena.make<Divide>(arena.make<UnaryPlus>(move(node)), arena.make<Constant>(1.0));
+    auto result = Optimizer(options).run(node);
+    EXPECT_TRUE(result.converged);
+    EXPECT_EQ(result.changes, 200000u);
+    EXPECT_EQ(node.get(), aPtr);
+    node.release();
+}
+//---------------------------------------------------------------------------
+TEST(TestOptimizer, Deadline) {
+    // The rewrite rules stop early on a huge tree, which stays valid
+    Optimizer::Options options;
+    options.timeBudget = chrono::microseconds(100);
+    Arena arena;
+    unique_ptr<ASTNode> node = arena.make<Parameter>(0);
+    for (unsigned i = 0; i < 1000000; ++i)
+        node = arena.make<Multiply>(move(node), arena.make<Constant>(1.0));
+    auto result = Optimizer(options).run(node);
+    EXPECT_FALSE(result.converged);
+    EXPECT_LT(result.changes, 1000000u);
+    EXPECT_LT(result.elapsed, chrono::seconds(1));
+
+    // Another run continues where the first one stopped
+    options.timeBudget = chrono::seconds(60);
+    result = Optimizer(options).run(node);
+    EXPECT_TRUE(result.converged);
+    EXPECT_EQ(node->getType(), ASTNode::Type::Parameter);
+    node.release();
+}
+//---------------------------------------------------------------------------
+TEST(TestOptimizer, FuseMultiplyAdd) {
+    // Fusion changes the rounding and is only done on request: -p0 * 2 + p1 -> fma(-p0, 2, p1)
+    unique_ptr<ASTNode> node = make_unique<Add>(make_unique<Multiply>(make_unique<UnaryMinus>(make_unique<Parameter>(0)), make_unique<Constant>(2.0)), make_unique<Parameter>(1));
+    unique_ptr<ASTNode> unfused = make_unique<Add>(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Constant>(2.0)), make_unique<Parameter>(1));
+    EXPECT_EQ(Optimizer().run(unfused).changes, 0u);
+    EXPECT_EQ(unfused->getType(), ASTNode::Type::Add);
+
+    Optimizer::Options options;
+    options.fuseMultiplyAdd = true;
+    auto result = Optimizer(options).run(node);
+    EXPECT_TRUE(result.converged);
+    EXPECT_EQ(node->getType(), ASTNode::Type::FusedMultiplyAdd);
+}
+//---------------------------------------------------------------------------
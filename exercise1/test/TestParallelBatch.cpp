@@ -0,0 +1,64 @@
+#include "lib/AST.hpp"
+#include "lib/Batch.hpp"
+#include "lib/ColumnarContext.hpp"
+#include "lib/ParallelBatch.hpp"
+#include "lib/ThreadPool.hpp"
+#include "test/Fixtures.hpp"
+#include <memory>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+using fixtures::makeColumns;
+using fixtures::makeExpression;
+//---------------------------------------------------------------------------
+TEST(TestParallelBatch, MatchesSerial) {
+    auto node = makeExpression();
+    size_t rowCount = 10 * BatchEvaluator::maxTileSize + 29;
+    auto columns = makeColumns(3, rowCount);
+    ColumnarContext context;
+    for (const auto& column : columns)
+        context.pushColumn(column);
+
+    vector<double> expected(rowCount);
+    evaluateBatch(*node, context, expected);
+    for (size_t threadCount : {1, 2, 3, 8}) {
+        ThreadPool pool(threadCount);
+        // Chunks that are smaller than, not a multiple of and larger than a block
+        for (size_t chunkSize : {1, 100, 256, 1000, 100000}) {
+            ParallelBatchEvaluator evaluator(*node, pool, chunkSize);
+            vector<double> out(rowCount);
+            evaluator.evaluate(context, out);
+            ASSERT_EQ(out, expected) << threadCount << " threads, chunks of " << chunkSize;
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestParallelBatch, ChunkSize) {
+    auto node = make_unique<Parameter>(0);
+    ThreadPool pool(2);
+    EXPECT_EQ(ParallelBatchEvaluator(*node, pool).getChunkSize(), ParallelBatchEvaluator::defaultChunkSize);
+    EXPECT_EQ(ParallelBatchEvaluator(*node, pool, 0).getChunkSize(), ParallelBatchEvaluator::defaultChunkSize);
+    EXPECT_EQ(ParallelBatchEvaluator(*node, pool, 77).getChunkSize(), 77u);
+}
+//---------------------------------------------------------------------------
+TEST(TestParallelBatch, Reuse) {
+    auto node = make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Constant>(2.0));
+    vector<double> column(5000);
+    for (size_t r = 0; r < column.size(); ++r)
+        column[r] = static_cast<double>(r);
+    ColumnarContext context;
+    context.pushColumn(column);
+
+    ThreadPool pool(4);
+    ParallelBatchEvaluator evaluator(*node, pool, 300);
+    for (size_t rowCount : {5000, 0, 1, 299, 301}) {
+        vector<double> out(rowCount);
+        evaluator.evaluate(context, out);
+        for (size_t r = 0; r < rowCount; ++r)
+            ASSERT_EQ(out[r], 2.0 * r);
+    }
+}
+//---------------------------------------------------------------------------
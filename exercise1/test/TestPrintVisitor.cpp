@@ -61,6 +61,24 @@ TEST(TestPrintVisitor, UnaryMinus) {
     EXPECT_EQ(cout.stream.str(), "(-P42)");
 }
 //---------------------------------------------------------------------------
+TEST(TestPrintVisitor, SquareRoot) {
+    CaptureCout cout;
+    unique_ptr<ASTNode> node = make_unique<SquareRoot>(make_unique<Parameter>(42));
+    PrintVisitor visitor;
+    node->accept(visitor);
+    EXPECT_EQ(cout.stream.str(), "sqrt(P42)");
+}
+//---------------------------------------------------------------------------
+TEST(TestPrintVisitor, FusedMultiplyAdd) {
+    CaptureCout cout;
+    unique_ptr<ASTNode> node = make_unique<FusedMultiplyAdd>(make_unique<Parameter>(0), make_unique<Constant>(2), make_unique<Parameter>(1));
+    PrintVisitor visitor;
+    node->accept(visitor);
+    node = make_unique<FusedMultiplySubtract>(make_unique<Parameter>(0), make_unique<Constant>(2), make_unique<Parameter>(1));
+    node->accept(visitor);
+    EXPECT_EQ(cout.stream.str(), "fma(P0, 2, P1)fms(P0, 2, P1)");
+}
+//---------------------------------------------------------------------------
 TEST(TestPrintVisitor, Add) {
     CaptureCout cout;
     auto p1 = make_unique<Parameter>(1);
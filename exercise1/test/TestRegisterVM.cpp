@@ -0,0 +1,161 @@
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/NodeFactory.hpp"
+#include "lib/RegisterProgram.hpp"
+#include "lib/RegisterVM.hpp"
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+double run(const ASTNode& node, const EvaluationContext& context) {
+    RegisterProgram program = RegisterProgram::compile(node);
+    RegisterVM vm(program);
+    return vm.run(context);
+}
+//---------------------------------------------------------------------------
+unique_ptr<ASTNode> balanced(unsigned depth, size_t& nextParameter) {
+    if (!depth)
+        return make_unique<Parameter>(nextParameter++);
+    auto left = balanced(depth - 1, nextParameter);
+    auto right = balanced(depth - 1, nextParameter);
+    return make_unique<Multiply>(move(left), move(right));
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestRegisterVM, Leaves) {
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    Constant c(1.5);
+    EXPECT_EQ(run(c, context), 1.5);
+    Parameter p(0);
+    EXPECT_EQ(run(p, context), 3.0);
+    Parameter missing(4);
+    EXPECT_EQ(run(missing, context), missing.evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestRegisterVM, LargeParameterIndex) {
+    // The operand is 32 bit, larger indexes are rejected instead of truncated
+    Parameter largest(numeric_limits<uint32_t>::max());
+    EXPECT_EQ(RegisterProgram::compile(largest).getInstructions()[0].src1, numeric_limits<uint32_t>::max());
+    Parameter tooLarge(size_t(numeric_limits<uint32_t>::max()) + 1);
+    EXPECT_THROW(RegisterProgram::compile(tooLarge), out_of_range);
+}
+//---------------------------------------------------------------------------
+TEST(TestRegisterVM, AllNodeTypes) {
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    context.pushParameter(0.7);
+    vector<unique_ptr<ASTNode>> nodes;
+    nodes.push_back(make_unique<UnaryPlus>(make_unique<Parameter>(0)));
+    nodes.push_back(make_unique<UnaryMinus>(make_unique<Parameter>(0)));
+    nodes.push_back(make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Divide>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Power>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    for (const auto& node : nodes)
+        EXPECT_EQ(run(*node, context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestRegisterVM, OperandOrder) {
+    SCOPED_TRACE("a - (b / (c - d)) evaluates the right side first");
+    EvaluationContext context;
+    for (double v : {5.0, 3.0, 2.0, 0.5})
+        context.pushParameter(v);
+    unique_ptr<ASTNode> node = make_unique<Subtract>(make_unique<Parameter>(2), make_unique<Parameter>(3));
+    node = make_unique<Divide>(make_unique<Parameter>(1), move(node));
+    node = make_unique<Subtract>(make_unique<Parameter>(0), move(node));
+    EXPECT_EQ(run(*node, context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestRegisterVM, Chains) {
+    SCOPED_TRACE("left- and right-deep chains need a single temporary");
+    EvaluationContext context;
+    context.pushParameter(1.25);
+    unique_ptr<ASTNode> left = make_unique<Parameter>(0);
+    unique_ptr<ASTNode> right = make_unique<Parameter>(0);
+    for (unsigned i = 0; i < 10; ++i) {
+        left = make_unique<Add>(move(left), make_unique<Constant>(i));
+        right = make_unique<Multiply>(make_unique<Constant>(i + 1), move(right));
+    }
+    for (const auto* node : {left.get(), right.get()}) {
+        RegisterProgram program = RegisterProgram::compile(*node);
+        // One parameter, ten distinct constants, one temporary
+        EXPECT_EQ(program.getRegisterCount(), 12u);
+        // One parameter load and one instruction per operator
+        EXPECT_EQ(program.getInstructions().size(), 11u);
+        RegisterVM vm(program);
+        EXPECT_EQ(vm.run(context), node->evaluate(context));
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestRegisterVM, Balanced) {
+    SCOPED_TRACE("a balanced tree of depth d needs d temporaries");
+    size_t parameters = 0;
+    auto node = balanced(4, parameters);
+    RegisterProgram program = RegisterProgram::compile(*node);
+    EXPECT_EQ(program.getRegisterCount(), 16u + 4u);
+
+    EvaluationContext context;
+    for (size_t i = 0; i < parameters; ++i)
+        context.pushParameter(1.0 + i / 8.0);
+    RegisterVM vm(program);
+    EXPECT_EQ(vm.run(context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestRegisterVM, SharedLeaves) {
+    SCOPED_TRACE("repeated leaves share one register");
+    unique_ptr<ASTNode> node = make_unique<Add>(make_unique<Parameter>(0), make_unique<Constant>(2.0));
+    node = make_unique<Multiply>(move(node), make_unique<Parameter>(0));
+    node = make_unique<Subtract>(move(node), make_unique<Constant>(2.0));
+    RegisterProgram program = RegisterProgram::compile(*node);
+    EXPECT_EQ(program.getConstants().size(), 1u);
+    EXPECT_EQ(program.getRegisterCount(), 3u);
+
+    EvaluationContext context;
+    context.pushParameter(-4.5);
+    RegisterVM vm(program);
+    EXPECT_EQ(vm.run(context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestRegisterVM, CommonSubexpressions) {
+    SCOPED_TRACE("structurally equal subtrees are computed once into a shared register");
+    // -(p0 - p1) * (p0 - p1) + -(p0 - p1)
+    auto difference = [] { return make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)); };
+    auto negated = [&] { return make_unique<UnaryMinus>(difference()); };
+    unique_ptr<ASTNode> node = make_unique<Add>(make_unique<Multiply>(negated(), difference()), negated());
+    RegisterProgram program = RegisterProgram::compile(*node);
+    // Two loads, the difference, its negation, the product and the sum
+    EXPECT_EQ(program.getInstructions().size(), 6u);
+
+    EvaluationContext context;
+    context.pushParameter(2.5);
+    context.pushParameter(-1.25);
+    RegisterVM vm(program);
+    EXPECT_EQ(vm.run(context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestRegisterVM, Dag) {
+    SCOPED_TRACE("x_{i+1} = x_i + x_i expands to a tree of 2^60 nodes");
+    NodeFactory factory;
+    const ASTNode* node = &factory.parameter(0);
+    for (unsigned i = 0; i < 60; ++i)
+        node = &factory.add(*node, *node);
+    RegisterProgram program = RegisterProgram::compile(*node);
+    EXPECT_EQ(program.getInstructions().size(), 61u);
+
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    RegisterVM vm(program);
+    EXPECT_EQ(vm.run(context), std::ldexp(3.0, 60));
+}
+//---------------------------------------------------------------------------
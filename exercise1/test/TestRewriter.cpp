@@ -0,0 +1,495 @@
+#include "lib/AST.hpp"
+#include "lib/Arena.hpp"
+#include "lib/Batch.hpp"
+#include "lib/Closure.hpp"
+#include "lib/ColumnarContext.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/FlatTree.hpp"
+#include "lib/JIT.hpp"
+#include "lib/Optimizer.hpp"
+#include "lib/Program.hpp"
+#include "lib/RegisterProgram.hpp"
+#include "lib/RegisterVM.hpp"
+#include "lib/Rewriter.hpp"
+#include "lib/ThreadedVM.hpp"
+#include "lib/VM.hpp"
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// A pseudo random tree with many neutral elements, negations and constants
+class TreeGenerator {
+public:
+    explicit TreeGenerator(uint64_t seed) : state(seed) {}
+
+    unique_ptr<ASTNode> make(unsigned depth) {
+        if (!depth || next(4) == 0) {
+            static constexpr double constants[] = {0.0, 1.0, -1.0, 2.0, 0.5, 3.0};
+            if (next(2))
+                return make_unique<Parameter>(next(3));
+            return make_unique<Constant>(constants[next(6)]);
+        }
+        switch (next(7)) {
+            case 0: return make_unique<UnaryPlus>(make(depth - 1));
+            case 1: return make_unique<UnaryMinus>(make(depth - 1));
+            case 2: return make_unique<Add>(make(depth - 1), make(depth - 1));
+            case 3: return make_unique<Subtract>(make(depth - 1), make(depth - 1));
+            case 4: return make_unique<Multiply>(make(depth - 1), make(depth - 1));
+            case 5: return make_unique<Divide>(make(depth - 1), make(depth - 1));
+            default: {
+                // 0^x -> 0 only holds for positive x, keep the exponents constant
+                static constexpr double exponents[] = {0.0, 1.0, -1.0, 2.0, 3.0, -2.0, 7.0, 0.5, -0.5};
+                return make_unique<Power>(make(depth - 1), make_unique<Constant>(exponents[next(9)]));
+            }
+        }
+    }
+
+private:
+    unsigned next(unsigned bound) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return (state >> 33) % bound;
+    }
+
+    uint64_t state;
+};
+//---------------------------------------------------------------------------
+size_t countNodes(const ASTNode& node) {
+    switch (node.getType()) {
+        case ASTNode::Type::Constant:
+        case ASTNode::Type::Parameter:
+            return 1;
+        case ASTNode::Type::UnaryPlus:
+        case ASTNode::Type::UnaryMinus:
+        case ASTNode::Type::SquareRoot:
+            return 1 + countNodes(static_cast<const UnaryASTNode&>(node).getInput());
+        case ASTNode::Type::FusedMultiplyAdd:
+        case ASTNode::Type::FusedMultiplySubtract: {
+            const auto& ternary = static_cast<const TernaryASTNode&>(node);
+            return 1 + countNodes(ternary.getFirst()) + countNodes(ternary.getSecond()) + countNodes(ternary.getThird());
+        }
+        default: {
+            const auto& binary = static_cast<const BinaryASTNode&>(node);
+            return 1 + countNodes(binary.getLeft()) + countNodes(binary.getRight());
+        }
+    }
+}
+//---------------------------------------------------------------------------
+size_t countOpCode(const Program& program, Program::OpCode opCode) {
+    size_t count = 0;
+    for (const auto& instruction : program.getInstructions())
+        count += (instruction.opCode == opCode);
+    return count;
+}
+//---------------------------------------------------------------------------
+bool containsPower(const ASTNode& node) {
+    switch (node.getType()) {
+        case ASTNode::Type::Constant:
+        case ASTNode::Type::Parameter:
+            return false;
+        case ASTNode::Type::Power:
+            return true;
+        case ASTNode::Type::UnaryPlus:
+        case ASTNode::Type::UnaryMinus:
+        case ASTNode::Type::SquareRoot:
+            return containsPower(static_cast<const UnaryASTNode&>(node).getInput());
+        case ASTNode::Type::FusedMultiplyAdd:
+        case ASTNode::Type::FusedMultiplySubtract: {
+            const auto& ternary = static_cast<const TernaryASTNode&>(node);
+            return containsPower(ternary.getFirst()) || containsPower(ternary.getSecond()) || containsPower(ternary.getThird());
+        }
+        default: {
+            const auto& binary = static_cast<const BinaryASTNode&>(node);
+            return containsPower(binary.getLeft()) || containsPower(binary.getRight());
+        }
+    }
+}
+//---------------------------------------------------------------------------
+/// Both are NaN or equal including the sign of zero
+bool same(double a, double b) {
+    return (isnan(a) && isnan(b)) || (a == b && signbit(a) == signbit(b));
+}
+//---------------------------------------------------------------------------
+/// The pseudo random trees after optimization and fusion, without powers whose vectorized kernels are not exact
+vector<unique_ptr<ASTNode>> makeFusedTrees(uint64_t seed, unsigned count) {
+    TreeGenerator generator(seed);
+    vector<unique_ptr<ASTNode>> trees;
+    while (trees.size() < count) {
+        auto node = generator.make(7);
+        Rewriter::optimize(node);
+        Rewriter::fuse(node);
+        if (!containsPower(*node))
+            trees.push_back(move(node));
+    }
+    return trees;
+}
+//---------------------------------------------------------------------------
+/// c0 + x * (c1 + x * (... + x * cn))
+unique_ptr<ASTNode> makeHorner(unsigned degree) {
+    unique_ptr<ASTNode> node = make_unique<Constant>(1.0 / (degree + 1));
+    for (unsigned i = degree; i-- > 0;)
+        node = make_unique<Add>(make_unique<Constant>(1.0 / (i + 1)), make_unique<Multiply>(make_unique<Parameter>(0), move(node)));
+    return node;
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestRewriter, PreservesValues) {
+    EvaluationContext context;
+    context.pushParameter(1.5);
+    context.pushParameter(-2.25);
+    context.pushParameter(3.0);
+    TreeGenerator generator(7);
+    size_t before = 0, after = 0;
+    for (unsigned i = 0; i < 500; ++i) {
+        auto node = generator.make(6);
+        double expected = node->evaluate(context);
+        before += countNodes(*node);
+        Rewriter::optimize(node);
+        after += countNodes(*node);
+        // Some rules are only exact for finite values, like a * 0 -> 0
+        if (!isfinite(expected))
+            continue;
+        EXPECT_NEAR(node->evaluate(context), expected, 1e-9 * (1.0 + fabs(expected))) << "tree " << i;
+    }
+    EXPECT_LT(after, before);
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, Fixpoint) {
+    // The replacement of a rule is matched again: -(-(a) - b) -> b - (-a) -> b + a
+    TreeGenerator generator(11);
+    for (unsigned i = 0; i < 200; ++i) {
+        auto node = generator.make(7);
+        Rewriter::optimize(node);
+        size_t size = countNodes(*node);
+        // A second pass finds nothing left to do
+        Rewriter::optimize(node);
+        EXPECT_EQ(countNodes(*node), size) << "tree " << i;
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, DeepTree) {
+    // Too deep for a recursive pass, the arena avoids the recursive destructors
+    Arena arena;
+    auto a = arena.make<Parameter>(0);
+    auto* aPtr = a.get();
+    unique_ptr<ASTNode> node = move(a);
+    for (unsigned i = 0; i < 100000; ++i) {
+        if (i % 2)
+            node = arena.make<Multiply>(arena.make<Constant>(1.0), move(node));
+        else
+            node = arena.make<UnaryMinus>(arena.make<UnaryMinus>(arena.make<Add>(move(node), arena.make<Constant>(0.0))));
+    }
+    node->optimize(node);
+    EXPECT_EQ(node.get(), aPtr);
+    node.release();
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, ArenaReplacements) {
+    // New nodes are created in the arena of the node they replace
+    Arena arena;
+    unique_ptr<ASTNode> node = arena.make<Subtract>(arena.make<Parameter>(0), arena.make<UnaryMinus>(arena.make<Parameter>(1)));
+    Rewriter::optimize(node);
+    ASSERT_EQ(node->getType(), ASTNode::Type::Add);
+    EXPECT_EQ(Arena::of(*node), &arena);
+    node.release();
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, PowerChains) {
+    // The length of the shortest addition chain of every exponent
+    static constexpr size_t multiplications[] = {0, 0, 1, 2, 2, 3, 3, 4, 3, 4, 4, 5, 4, 5, 5, 5, 4};
+    EvaluationContext context;
+    context.pushParameter(1.0625);
+    context.pushParameter(-0.75);
+    for (int n = -16; n <= 16; ++n) {
+        if (abs(n) < 2)
+            continue;
+        // (p0 * p1) ^ n
+        unique_ptr<ASTNode> node = make_unique<Power>(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(1)), make_unique<Constant>(n));
+        double expected = node->evaluate(context);
+        Rewriter::optimize(node);
+        // The power becomes a single node, the base is not copied
+        ASSERT_EQ(node->getType(), ASTNode::Type::IntegerPower) << n;
+        EXPECT_EQ(countNodes(*node), 5u) << n;
+        double reduced = node->evaluate(context);
+        EXPECT_NEAR(reduced, expected, 1e-14 * abs(expected)) << n;
+
+        // The compiled backends multiply along the chain, plus the product of the base
+        Program program = Program::compile(*node);
+        EXPECT_EQ(countOpCode(program, Program::OpCode::Multiply), multiplications[abs(n)] + 1) << n;
+        EXPECT_EQ(countOpCode(program, Program::OpCode::Divide), n < 0 ? 1u : 0u) << n;
+        EXPECT_EQ(countOpCode(program, Program::OpCode::Power), 0u) << n;
+        RegisterProgram registerProgram = RegisterProgram::compile(*node);
+        EXPECT_EQ(registerProgram.getInstructions().size(), 2 + multiplications[abs(n)] + 1 + (n < 0)) << n;
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, PowerBackends) {
+    // Every backend computes exactly what the tree does, pow for a power as
+    // written and the addition chain for the optimized one
+    vector<double> values = {0.0, -0.0, 1.0, -1.0, INFINITY, -INFINITY, NAN, 0x1p-1060, 1e300, -1e-300};
+    uint64_t state = 42;
+    while (values.size() < 100) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        values.push_back(static_cast<double>(state >> 11) * 0x1p-50 - 4.0);
+    }
+    for (int n = -16; n <= 16; ++n) {
+        for (bool optimized : {false, true}) {
+            SCOPED_TRACE("n " + to_string(n) + (optimized ? " optimized" : ""));
+            unique_ptr<ASTNode> node = make_unique<Power>(make_unique<Parameter>(0), make_unique<Constant>(n));
+            if (optimized)
+                Rewriter::optimize(node);
+            EXPECT_EQ(node->getType() == ASTNode::Type::IntegerPower, optimized && abs(n) >= 2);
+            Program program = Program::compile(*node);
+            RegisterProgram registerProgram = RegisterProgram::compile(*node);
+            VM vm(program);
+            ThreadedVM threadedVM(program);
+            RegisterVM registerVM(registerProgram);
+            ClosureFunction closure = ClosureFunction::compile(*node);
+            FlatTree flat = FlatTree::fromAST(*node);
+            auto native = JITFunction::compile(*node);
+            vector<double> batch(values.size());
+            ColumnarContext columns;
+            columns.pushColumn(values);
+            BatchEvaluator(*node).evaluate(columns, batch);
+            for (size_t i = 0; i < values.size(); ++i) {
+                EvaluationContext context;
+                context.pushParameter(values[i]);
+                double expected = node->evaluate(context);
+                ASSERT_TRUE(same(vm.run(context), expected)) << values[i];
+                ASSERT_TRUE(same(threadedVM.run(context), expected)) << values[i];
+                ASSERT_TRUE(same(registerVM.run(context), expected)) << values[i];
+                ASSERT_TRUE(same(closure.evaluate(context), expected)) << values[i];
+                ASSERT_TRUE(same(flat.evaluate(context), expected)) << values[i];
+                if (native) {
+                    ASSERT_TRUE(same(native->evaluate(context), expected)) << values[i];
+                }
+                // The vectorized pow kernel is not exact, the chain only multiplies
+                if (node->getType() != ASTNode::Type::Power) {
+                    ASSERT_TRUE(same(batch[i], expected)) << values[i];
+                }
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, SharedPowerChains) {
+    // A shared base is computed once and the chain spills into slots and temporaries
+    auto difference = [] { return make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)); };
+    unique_ptr<ASTNode> node = make_unique<Add>(make_unique<Power>(difference(), make_unique<Constant>(15.0)), make_unique<Power>(make_unique<Add>(difference(), make_unique<Constant>(-13.0)), make_unique<Constant>(-7.0)));
+    Rewriter::optimize(node);
+    EvaluationContext context;
+    context.pushParameter(2.5);
+    context.pushParameter(1.25);
+    double expected = node->evaluate(context);
+    Program program = Program::compile(*node);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Subtract), 1u);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Power), 0u);
+    EXPECT_TRUE(same(VM(program).run(context), expected));
+    RegisterProgram registerProgram = RegisterProgram::compile(*node);
+    EXPECT_TRUE(same(RegisterVM(registerProgram).run(context), expected));
+    if (auto native = JITFunction::compile(*node)) {
+        EXPECT_TRUE(same(native->evaluate(context), expected));
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, PowerLimits) {
+    // Larger and fractional exponents stay a power, deep bases are not copied
+    auto power = [](unique_ptr<ASTNode> base, double exponent) -> unique_ptr<ASTNode> {
+        return make_unique<Power>(move(base), make_unique<Constant>(exponent));
+    };
+    unique_ptr<ASTNode> large = power(make_unique<Parameter>(0), 17.0);
+    unique_ptr<ASTNode> fraction = power(make_unique<Parameter>(0), 2.5);
+    for (auto* node : {&large, &fraction}) {
+        Rewriter::optimize(*node);
+        EXPECT_EQ((*node)->getType(), ASTNode::Type::Power);
+    }
+    unique_ptr<ASTNode> deep = power(make_unique<Add>(make_unique<Parameter>(0), make_unique<Multiply>(make_unique<Parameter>(1), make_unique<Parameter>(2))), 16.0);
+    Rewriter::optimize(deep);
+    EXPECT_EQ(deep->getType(), ASTNode::Type::IntegerPower);
+    EXPECT_EQ(countNodes(*deep), 7u);
+    unique_ptr<ASTNode> folded = make_unique<IntegerPower>(make_unique<Constant>(1.5), make_unique<Constant>(-3.0));
+    Rewriter::optimize(folded);
+    ASSERT_EQ(folded->getType(), ASTNode::Type::Constant);
+    EXPECT_EQ(static_cast<const Constant&>(*folded).getValue(), IntegerPower::apply(1.5, -3.0));
+
+    unique_ptr<ASTNode> root = power(make_unique<Parameter>(0), 0.5);
+    Rewriter::optimize(root);
+    EXPECT_EQ(root->getType(), ASTNode::Type::SquareRoot);
+    unique_ptr<ASTNode> reciprocal = power(make_unique<Parameter>(0), -0.5);
+    Rewriter::optimize(reciprocal);
+    ASSERT_EQ(reciprocal->getType(), ASTNode::Type::Divide);
+    EXPECT_EQ(static_cast<const Divide&>(*reciprocal).getRight().getType(), ASTNode::Type::SquareRoot);
+    unique_ptr<ASTNode> squareRoot = make_unique<SquareRoot>(make_unique<Constant>(-0.0));
+    Rewriter::optimize(squareRoot);
+    ASSERT_EQ(squareRoot->getType(), ASTNode::Type::Constant);
+    EXPECT_TRUE(same(static_cast<const Constant&>(*squareRoot).getValue(), 0.0));
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, SquareRootBackends) {
+    // Every backend gives pow(a, 0.5) and pow(a, -0.5) for the square root nodes, including the special cases
+    const vector<double> values = {2.25, 0.0, -0.0, INFINITY, -INFINITY, -1.0, 0x1p-1060};
+    for (double exponent : {0.5, -0.5}) {
+        unique_ptr<ASTNode> node = make_unique<Power>(make_unique<Parameter>(0), make_unique<Constant>(exponent));
+        Rewriter::optimize(node);
+        ASSERT_FALSE(containsPower(*node));
+
+        Program program = Program::compile(*node);
+        RegisterProgram registerProgram = RegisterProgram::compile(*node);
+        VM vm(program);
+        ThreadedVM threaded(program);
+        RegisterVM registerVM(registerProgram);
+        auto closure = ClosureFunction::compile(*node);
+        auto flat = FlatTree::fromAST(*node);
+        auto native = JITFunction::compile(*node);
+
+        vector<double> batch(values.size());
+        ColumnarContext columns;
+        columns.pushColumn(values);
+        BatchEvaluator(*node).evaluate(columns, batch);
+
+        for (size_t i = 0; i < values.size(); ++i) {
+            SCOPED_TRACE(values[i]);
+            double expected = pow(values[i], exponent);
+            EvaluationContext context;
+            context.pushParameter(values[i]);
+            EXPECT_TRUE(same(node->evaluate(context), expected));
+            EXPECT_TRUE(same(vm.run(context), expected));
+            EXPECT_TRUE(same(threaded.run(context), expected));
+            EXPECT_TRUE(same(registerVM.run(context), expected));
+            EXPECT_TRUE(same(closure.evaluate(context), expected));
+            EXPECT_TRUE(same(flat.evaluate(context), expected));
+            EXPECT_TRUE(same(batch[i], expected));
+            if (native) {
+                EXPECT_TRUE(same(native->evaluate(context), expected));
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, FusionPatterns) {
+    // The product is rounded once: (1 + 2^-30) * (1 - 2^-30) - 1 is -2^-60 instead of 0
+    auto p = [](size_t index) -> unique_ptr<ASTNode> { return make_unique<Parameter>(index); };
+    auto product = [&] { return make_unique<Multiply>(p(0), p(1)); };
+    struct Case {
+        unique_ptr<ASTNode> node;
+        ASTNode::Type type;
+        size_t size;
+        double addend;
+        double expected;
+    };
+    Case cases[] = {
+        {make_unique<Add>(product(), p(2)), ASTNode::Type::FusedMultiplyAdd, 4, -1.0, -0x1p-60},
+        {make_unique<Add>(p(2), product()), ASTNode::Type::FusedMultiplyAdd, 4, -1.0, -0x1p-60},
+        {make_unique<Subtract>(product(), p(2)), ASTNode::Type::FusedMultiplySubtract, 4, 1.0, -0x1p-60},
+        // The negation of the first factor is exact
+        {make_unique<Subtract>(p(2), product()), ASTNode::Type::FusedMultiplyAdd, 5, 1.0, 0x1p-60},
+    };
+    for (auto& [node, type, size, addend, expected] : cases) {
+        EXPECT_EQ(Rewriter::fuse(node), 1u);
+        EXPECT_EQ(node->getType(), type);
+        EXPECT_EQ(countNodes(*node), size);
+        EvaluationContext context;
+        context.pushParameter(1.0 + 0x1p-30);
+        context.pushParameter(1.0 - 0x1p-30);
+        context.pushParameter(addend);
+        EXPECT_EQ(node->evaluate(context), expected);
+    }
+
+    // A constant factor is negated in place: 1 - 2 * p0 -> fma(-2, p0, 1)
+    unique_ptr<ASTNode> node = make_unique<Subtract>(make_unique<Constant>(1.0), make_unique<Multiply>(make_unique<Constant>(2.0), p(0)));
+    Rewriter::fuse(node);
+    ASSERT_EQ(node->getType(), ASTNode::Type::FusedMultiplyAdd);
+    EXPECT_EQ(countNodes(*node), 4u);
+    EXPECT_EQ(static_cast<const Constant&>(static_cast<const TernaryASTNode&>(*node).getFirst()).getValue(), -2.0);
+
+    // Nothing to fuse, and a second pass finds nothing left
+    unique_ptr<ASTNode> sum = make_unique<Add>(p(0), p(1));
+    EXPECT_EQ(Rewriter::fuse(sum), 0u);
+    EXPECT_EQ(Rewriter::fuse(node), 0u);
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, FusionBackends) {
+    // Every backend rounds the fused nodes once, exactly like the tree walker
+    auto trees = makeFusedTrees(13, 200);
+    // A balanced tree of fused nodes needs many registers at once
+    auto balanced = [](auto& self, unsigned depth) -> unique_ptr<ASTNode> {
+        if (!depth)
+            return makeHorner(3);
+        return make_unique<Add>(make_unique<Multiply>(make_unique<Parameter>(depth % 3), self(self, depth - 1)), self(self, depth - 1));
+    };
+    trees.push_back(balanced(balanced, 5));
+    Rewriter::fuse(trees.back());
+
+    vector<vector<double>> columns(3);
+    for (size_t row = 0; row < 37; ++row) {
+        columns[0].push_back(0.75 + 0x1p-27 * row);
+        columns[1].push_back(-1.5 - 0x1p-29 * row);
+        columns[2].push_back(row % 5 == 0 ? 0.0 : 3.0 / (row + 1));
+    }
+    ColumnarContext columnar;
+    for (auto& column : columns)
+        columnar.pushColumn(column);
+
+    size_t fused = 0;
+    for (size_t i = 0; i < trees.size(); ++i) {
+        SCOPED_TRACE(i);
+        const ASTNode& node = *trees[i];
+        Program program = Program::compile(node);
+        fused += countOpCode(program, Program::OpCode::FusedMultiplyAdd) + countOpCode(program, Program::OpCode::FusedMultiplySubtract) != 0;
+        RegisterProgram registerProgram = RegisterProgram::compile(node);
+        VM vm(program);
+        ThreadedVM threaded(program);
+        RegisterVM registerVM(registerProgram);
+        auto closure = ClosureFunction::compile(node);
+        auto flat = FlatTree::fromAST(node);
+        auto native = JITFunction::compile(node);
+        vector<double> batch(columns[0].size());
+        BatchEvaluator(node).evaluate(columnar, batch);
+
+        for (size_t row = 0; row < batch.size(); ++row) {
+            EvaluationContext context;
+            for (auto& column : columns)
+                context.pushParameter(column[row]);
+            double expected = node.evaluate(context);
+            ASSERT_TRUE(same(vm.run(context), expected)) << "row " << row;
+            ASSERT_TRUE(same(threaded.run(context), expected)) << "row " << row;
+            ASSERT_TRUE(same(registerVM.run(context), expected)) << "row " << row;
+            ASSERT_TRUE(same(closure.evaluate(context), expected)) << "row " << row;
+            ASSERT_TRUE(same(flat.evaluate(context), expected)) << "row " << row;
+            ASSERT_TRUE(same(batch[row], expected)) << "row " << row;
+            if (native) {
+                ASSERT_TRUE(same(native->evaluate(context), expected)) << "row " << row;
+            }
+        }
+    }
+    EXPECT_GT(fused, 20u);
+}
+//---------------------------------------------------------------------------
+TEST(TestRewriter, FusionHorner) {
+    // Every step of Horner's scheme is one fused node instead of a multiplication and an addition
+    unique_ptr<ASTNode> node = makeHorner(10);
+    EvaluationContext context;
+    context.pushParameter(0.3);
+    double expected = node->evaluate(context);
+    size_t before = Program::compile(*node).getInstructions().size();
+
+    Optimizer::Options options;
+    options.fuseMultiplyAdd = true;
+    EXPECT_TRUE(Optimizer(options).run(node).converged);
+    Program program = Program::compile(*node);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::FusedMultiplyAdd), 10u);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Multiply), 0u);
+    EXPECT_EQ(countOpCode(program, Program::OpCode::Add), 0u);
+    EXPECT_LT(program.getInstructions().size(), before);
+    EXPECT_NEAR(node->evaluate(context), expected, 1e-15);
+}
+//---------------------------------------------------------------------------
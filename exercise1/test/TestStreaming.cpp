@@ -0,0 +1,148 @@
+#include "lib/AST.hpp"
+#include "lib/Batch.hpp"
+#include "lib/ColumnFile.hpp"
+#include "lib/ColumnarContext.hpp"
+#include "lib/Streaming.hpp"
+#include "test/Fixtures.hpp"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// A file in the temporary directory that is removed again
+class TemporaryFile {
+public:
+    explicit TemporaryFile(const string& name) : path(filesystem::temp_directory_path() / ("ast_" + to_string(getpid()) + "_" + name)) {}
+    ~TemporaryFile() { filesystem::remove(path); }
+
+    string getPath() const { return path.string(); }
+
+private:
+    filesystem::path path;
+};
+//---------------------------------------------------------------------------
+using fixtures::makeColumns;
+//---------------------------------------------------------------------------
+void writeColumns(const string& path, const vector<vector<double>>& columns) {
+    auto writer = ColumnFileWriter::create(path, columns.size(), columns.empty() ? 0 : columns[0].size());
+    ASSERT_TRUE(writer);
+    for (size_t c = 0; c < columns.size(); ++c)
+        ASSERT_TRUE(writer->write(c, 0, columns[c]));
+}
+//---------------------------------------------------------------------------
+vector<double> readColumn(const string& path, size_t column) {
+    auto reader = ColumnFileReader::open(path);
+    if (!reader)
+        return {};
+    vector<double> values(reader->getRowCount());
+    EXPECT_TRUE(reader->read(column, 0, values));
+    return values;
+}
+//---------------------------------------------------------------------------
+/// (p0 - p2) * p3 ^ 0.5, parameter 1 is not used
+unique_ptr<ASTNode> makeExpression() {
+    auto difference = make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(2));
+    return make_unique<Multiply>(move(difference), make_unique<Power>(make_unique<Parameter>(3), make_unique<Constant>(0.5)));
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestStreaming, ColumnFile) {
+    TemporaryFile file("columns");
+    auto columns = makeColumns(3, 100);
+    writeColumns(file.getPath(), columns);
+
+    auto reader = ColumnFileReader::open(file.getPath());
+    ASSERT_TRUE(reader);
+    EXPECT_EQ(reader->getColumnCount(), 3u);
+    EXPECT_EQ(reader->getRowCount(), 100u);
+    vector<double> values(10);
+    ASSERT_TRUE(reader->read(2, 90, values));
+    EXPECT_EQ(values, vector<double>(columns[2].begin() + 90, columns[2].end()));
+    // Out of range
+    EXPECT_FALSE(reader->read(3, 0, values));
+    EXPECT_FALSE(reader->read(0, 91, values));
+}
+//---------------------------------------------------------------------------
+TEST(TestStreaming, InvalidFiles) {
+    TemporaryFile file("invalid");
+    EXPECT_FALSE(ColumnFileReader::open(file.getPath()));
+    ofstream(file.getPath()) << "not a column file";
+    EXPECT_FALSE(ColumnFileReader::open(file.getPath()));
+
+    auto node = makeExpression();
+    TemporaryFile output("invalid_out");
+    EXPECT_FALSE(StreamingEvaluator(*node).evaluate(file.getPath(), output.getPath()));
+
+    // 8 * (2^61 + 1) rows of 8 bytes wrap around to 64 bytes of data
+    ColumnFile::Header header;
+    memcpy(header.magic, ColumnFile::magic, sizeof(header.magic));
+    header.columnCount = 8;
+    header.rowCount = (uint64_t(1) << 61) + 1;
+    {
+        ofstream out(file.getPath(), ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out << string(64, '\0');
+    }
+    EXPECT_FALSE(ColumnFileReader::open(file.getPath()));
+    EXPECT_FALSE(StreamingEvaluator(*node).evaluate(file.getPath(), output.getPath()));
+    EXPECT_FALSE(ColumnFile::getFileSize(1, uint64_t(1) << 61));
+    EXPECT_FALSE(ColumnFileWriter::create(output.getPath(), 8, (uint64_t(1) << 61) + 1));
+    EXPECT_EQ(ColumnFile::getFileSize(3, 100), ColumnFile::headerSize + 3 * 100 * sizeof(double));
+}
+//---------------------------------------------------------------------------
+TEST(TestStreaming, MatchesBatch) {
+    auto node = makeExpression();
+    for (size_t rowCount : {0, 1, 1000, 4099}) {
+        TemporaryFile input("input");
+        TemporaryFile output("output");
+        auto columns = makeColumns(4, rowCount);
+        writeColumns(input.getPath(), columns);
+
+        ColumnarContext context;
+        for (const auto& column : columns)
+            context.pushColumn(column);
+        vector<double> expected(rowCount);
+        evaluateBatch(*node, context, expected);
+
+        // One chunk, chunks that do not divide the rows and more than two chunks
+        for (size_t chunkRows : {100000, 1000, 333, 1}) {
+            StreamingEvaluator evaluator(*node, chunkRows);
+            ASSERT_TRUE(evaluator.evaluate(input.getPath(), output.getPath()));
+            ASSERT_EQ(readColumn(output.getPath(), 0), expected) << rowCount << " rows, chunks of " << chunkRows;
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestStreaming, MissingColumns) {
+    TemporaryFile input("input");
+    TemporaryFile output("output");
+    writeColumns(input.getPath(), makeColumns(1, 10));
+    // Parameter 3 is not in the file and reads as 0
+    auto node = make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(3));
+    ASSERT_TRUE(StreamingEvaluator(*node, 4).evaluate(input.getPath(), output.getPath()));
+    EXPECT_EQ(readColumn(output.getPath(), 0), makeColumns(1, 10)[0]);
+}
+//---------------------------------------------------------------------------
+TEST(TestStreaming, RowCountMismatch) {
+    TemporaryFile input("input");
+    TemporaryFile output("output");
+    writeColumns(input.getPath(), makeColumns(4, 10));
+    auto reader = ColumnFileReader::open(input.getPath());
+    auto writer = ColumnFileWriter::create(output.getPath(), 1, 11);
+    ASSERT_TRUE(reader && writer);
+    auto node = makeExpression();
+    EXPECT_FALSE(StreamingEvaluator(*node).evaluate(*reader, *writer));
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,67 @@
+#include "lib/ThreadPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+TEST(TestThreadPool, ThreadCount) {
+    EXPECT_EQ(ThreadPool(3).getThreadCount(), 3u);
+    EXPECT_GE(ThreadPool().getThreadCount(), 1u);
+}
+//---------------------------------------------------------------------------
+TEST(TestThreadPool, RunsEveryTaskOnce) {
+    for (size_t threadCount : {1, 2, 5}) {
+        ThreadPool pool(threadCount);
+        // Fewer, equal and more tasks than threads, and repeated runs
+        for (size_t taskCount : {0, 1, 3, 5, 1000}) {
+            vector<atomic<unsigned>> runs(taskCount);
+            atomic<bool> validWorker = true;
+            pool.run(taskCount, [&](size_t task, size_t worker) {
+                ++runs[task];
+                if (worker >= threadCount)
+                    validWorker = false;
+            });
+            for (size_t i = 0; i < taskCount; ++i)
+                ASSERT_EQ(runs[i], 1u) << threadCount << " threads, task " << i;
+            EXPECT_TRUE(validWorker);
+        }
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestThreadPool, StealsFromBusyWorkers) {
+    ThreadPool pool(4);
+    // The tasks of worker 0 are slow, the others have to steal them
+    constexpr size_t taskCount = 40;
+    vector<size_t> workers(taskCount);
+    pool.run(taskCount, [&](size_t task, size_t worker) {
+        workers[task] = worker;
+        if (worker == 0)
+            this_thread::sleep_for(chrono::milliseconds(20));
+    });
+    size_t stolen = 0;
+    for (size_t task = 0; task < taskCount / 4; ++task)
+        stolen += workers[task] != 0;
+    EXPECT_GT(stolen, 0u);
+}
+//---------------------------------------------------------------------------
+TEST(TestThreadPool, RethrowsExceptions) {
+    ThreadPool pool(3);
+    atomic<size_t> count = 0;
+    EXPECT_THROW(pool.run(100, [&](size_t task, size_t) {
+        ++count;
+        if (task == 42)
+            throw runtime_error("task failed");
+    }),
+                 runtime_error);
+    // The other tasks still ran and the pool is usable afterwards
+    EXPECT_EQ(count, 100u);
+    count = 0;
+    pool.run(10, [&](size_t, size_t) { ++count; });
+    EXPECT_EQ(count, 10u);
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/Program.hpp"
+#include "lib/ThreadedVM.hpp"
+#include "lib/VM.hpp"
+#include <memory>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+double run(const ASTNode& node, const EvaluationContext& context) {
+    Program program = Program::compile(node);
+    ThreadedVM vm(program);
+    return vm.run(context);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestThreadedVM, Leaves) {
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    EXPECT_EQ(run(Constant(1.5), context), 1.5);
+    EXPECT_EQ(run(Parameter(0), context), 3.0);
+    EXPECT_EQ(run(Parameter(9), context), 0.0);
+}
+//---------------------------------------------------------------------------
+TEST(TestThreadedVM, AllNodeTypes) {
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    context.pushParameter(0.7);
+    vector<unique_ptr<ASTNode>> nodes;
+    nodes.push_back(make_unique<UnaryPlus>(make_unique<Parameter>(0)));
+    nodes.push_back(make_unique<UnaryMinus>(make_unique<Parameter>(0)));
+    nodes.push_back(make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Divide>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Power>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    for (const auto& node : nodes)
+        EXPECT_EQ(run(*node, context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestThreadedVM, MatchesVM) {
+    EvaluationContext context;
+    context.pushParameter(1.25);
+    context.pushParameter(-0.5);
+    unique_ptr<ASTNode> node = make_unique<Parameter>(0);
+    for (unsigned i = 0; i < 50; ++i) {
+        unique_ptr<ASTNode> term = make_unique<Multiply>(make_unique<Parameter>(i % 2), make_unique<Constant>(i));
+        if (i % 3)
+            node = make_unique<Add>(move(node), move(term));
+        else
+            node = make_unique<Subtract>(move(term), make_unique<UnaryMinus>(move(node)));
+    }
+    Program program = Program::compile(*node);
+    VM vm(program);
+    ThreadedVM threaded(program);
+    EXPECT_EQ(threaded.run(context), vm.run(context));
+    EXPECT_EQ(threaded.run(context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
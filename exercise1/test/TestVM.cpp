@@ -0,0 +1,124 @@
+#include "lib/AST.hpp"
+#include "lib/EvaluationContext.hpp"
+#include "lib/Program.hpp"
+#include "lib/VM.hpp"
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+using namespace ast;
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+double run(const ASTNode& node, const EvaluationContext& context) {
+    Program program = Program::compile(node);
+    VM vm(program);
+    return vm.run(context);
+}
+//---------------------------------------------------------------------------
+} // namespace
+//---------------------------------------------------------------------------
+TEST(TestVM, Constant) {
+    EvaluationContext context;
+    Constant c(1.5);
+    EXPECT_EQ(run(c, context), 1.5);
+}
+//---------------------------------------------------------------------------
+TEST(TestVM, Parameter) {
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    Parameter p(0);
+    EXPECT_EQ(run(p, context), 3.0);
+    Parameter missing(7);
+    EXPECT_EQ(run(missing, context), missing.evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestVM, LargeParameterIndex) {
+    // The operand is 32 bit, larger indexes are rejected instead of truncated
+    Parameter largest(numeric_limits<uint32_t>::max());
+    EXPECT_EQ(Program::compile(largest).getInstructions()[0].operand, numeric_limits<uint32_t>::max());
+    Parameter tooLarge(size_t(numeric_limits<uint32_t>::max()) + 1);
+    EXPECT_THROW(Program::compile(tooLarge), out_of_range);
+}
+//---------------------------------------------------------------------------
+TEST(TestVM, Unary) {
+    EvaluationContext context;
+    context.pushParameter(2.0);
+    auto plus = make_unique<UnaryPlus>(make_unique<Parameter>(0));
+    EXPECT_EQ(run(*plus, context), 2.0);
+    auto minus = make_unique<UnaryMinus>(make_unique<Parameter>(0));
+    EXPECT_EQ(run(*minus, context), -2.0);
+}
+//---------------------------------------------------------------------------
+TEST(TestVM, Binary) {
+    EvaluationContext context;
+    context.pushParameter(3.0);
+    context.pushParameter(0.7);
+    vector<unique_ptr<ASTNode>> nodes;
+    nodes.push_back(make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Subtract>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Divide>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    nodes.push_back(make_unique<Power>(make_unique<Parameter>(0), make_unique<Parameter>(1)));
+    for (const auto& node : nodes)
+        EXPECT_EQ(run(*node, context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestVM, Nested) {
+    EvaluationContext context;
+    context.pushParameter(2.0);
+    context.pushParameter(4.0);
+    unique_ptr<ASTNode> node1 = make_unique<Add>(make_unique<Parameter>(0), make_unique<Parameter>(1));
+    unique_ptr<ASTNode> node2 = make_unique<Subtract>(make_unique<Parameter>(1), make_unique<UnaryMinus>(make_unique<Parameter>(0)));
+    unique_ptr<ASTNode> node = make_unique<Multiply>(move(node1), move(node2));
+    node = make_unique<Divide>(move(node), make_unique<Constant>(3.0));
+    node = make_unique<Power>(move(node), make_unique<Constant>(0.5));
+    EXPECT_EQ(run(*node, context), node->evaluate(context));
+}
+//---------------------------------------------------------------------------
+TEST(TestVM, StackDepth) {
+    // Left-deep chains need two slots, right-deep chains one slot per level
+    unique_ptr<ASTNode> left = make_unique<Parameter>(0);
+    unique_ptr<ASTNode> right = make_unique<Parameter>(0);
+    for (unsigned i = 0; i < 10; ++i) {
+        left = make_unique<Add>(move(left), make_unique<Constant>(i));
+        right = make_unique<Add>(make_unique<Constant>(i), move(right));
+    }
+    EXPECT_EQ(Program::compile(*left).getMaxStackDepth(), 2u);
+    EXPECT_EQ(Program::compile(*right).getMaxStackDepth(), 11u);
+    EXPECT_EQ(Program::compile(*left).getInstructions().size(), 21u);
+}
+//---------------------------------------------------------------------------
+TEST(TestVM, Reuse) {
+    unique_ptr<ASTNode> node = make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(0));
+    Program program = Program::compile(*node);
+    VM vm(program);
+    for (unsigned i = 0; i < 5; ++i) {
+        EvaluationContext context;
+        context.pushParameter(i);
+        EXPECT_EQ(vm.run(context), i * i);
+    }
+}
+//---------------------------------------------------------------------------
+TEST(TestVM, Precision) {
+    // p0 * p0 / p0 overflows in float, 1 + p1 - 1 keeps p1 only in long double
+    unique_ptr<ASTNode> overflow = make_unique<Divide>(make_unique<Multiply>(make_unique<Parameter>(0), make_unique<Parameter>(0)), make_unique<Parameter>(0));
+    unique_ptr<ASTNode> cancel = make_unique<Subtract>(make_unique<Add>(make_unique<Constant>(1.0), make_unique<Parameter>(1)), make_unique<Constant>(1.0));
+    EvaluationContext context;
+    context.pushParameter(1e20);
+    context.pushParameter(1e-17);
+
+    Program overflowProgram = Program::compile(*overflow);
+    EXPECT_EQ(BasicVM<float>(overflowProgram).run(context), numeric_limits<float>::infinity());
+    EXPECT_EQ(VM(overflowProgram).run(context), 1e20);
+
+    Program cancelProgram = Program::compile(*cancel);
+    EXPECT_EQ(VM(cancelProgram).run(context), 0.0);
+    if (numeric_limits<long double>::digits > numeric_limits<double>::digits) {
+        EXPECT_NEAR(static_cast<double>(BasicVM<long double>(cancelProgram).run(context)), 1e-17, 1e-18);
+    }
+}
+//---------------------------------------------------------------------------